@@ -1,555 +1,2857 @@
-#include "apds9930.h"
-#include "iic.h"
-
-/**
- * @brief       check APDS9930 Device Address
- * @param       NONE
- * @return      NONE
-*/
-//static void apds9930_check(void)
-//{
-//    if (i2c_CheckDevice(APDS9930_I2C_ADDR))
-//    {
-//        while (1)
-//        {
-//            HAL_GPIO_WritePin(LED_GPIO_Port, LED_Pin, GPIO_PIN_RESET);
-//            HAL_Delay(100);
-//            HAL_GPIO_WritePin(LED_GPIO_Port, LED_Pin, GPIO_PIN_SET);
-//            HAL_Delay(100);
-//        }
-//    }
-//}
-
-/**
- * @brief       write APDS9930 register data
- * @param       address   register Address
- * @param       dat   write data
- * @return      NONE
-*/
-void apds9930_WriteRegData(uint8_t address, uint8_t dat)
-{
-    i2c_Start();
-
-    i2c_SendByte((APDS9930_I2C_ADDR << 1) & (0xFE));
-    i2c_WaitAck();
-
-    i2c_SendByte(REPEATED_BYTE | address);
-    i2c_WaitAck();
-
-    i2c_SendByte(dat);
-    i2c_WaitAck();
-
-    i2c_Stop();
-}
-
-/**
- * @brief Writes a single byte to the I2C device (no register)
- *
- * @param[in] val the 1-byte value to write to the I2C device
- * @return True if successful write operation. False otherwise.
- */
-void apds9930_wireWriteByte(uint8_t val)
-{
-    i2c_Start();
-
-    i2c_SendByte((APDS9930_I2C_ADDR << 1) & (0xFE));
-    i2c_WaitAck();
-
-    i2c_SendByte(val);
-    i2c_WaitAck();
-
-    i2c_Stop();
-}
-
-/**
- * @brief       read APDS9930 register data
- * @param       address   register Address
- * @return      register data
-*/
-uint8_t apds9930_readRegData(uint8_t address)
-{
-    uint8_t recv_data;
-
-    i2c_Start();
-    i2c_SendByte((APDS9930_I2C_ADDR << 1) & (0xFE));
-    i2c_WaitAck();
-
-    i2c_SendByte(AUTO_INCREMENT | address);
-    i2c_WaitAck();
-
-    i2c_Start();
-    i2c_SendByte((APDS9930_I2C_ADDR << 1) | (0x01));
-    i2c_WaitAck();
-
-    recv_data = i2c_ReadByte(0);
-
-    i2c_Stop();
-
-    return (uint8_t)recv_data;
-}
-
-/**
- * @brief       init APDS9930
- * @param       NONE
- * @return      NONE
-*/
-void apds9930_init(void)
-{
-    uint8_t id = 0;
-    
-    /*init i2c gpio*/
-    iic_gpio_init();
-
-    /*i2c stop*/
-    i2c_Stop();
-
-    /*read apds9930 id*/
-    id = apds9930_readRegData(APDS9930_ID);
-    printf("0x%x \r\n",id);
-    
-    if(id != 0x39)
-        while(1);
-
-    /* Set ENABLE register to 0 (disable all features) */
-    apds9930_setMode(ALL,OFF);
-
-    /*set apds9930 registers*/
-
-    apds9930_WriteRegData(APDS9930_ATIME, DEFAULT_ATIME);   //set ATIME
-    apds9930_WriteRegData(APDS9930_WTIME, DEFAULT_WTIME);   //set WTIME
-    apds9930_WriteRegData(APDS9930_PPULSE, DEFAULT_PPULSE); //set PPULSE
-    apds9930_WriteRegData(APDS9930_POFFSET, DEFAULT_POFFSET); //set POFFSET
-    apds9930_WriteRegData(APDS9930_CONFIG, DEFAULT_CONFIG);   //clear CONFIG
-
-    apds9930_setLEDDriver(DEFAULT_PDRIVE);
-    apds9930_setProximityGain(DEFAULT_PGAIN);
-    apds9930_setAmbientLightGain(DEFAULT_AGAIN);
-    apds9930_setProximityDiode(DEFAULT_PDIODE);
-
-    // apds9930_setProximityIntLowThreshold(DEFAULT_PILT);
-    // apds9930_setProximityIntHighThreshold(DEFAULT_PIHT);
-    apds9930_setLightIntLowThreshold(DEFAULT_AILT);
-    apds9930_setLightIntHighThreshold(DEFAULT_AIHT);
-
-    apds9930_WriteRegData(APDS9930_PERS, DEFAULT_PERS); //Enable and Powerup apds9930
-
-    HAL_Delay(500); //delay 20ms
-}
-
-/**
- * @brief       read APDS9930   Mode
- * @param       NONE
- * @return      enable_value
-*/
-uint8_t apds9930_getMode(void)
-{
-    uint8_t enable_value;
-
-    enable_value = apds9930_readRegData(APDS9930_ENABLE);
-
-    return enable_value;
-}
-
-/**
- * @brief       set APDS9930 mode
- * @param       mode which feature to enable
- * @param       enable ON (1) or OFF (0)
- * @return      enable_value
-*/
-void apds9930_setMode(uint8_t mode, uint8_t enable)
-{
-    uint8_t reg_val;
-
-    reg_val = apds9930_getMode();
-
-    if(reg_val == ERROR)
-        while(1);
-
-    enable = enable & 0x01;
-
-    if(mode >= 0 && mode <= 6)
-    {
-        if(enable){
-            reg_val |= (1<<mode);
-        }else{
-            reg_val &= ~(1<<mode);
-        }
-    } else if(mode == ALL)
-    {
-        if(enable){
-            reg_val = 0x7F;
-        } else {
-            reg_val = 0x00;
-        }
-    }
-
-    apds9930_WriteRegData(APDS9930_ENABLE,reg_val);
-
-}
-
-/**
- * @brief       Starts the light (Ambient/IR) sensor on the APDS-9930
- * @param       interrupts true to enable hardware interrupt on high or low lighte
- * @return      NONE
-*/
-void apds9930_enableLightSensor(bool interrupts)
-{
-    apds9930_setAmbientLightGain(DEFAULT_AGAIN);
-
-    if(interrupts){
-        apds9930_setAmbientLightIntEnable(1);
-    } else {
-        apds9930_setAmbientLightIntEnable(0);
-    }
-
-    apds9930_enablePower();
-
-    apds9930_setMode(AMBIENT_LIGHT,1);
-}
-
-/**
- * @brief       Ends the light sensor on the APDS-9930
- * @param       NONE
- * @return      NONE
-*/
-void apds9930_disableLightSensor(void)
-{
-    apds9930_setAmbientLightIntEnable(0);
-
-    apds9930_setMode(AMBIENT_LIGHT,0);
-}
-
-
-/**
- * @brief       Ends the light sensor on the APDS-9930
- * @param       NONE
- * @return      NONE
-*/
-uint8_t apds9930_getAmbientLightGain(void)
-{
-    uint8_t val;
-
-    val = apds9930_readRegData(APDS9930_CONTROL);
-
-    val &= 0x03;
-
-    return val;
-}
-
-
-/**
- * @brief       read APDS9930   Ch0 light
- * @param       NONE
- * @return      light
-*/
-uint16_t apds9930_readCh0Light(void)
-{
-    uint8_t val_byte[2];
-
-    val_byte[0] = apds9930_readRegData(APDS9930_Ch0DATAL);
-    val_byte[1] = apds9930_readRegData(APDS9930_Ch0DATAH);
-
-    return (uint16_t)((val_byte[0]) + (uint16_t)(val_byte[1]*256));
-}
-
-/**
- * @brief       read APDS9930   Ch1 light
- * @param       NONE
- * @return      light
-*/
-uint16_t apds9930_readCh1Light(void)
-{
-    uint8_t val_byte[2];
-
-    val_byte[0] = apds9930_readRegData(APDS9930_Ch1DATAL);
-    val_byte[1] = apds9930_readRegData(APDS9930_Ch1DATAH);
-
-    return (uint16_t)((val_byte[0]) + (uint16_t)(val_byte[1]*256));
-}
-
-/**
- * @brief       read APDS9930   Proximity
- * @param       NONE
- * @return      Proximity
-*/
-uint16_t apds9930_readProximity(void)
-{
-    uint8_t val_byte[2];
-
-    val_byte[0] = apds9930_readRegData(APDS9930_PDATAL);
-    val_byte[1] = apds9930_readRegData(APDS9930_PDATAH);
-
-    return (uint16_t)(val_byte[1] + (uint16_t)(val_byte[0] << 8));
-}
-
-/**
- * @brief       Sets the low threshold for ambient light interrupts
- * @param       threshold  interrupts threshold
- * @return      NONE
-*/
-void apds9930_setLightIntLowThreshold(uint16_t threshold)
-{
-    uint8_t val_low;
-    uint8_t val_high;
-
-    val_low = threshold & 0x00FF;
-    val_high = (threshold & 0xFF00) >> 8;
-    
-
-    apds9930_WriteRegData(APDS9930_AILTL, val_low);
-    apds9930_WriteRegData(APDS9930_AILTH, val_high);
-}
-
-/**
- * @brief       Sets the high threshold for ambient light interrupts
- * @param       threshold  interrupts threshold
- * @return      NONE
-*/
-void apds9930_setLightIntHighThreshold(uint16_t threshold)
-{
-    uint8_t val_low;
-    uint8_t val_high;
-
-    val_low = (threshold & 0x00FF);
-    val_high = (threshold & 0xFF00) >> 8;
-
-    apds9930_WriteRegData(APDS9930_AIHTL, val_low);
-    apds9930_WriteRegData(APDS9930_AIHTH, val_high);
-}
-
-/**
- * @brief       get light
- * @param       light_gain:0-->AGAIN_1X 1-->AGAIN_8X  2-->AGAIN_16X  3-->AGAIN_120X
- * @return      light value
-*/
-float apds9930_readAmbientLightLux(uint8_t light_gain)
-{
-    uint16_t ch0, ch1;
-    uint8_t x[4] = {1, 8, 16, 120};
-    float ALSIT = 2.73f * (256 - DEFAULT_ATIME);
-    float iac;
-    float lpc;
-
-    ch0 = apds9930_readCh0Light();
-    ch1 = apds9930_readCh1Light();
-
-    if ((ch0 - ALS_B * ch1) > (ALS_C * ch0 - ALS_D * ch1))
-    {
-        iac = ch0 - ALS_B * ch1;
-    }
-    else
-    {
-        iac = ALS_C * ch0 - ALS_D * ch1;
-    }
-
-    if (iac < 0)
-        iac = 0;
-
-    lpc = (GA * DF) / (ALSIT * x[apds9930_getAmbientLightGain()]);
-
-    return iac * lpc;
-}
-
-/**
- * @brief       Sets the LED drive strength for proximity and ALS
- * @param       drive the value (0-3) for the LED drive strength
- * @return      NONE
-*/
-void apds9930_setLEDDriver(uint8_t driver)
-{
-    uint8_t val;
-
-    val = apds9930_readRegData(APDS9930_CONTROL);
-
-    driver &= 0x03;
-    driver = driver << 6;
-    val &= 0x3F;
-    val |= driver;
-
-    apds9930_WriteRegData(APDS9930_CONTROL,val);
-}
-
-/**
- * @brief       Sets the receiver gain for proximity detection
- * @param       drive the value (0-3) for the LED drive strength
- * @return      NONE
-*/
-void apds9930_setProximityGain(uint8_t driver)
-{
-    uint8_t val;
-
-    val = apds9930_readRegData(APDS9930_CONTROL);
-
-    driver &= 0x03;
-    driver = driver << 2;
-    val &= 0xF3;
-    val |= driver;
-
-    apds9930_WriteRegData(APDS9930_CONTROL,val);
-}
-
-/**
- * @brief       Sets the receiver gain for the ambient light sensor (ALS)
- * @param       drive the value (0-3) for the LED drive strength
- * @return      NONE
-*/
-void apds9930_setAmbientLightGain(uint8_t drive)
-{
-    uint8_t val;
-
-    val = apds9930_readRegData(APDS9930_CONTROL);
-
-    drive &= 0x03;
-    val &= 0xFC;
-    val |= drive;
-
-    apds9930_WriteRegData(APDS9930_CONTROL,val);
-}
-
-/**
- * @brief       Selects the proximity diode
- * @param       drive the value (0-3) for the LED drive strength
- * @return      NONE
-*/
-void apds9930_setProximityDiode(uint8_t drive)
-{
-    uint8_t val;
-
-    val = apds9930_readRegData(APDS9930_CONTROL);
-
-    drive &= 0x03;
-    drive = drive << 4;
-    val &= 0xCF;
-    val |= drive;
-
-    apds9930_WriteRegData(APDS9930_CONTROL,val);
-}
-
-/**
- * @brief       Selects the proximity diode
- * @param       threshold the value for irq
- * @return      NONE
-*/
-//void apds9930_setProximityIntLowThreshold(uint16_t threshold)
-//{
-//    uint8_t lo;
-//    uint8_t hi;
-//    hi = threshold >> 8;
-//    lo = threshold & 0x00FF;
-
-//    apds9930_WriteRegData(APDS9930_PILTL,lo);
-//    apds9930_WriteRegData(APDS9930_PILTL,hi);
-//}
-
-/**
- * @brief       Selects the proximity diode
- * @param       threshold the value for irq
- * @return      NONE
-*/
-//void apds9930_setProximityIntHighThreshold(uint16_t threshold)
-//{
-//    uint8_t lo;
-//    uint8_t hi;
-//    hi = threshold >> 8;
-//    lo = threshold & 0x00FF;
-
-//    apds9930_WriteRegData(APDS9930_PIHTL,lo);
-//    apds9930_WriteRegData(APDS9930_PIHTH,hi);
-//}
-
-
-/**
- * @brief Turns ambient light interrupts on or off
- *
- * @param[in] enable 1 to enable interrupts, 0 to turn them off
- * @return True if operation successful. False otherwise.
- */
-void apds9930_setAmbientLightIntEnable(uint8_t enable)
-{
-    uint8_t val;
-
-    val = apds9930_readRegData(APDS9930_ENABLE);
-
-    enable &= 0x01;
-    enable = enable << 4;
-    val &= 0xEF;
-    val |= enable;  
-
-    apds9930_WriteRegData(APDS9930_ENABLE,val);
-}
-
-/**
- * @brief Clears the ambient light interrupt
- *
- * @return True if operation completed successfully. False otherwise.
- */
-void apds9930_clearAmbientLightInt(void)
-{
-    apds9930_wireWriteByte(CLEAR_ALS_INT);
-}
-
-/**
- * @brief Clears all interrupts
- *
- * @return True if operation completed successfully. False otherwise.
- */
-void apds9930_clearAllInts(void)
-{
-    apds9930_wireWriteByte(CLEAR_ALL_INTS);
-}
-
-/**
- * @brief       Turn the APDS-9930 on
- * @param       NONE
- * @return      NONE
-*/
-void apds9930_enablePower(void)
-{
-    apds9930_setMode(POWER,1);
-}
-
-/**
- * @brief       Turn the APDS-9930 off
- * @param       NONE
- * @return      NONE
-*/
-void apds9930_disablePower(void)
-{
-    apds9930_setMode(POWER,0);
-}
-
-/**
- * @brief       get Light Int Low Threshold
- * @param       NONE
- * @return      threshold
-*/
-uint16_t apds9930_getLightIntLowThreshold(void)
-{
-    uint8_t val_byte[2];
-    uint16_t threshold=0;
-    
-    val_byte[0] = apds9930_readRegData(APDS9930_AILTL);
-    val_byte[1] = apds9930_readRegData(APDS9930_AILTH);
-    
-    threshold = (uint16_t)(val_byte[0] + (uint16_t)(val_byte[1]*256));
-    
-    return threshold;
-}
-
-/**
- * @brief       get Light Int High Threshold
- * @param       NONE
- * @return      threshold
-*/
-uint16_t apds9930_getLightIntHighThreshold(void)
-{
-    uint8_t val_byte[2];
-    uint16_t threshold=0;
-    
-    val_byte[0] = apds9930_readRegData(APDS9930_AIHTL);
-    val_byte[1] = apds9930_readRegData(APDS9930_AIHTH);
-    
-    threshold = (uint16_t)(val_byte[0] + (uint16_t)(val_byte[1]*256));
-    
-    return threshold;
-}
\ No newline at end of file
+#include "apds9930.h"
+
+#ifndef APDS9930_DEFAULT_BUS
+#define APDS9930_DEFAULT_BUS    apds9930_bus_iic
+#endif
+
+/* Instance behind the apds9930_*() free functions */
+apds9930_dev_t apds9930_dev_default = APDS9930_DEV_INIT(&APDS9930_DEFAULT_BUS, APDS9930_I2C_ADDR);
+
+_Static_assert((APDS9930_RING_SIZE & (APDS9930_RING_SIZE - 1)) == 0, "APDS9930_RING_SIZE must be a power of two");
+
+/* Orders ring slot accesses against the index that publishes them */
+#ifdef APDS9930_HOST_SIM
+#define APDS9930_RING_BARRIER() __sync_synchronize()
+#else
+#define APDS9930_RING_BARRIER() __DMB()
+#endif
+
+/* Power-up configuration built from the DEFAULT_* values */
+APDS9930_REGS_ASSERT(APDS9930_DEFAULT_CONFIG);
+static const apds9930_regs_t apds9930_defaultRegs = APDS9930_REGS_IMAGE(APDS9930_DEFAULT_CONFIG);
+
+/**
+ * @brief       map a register address to its shadow slot
+ * @param       address   register Address
+ * @return      shadow index, or APDS9930_SHADOW_SIZE if not shadowed
+*/
+static uint8_t apds9930_shadowIndex(uint8_t address)
+{
+    if(address <= APDS9930_CONTROL)
+        return address;
+
+    if(address == APDS9930_POFFSET)
+        return APDS9930_SHADOW_POFFSET;
+
+    return APDS9930_SHADOW_SIZE;
+}
+
+/**
+ * @brief       store a written register in the shadow
+ * @param       dev   device context
+ * @param       index   shadow slot from apds9930_shadowIndex()
+ * @param       dat   written data
+ * @return      NONE
+*/
+static void apds9930_shadowStore(apds9930_dev_t *dev, uint8_t index, uint8_t dat)
+{
+    if(index >= APDS9930_SHADOW_SIZE)
+        return;
+
+    /* Newly enabled engines restart the cycle, so move the ready deadline */
+    if(index == APDS9930_ENABLE &&
+       (dat & ~dev->shadow[APDS9930_ENABLE] & (APDS9930_PON | APDS9930_AEN | APDS9930_PEN)))
+    {
+        dev->shadow[index] = dat;
+        dev->readyTick = HAL_GetTick() +
+            (apds9930_dev_getFirstValidTimeUs(dev, APDS9930_AVALID | APDS9930_PVALID) + 999) / 1000;
+        return;
+    }
+
+    dev->shadow[index] = dat;
+}
+
+/**
+ * @brief       inside a configuration batch, take a register write into the shadow only
+ * @param       dev   device context
+ * @param       address   first register Address
+ * @param       buf   data, len bytes
+ * @param       len   number of registers
+ * @return      true if staged, false if the write has to go out now
+*/
+static bool apds9930_stage(apds9930_dev_t *dev, uint8_t address, const uint8_t *buf, uint8_t len)
+{
+    uint8_t index;
+    uint8_t i;
+
+    if(dev->cfgDepth == 0)
+        return false;
+
+    for(i = 0; i < len; i++)
+    {
+        if(apds9930_shadowIndex(address + i) >= APDS9930_SHADOW_SIZE)
+            return false;
+    }
+
+    /* Writing back what the device already holds costs nothing */
+    for(i = 0; i < len; i++)
+    {
+        index = apds9930_shadowIndex(address + i);
+        if(dev->shadow[index] != buf[i])
+        {
+            dev->cfgDirty |= 1UL << index;
+            apds9930_shadowStore(dev, index, buf[i]);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief       unpack a STATUS..PDATAH burst
+ * @param       val_byte   APDS9930_SAMPLE_LEN bytes starting at STATUS
+ * @param       sample   filled with the data of one integration cycle
+ * @return      NONE
+*/
+static void apds9930_decodeSample(const uint8_t *val_byte, apds9930_sample_t *sample)
+{
+    sample->status = val_byte[0];
+    sample->ch0 = (uint16_t)(val_byte[1] + (uint16_t)(val_byte[2] << 8));
+    sample->ch1 = (uint16_t)(val_byte[3] + (uint16_t)(val_byte[4] << 8));
+    sample->proximity = (uint16_t)(val_byte[5] + (uint16_t)(val_byte[6] << 8));
+}
+
+/**
+ * @brief       check APDS9930 Device Address
+ * @param       NONE
+ * @return      NONE
+*/
+//static void apds9930_check(void)
+//{
+//    if (i2c_CheckDevice(APDS9930_I2C_ADDR))
+//    {
+//        while (1)
+//        {
+//            HAL_GPIO_WritePin(LED_GPIO_Port, LED_Pin, GPIO_PIN_RESET);
+//            HAL_Delay(100);
+//            HAL_GPIO_WritePin(LED_GPIO_Port, LED_Pin, GPIO_PIN_SET);
+//            HAL_Delay(100);
+//        }
+//    }
+//}
+
+/**
+ * @brief       select the transport used for all register accesses
+ * @param       dev   device context
+ * @param       bus   apds9930_bus_iic, apds9930_bus_hal, apds9930_bus_sim, ...
+ * @return      NONE
+*/
+void apds9930_dev_setBus(apds9930_dev_t *dev, const apds9930_bus_t *bus)
+{
+    dev->bus = bus;
+}
+
+/**
+ * @brief       write APDS9930 register data
+ * @param       dev   device context
+ * @param       address   register Address
+ * @param       dat   write data
+ * @return      NONE
+*/
+void apds9930_dev_WriteRegData(apds9930_dev_t *dev, uint8_t address, uint8_t dat)
+{
+    if(apds9930_stage(dev, address, &dat, 1))
+        return;
+
+    apds9930_shadowStore(dev, apds9930_shadowIndex(address), dat);
+
+    dev->bus->write(dev->bus->ctx, dev->addr, REPEATED_BYTE | address, &dat, 1);
+}
+
+/**
+ * @brief Writes a single byte to the I2C device (no register)
+ *
+ * @param[in] dev device context
+ * @param[in] val the 1-byte value to write to the I2C device
+ * @return True if successful write operation. False otherwise.
+ */
+void apds9930_dev_wireWriteByte(apds9930_dev_t *dev, uint8_t val)
+{
+    dev->bus->command(dev->bus->ctx, dev->addr, val);
+}
+
+/**
+ * @brief       read APDS9930 register data
+ * @param       dev   device context
+ * @param       address   register Address
+ * @return      register data
+*/
+uint8_t apds9930_dev_readRegData(apds9930_dev_t *dev, uint8_t address)
+{
+    uint8_t recv_data;
+
+    dev->bus->read(dev->bus->ctx, dev->addr, AUTO_INCREMENT | address, &recv_data, 1);
+
+    return (uint8_t)recv_data;
+}
+
+/**
+ * @brief       write consecutive APDS9930 registers in one transaction
+ * @param       dev   device context
+ * @param       address   first register Address
+ * @param       buf   data to write, len bytes
+ * @param       len   number of registers to write
+ * @return      NONE
+*/
+void apds9930_dev_writeRegBlock(apds9930_dev_t *dev, uint8_t address, const uint8_t *buf, uint8_t len)
+{
+    uint8_t i;
+
+    if(apds9930_stage(dev, address, buf, len))
+        return;
+
+    for(i = 0; i < len; i++)
+    {
+        apds9930_shadowStore(dev, apds9930_shadowIndex(address + i), buf[i]);
+    }
+
+    dev->bus->write(dev->bus->ctx, dev->addr, AUTO_INCREMENT | address, buf, len);
+}
+
+/**
+ * @brief       open a configuration batch
+ *              Until the matching apds9930_dev_commitConfig(dev), register writes
+ *              only update the shadow and mark what changed; reads, special
+ *              function commands and the getters work as usual. Batches nest.
+ * @param       dev   device context
+ * @return      NONE
+*/
+void apds9930_dev_beginConfig(apds9930_dev_t *dev)
+{
+    if(dev->cfgDepth++ == 0)
+        dev->cfgEnable = dev->shadow[APDS9930_ENABLE];
+}
+
+/**
+ * @brief       close a configuration batch, writing what changed in as few transfers as possible
+ *              Changed registers in 0x01-0x0F go out as AUTO_INCREMENT blocks,
+ *              joined across up to APDS9930_COALESCE_GAP unchanged ones, then
+ *              POFFSET, and ENABLE last so no engine runs half-configured.
+ * @param       dev   device context
+ * @return      NONE
+*/
+void apds9930_dev_commitConfig(apds9930_dev_t *dev)
+{
+    uint32_t dirty;
+    uint8_t first;
+    uint8_t last;
+    uint8_t i;
+
+    if(dev->cfgDepth == 0 || --dev->cfgDepth != 0)
+        return;
+
+    dirty = dev->cfgDirty;
+    dev->cfgDirty = 0;
+
+    for(first = APDS9930_ATIME; first <= APDS9930_CONTROL; first = last + 1)
+    {
+        last = first;
+        if(!(dirty & (1UL << first)))
+            continue;
+
+        for(i = first + 1; i <= APDS9930_CONTROL && i - last <= APDS9930_COALESCE_GAP + 1; i++)
+        {
+            if(dirty & (1UL << i))
+                last = i;
+        }
+
+        dev->bus->write(dev->bus->ctx, dev->addr, AUTO_INCREMENT | first,
+                        &dev->shadow[first], last - first + 1);
+    }
+
+    if(dirty & (1UL << APDS9930_SHADOW_POFFSET))
+        dev->bus->write(dev->bus->ctx, dev->addr, REPEATED_BYTE | APDS9930_POFFSET,
+                        &dev->shadow[APDS9930_SHADOW_POFFSET], 1);
+
+    if(dirty & (1UL << APDS9930_ENABLE))
+    {
+        dev->bus->write(dev->bus->ctx, dev->addr, REPEATED_BYTE | APDS9930_ENABLE,
+                        &dev->shadow[APDS9930_ENABLE], 1);
+
+        /* The engines start now, with the timing written just before */
+        if(dev->shadow[APDS9930_ENABLE] & ~dev->cfgEnable & (APDS9930_PON | APDS9930_AEN | APDS9930_PEN))
+            dev->readyTick = HAL_GetTick() +
+                (apds9930_dev_getFirstValidTimeUs(dev, APDS9930_AVALID | APDS9930_PVALID) + 999) / 1000;
+    }
+}
+
+/**
+ * @brief       read consecutive APDS9930 registers in one transaction
+ * @param       dev   device context
+ * @param       address   first register Address
+ * @param       buf   receive buffer, at least len bytes
+ * @param       len   number of registers to read
+ * @return      NONE
+*/
+void apds9930_dev_readRegBlock(apds9930_dev_t *dev, uint8_t address, uint8_t *buf, uint8_t len)
+{
+    if(len == 0)
+        return;
+
+    dev->bus->read(dev->bus->ctx, dev->addr, AUTO_INCREMENT | address, buf, len);
+}
+
+/**
+ * @brief       read STATUS, Ch0, Ch1 and PDATA in a single burst
+ * @param       dev   device context
+ * @param       sample   filled with the data of one integration cycle
+ * @return      NONE
+*/
+void apds9930_dev_readSample(apds9930_dev_t *dev, apds9930_sample_t *sample)
+{
+    uint8_t val_byte[APDS9930_SAMPLE_LEN];
+
+    APDS9930_PROF_BEGIN();
+
+    apds9930_dev_readRegBlock(dev, APDS9930_STATUS, val_byte, APDS9930_SAMPLE_LEN);
+    apds9930_decodeSample(val_byte, sample);
+
+    APDS9930_PROF_END(APDS9930_PROF_READ_SAMPLE);
+}
+
+#ifdef IIC_PARALLEL
+/**
+ * @brief       burst-read STATUS..PDATAH of every sensor on a parallel bus in one transfer
+ *              all lanes share each byte time, so N sensors cost the bus time of one.
+ *              Register shadows are not involved; the sensors are addressed by lane.
+ * @param       par   parallel bus, one APDS-9930 per SDA line
+ * @param       samples   one per lane, par->n entries
+ * @return      mask of lanes that did not ACK, bit i = lane i
+*/
+uint16_t apds9930_readSampleParallel(const iic_par_t *par, apds9930_sample_t *samples)
+{
+    uint8_t val_byte[IIC_PAR_MAX][APDS9930_SAMPLE_LEN];
+    uint16_t nack;
+    uint8_t i;
+
+    nack = apds9930_bus_iic_readParallel(par, APDS9930_I2C_ADDR, AUTO_INCREMENT | APDS9930_STATUS,
+                                         val_byte[0], APDS9930_SAMPLE_LEN);
+
+    for(i = 0; i < par->n; i++)
+    {
+        apds9930_decodeSample(val_byte[i], &samples[i]);
+    }
+
+    return nack;
+}
+#endif
+
+/**
+ * @brief       get the driver's copy of a writable register, no bus access
+ * @param       dev   device context
+ * @param       address   register Address (0x00-0x0F or POFFSET)
+ * @return      register data, ERROR if the register is not shadowed
+*/
+uint8_t apds9930_dev_getRegShadow(apds9930_dev_t *dev, uint8_t address)
+{
+    uint8_t index = apds9930_shadowIndex(address);
+
+    if(index >= APDS9930_SHADOW_SIZE)
+        return ERROR;
+
+    return dev->shadow[index];
+}
+
+/**
+ * @brief       reload the register shadow from the device, e.g. after a brown-out
+ * @param       dev   device context
+ * @return      NONE
+*/
+void apds9930_dev_resync(apds9930_dev_t *dev)
+{
+    APDS9930_PROF_BEGIN();
+
+    apds9930_dev_readRegBlock(dev, APDS9930_ENABLE, dev->shadow, APDS9930_CONTROL + 1);
+    dev->shadow[APDS9930_SHADOW_POFFSET] = apds9930_dev_readRegData(dev, APDS9930_POFFSET);
+
+    APDS9930_PROF_END(APDS9930_PROF_RESYNC);
+}
+
+/**
+ * @brief       compare the register shadow against the device
+ * @param       dev   device context
+ * @return      true if the device still holds the shadowed configuration
+*/
+bool apds9930_dev_verify(apds9930_dev_t *dev)
+{
+    uint8_t regs[APDS9930_CONTROL + 1];
+    uint8_t i;
+    bool match = true;
+
+    APDS9930_PROF_BEGIN();
+
+    apds9930_dev_readRegBlock(dev, APDS9930_ENABLE, regs, APDS9930_CONTROL + 1);
+
+    for(i = 0; i <= APDS9930_CONTROL; i++)
+    {
+        if(regs[i] != dev->shadow[i])
+            match = false;
+    }
+
+    if(match)
+        match = apds9930_dev_readRegData(dev, APDS9930_POFFSET) == dev->shadow[APDS9930_SHADOW_POFFSET];
+
+    APDS9930_PROF_END(APDS9930_PROF_VERIFY);
+
+    return match;
+}
+
+/**
+ * @brief       check the ID register against the known APDS9930 IDs
+ * @param       id   ID register value
+ * @return      true for APDS9930_ID_1 or APDS9930_ID_2
+*/
+static bool apds9930_isId(uint8_t id)
+{
+    return id == APDS9930_ID_1 || id == APDS9930_ID_2;
+}
+
+/**
+ * @brief       init APDS9930 with the DEFAULT_* configuration
+ * @param       dev   device context
+ * @return      0 on success, ERROR if the ID is not an APDS9930
+*/
+uint8_t apds9930_dev_init(apds9930_dev_t *dev)
+{
+    return apds9930_dev_initRegs(dev, &apds9930_defaultRegs);
+}
+
+/**
+ * @brief       init APDS9930 from a register image
+ * @param       dev   device context
+ * @param       regs   image built with APDS9930_REGS_IMAGE()
+ * @return      0 on success, ERROR if the ID is not an APDS9930 (nothing is written)
+*/
+uint8_t apds9930_dev_initRegs(apds9930_dev_t *dev, const apds9930_regs_t *regs)
+{
+    uint8_t id_block[APDS9930_POFFSET - APDS9930_ID + 1];
+    uint8_t image[APDS9930_CONTROL + 1];
+    uint8_t i;
+
+    APDS9930_PROF_BEGIN();
+
+    /*bring up the transport*/
+    dev->bus->init(dev->bus->ctx);
+
+    /*read apds9930 id and the current POFFSET in one pass*/
+    apds9930_dev_readRegBlock(dev, APDS9930_ID, id_block, sizeof(id_block));
+    if(!apds9930_isId(id_block[0]))
+    {
+        APDS9930_PROF_END(APDS9930_PROF_INIT);
+        return ERROR;
+    }
+
+    /* Write 0x00-0x0F in one block with every feature still disabled */
+    for(i = 0; i <= APDS9930_CONTROL; i++)
+    {
+        image[i] = regs->reg[i];
+    }
+    image[APDS9930_ENABLE] = 0;
+    apds9930_dev_writeRegBlock(dev, APDS9930_ENABLE, image, APDS9930_CONTROL + 1);
+
+    dev->shadow[APDS9930_SHADOW_POFFSET] = id_block[APDS9930_POFFSET - APDS9930_ID];
+    if(regs->poffset != dev->shadow[APDS9930_SHADOW_POFFSET])
+        apds9930_dev_WriteRegData(dev, APDS9930_POFFSET, regs->poffset);
+
+    /* Start the device only once it is fully configured */
+    if(regs->reg[APDS9930_ENABLE] != 0)
+        apds9930_dev_WriteRegData(dev, APDS9930_ENABLE, regs->reg[APDS9930_ENABLE]);
+
+    APDS9930_PROF_END(APDS9930_PROF_INIT);
+    return 0;
+}
+
+/**
+ * @brief       length of the Wait state of a register image
+ * @param       reg   ENABLE..CONTROL
+ * @return      wait time in us, 0 with WEN clear
+*/
+static uint32_t apds9930_waitTimeUs(const uint8_t *reg)
+{
+    uint32_t wait_us;
+
+    if(!(reg[APDS9930_ENABLE] & APDS9930_WEN))
+        return 0;
+
+    wait_us = (uint32_t)(256 - reg[APDS9930_WTIME]) * APDS9930_STEP_US;
+    if(reg[APDS9930_CONFIG] & APDS9930_WLONG)
+        wait_us *= 12;
+
+    return wait_us;
+}
+
+/**
+ * @brief       length of one full Prox/Wait/ALS cycle of a register image
+ * @param       reg   ENABLE..CONTROL
+ * @return      cycle time in us
+*/
+static uint32_t apds9930_cycleTimeUs(const uint8_t *reg)
+{
+    uint8_t enable = reg[APDS9930_ENABLE];
+    uint32_t cycle_us = 0;
+
+    if(enable & APDS9930_PEN)
+    {
+        /* Prox Init + Prox Accum + Prox Wait + Prox ADC */
+        cycle_us += APDS9930_STEP_US
+                  + (uint32_t)reg[APDS9930_PPULSE] * APDS9930_PULSE_US
+                  + APDS9930_STEP_US
+                  + (uint32_t)(256 - reg[APDS9930_PTIME]) * APDS9930_STEP_US;
+    }
+
+    cycle_us += apds9930_waitTimeUs(reg);
+
+    if(enable & APDS9930_AEN)
+    {
+        /* ALS Init + ALS ADC */
+        cycle_us += APDS9930_STEP_US
+                  + (uint32_t)(256 - reg[APDS9930_ATIME]) * APDS9930_STEP_US;
+    }
+
+    return cycle_us;
+}
+
+/**
+ * @brief       length of one full Prox/Wait/ALS cycle for the shadowed settings
+ * @param       dev   device context
+ * @return      cycle time in us
+*/
+uint32_t apds9930_dev_getCycleTimeUs(apds9930_dev_t *dev)
+{
+    return apds9930_cycleTimeUs(dev->shadow);
+}
+
+/**
+ * @brief       time from enabling the engines until the requested data is valid
+ * @param       dev   device context
+ * @param       valid_mask   APDS9930_AVALID and/or APDS9930_PVALID
+ * @return      time in us, 0 if none of the requested engines is enabled
+*/
+uint32_t apds9930_dev_getFirstValidTimeUs(apds9930_dev_t *dev, uint8_t valid_mask)
+{
+    uint8_t enable = dev->shadow[APDS9930_ENABLE];
+
+    /* ALS completes last in the Prox, Wait, ALS sequence */
+    if((valid_mask & APDS9930_AVALID) && (enable & APDS9930_AEN))
+        return apds9930_dev_getCycleTimeUs(dev);
+
+    if((valid_mask & APDS9930_PVALID) && (enable & APDS9930_PEN))
+        return 3 * APDS9930_STEP_US
+             + (uint32_t)dev->shadow[APDS9930_PPULSE] * APDS9930_PULSE_US
+             + (uint32_t)(256 - dev->shadow[APDS9930_PTIME]) * APDS9930_STEP_US;
+
+    return 0;
+}
+
+/**
+ * @brief       HAL tick at which the first enabled conversion should be valid
+ * @param       dev   device context
+ * @return      deadline in HAL ticks (ms)
+*/
+uint32_t apds9930_dev_getReadyTick(apds9930_dev_t *dev)
+{
+    return dev->readyTick;
+}
+
+/**
+ * @brief       wait for the first valid conversion after enabling the device
+ * @param       dev   device context
+ * @param       valid_mask   APDS9930_AVALID and/or APDS9930_PVALID
+ * @param       timeout_ms   give up this long after the computed deadline
+ * @return      true once every requested valid bit is set
+*/
+bool apds9930_dev_waitReady(apds9930_dev_t *dev, uint8_t valid_mask, uint32_t timeout_ms)
+{
+    uint32_t now = HAL_GetTick();
+    bool ready;
+
+    APDS9930_PROF_BEGIN();
+
+    /* No bus traffic until the conversion can possibly be done */
+    if((int32_t)(dev->readyTick - now) > 0)
+        HAL_Delay(dev->readyTick - now);
+
+    now = HAL_GetTick();
+    do
+    {
+        ready = (apds9930_dev_readRegData(dev, APDS9930_STATUS) & valid_mask) == valid_mask;
+    } while(!ready && HAL_GetTick() - now <= timeout_ms);
+
+    APDS9930_PROF_END(APDS9930_PROF_WAIT_READY);
+
+    return ready;
+}
+
+/**
+ * @brief       microsecond time for the read scheduler
+ * @param       NONE
+ * @return      us, wraps after about 71 minutes
+*/
+static uint32_t apds9930_nowUs(void)
+{
+#ifdef APDS9930_HOST_SIM
+    return (uint32_t)(apds9930_sim_now() / 1000);
+#else
+    uint32_t ms;
+    uint32_t val;
+
+    /* SysTick counts down from LOAD within each HAL tick */
+    do
+    {
+        ms = HAL_GetTick();
+        val = SysTick->VAL;
+    } while(ms != HAL_GetTick());
+
+    return ms * 1000 + (SysTick->LOAD - val) * 1000 / (SysTick->LOAD + 1);
+#endif
+}
+
+/**
+ * @brief       read once per conversion from now on
+ *              The enabled engines are restarted so the end of every
+ *              conversion is known from the shadowed ATIME/PTIME/WTIME/WLONG;
+ *              apds9930_dev_pollSample(dev) then only touches the bus once one
+ *              is due. Call again after changing the timing registers.
+ * @param       dev   device context
+ * @param       valid_mask   APDS9930_AVALID and/or APDS9930_PVALID a sample needs
+ * @return      NONE
+*/
+void apds9930_dev_startSchedule(apds9930_dev_t *dev, uint8_t valid_mask)
+{
+    uint8_t enable = dev->shadow[APDS9930_ENABLE];
+    apds9930_sched_stats_t empty = {0};
+
+    /* Stopping the engines clears the valid bits and the cycle restarts on enable */
+    apds9930_dev_WriteRegData(dev, APDS9930_ENABLE, enable & ~(APDS9930_AEN | APDS9930_PEN | APDS9930_WEN));
+    apds9930_dev_WriteRegData(dev, APDS9930_ENABLE, enable);
+
+    dev->schedStart = apds9930_nowUs();
+    dev->schedDue = dev->schedStart + apds9930_dev_getFirstValidTimeUs(dev, valid_mask) + APDS9930_SCHED_GUARD_US;
+    dev->schedRetry = dev->schedDue;
+    dev->schedMask = valid_mask;
+    dev->sched = empty;
+    dev->sched.lat_min_us = UINT32_MAX;
+}
+
+/**
+ * @brief       stop scheduled reads, apds9930_dev_pollSample(dev) returns false afterwards
+ * @param       dev   device context
+ * @return      NONE
+*/
+void apds9930_dev_stopSchedule(apds9930_dev_t *dev)
+{
+    dev->schedMask = 0;
+}
+
+/**
+ * @brief       read the sample of a conversion that has finished since the last call
+ *              Cheap to call from a busy loop: before the next conversion is
+ *              due it returns at once without bus access. Once due, a single
+ *              STATUS+data burst is read; if the valid bits are not set yet
+ *              it is retried one ADC step later.
+ * @param       dev   device context
+ * @param       sample   filled in when true is returned
+ * @return      true if sample holds a conversion not returned before
+*/
+bool apds9930_dev_pollSample(apds9930_dev_t *dev, apds9930_sample_t *sample)
+{
+    uint32_t now = apds9930_nowUs();
+    uint32_t cycle_us = apds9930_dev_getCycleTimeUs(dev);
+    uint32_t late;
+    uint32_t skipped;
+
+    if(dev->schedMask == 0 || cycle_us == 0)
+        return false;
+
+    if((int32_t)(now - dev->schedRetry) < 0)
+    {
+        dev->sched.avoided++;
+        return false;
+    }
+
+    apds9930_dev_readSample(dev, sample);
+    dev->sched.reads++;
+
+    /* Retry one ADC step later, the next conversion stays on the cycle grid */
+    if((sample->status & dev->schedMask) != dev->schedMask)
+    {
+        dev->sched.early++;
+        dev->schedRetry = now + APDS9930_STEP_US;
+        return false;
+    }
+
+    /* Conversions that ended while nobody polled are gone */
+    late = now - dev->schedDue;
+    skipped = late / cycle_us;
+    late -= skipped * cycle_us;
+    dev->sched.missed += skipped;
+    dev->schedDue += (skipped + 1) * cycle_us;
+    dev->schedRetry = dev->schedDue;
+
+    late += APDS9930_SCHED_GUARD_US;
+    if(late < dev->sched.lat_min_us)
+        dev->sched.lat_min_us = late;
+    if(late > dev->sched.lat_max_us)
+        dev->sched.lat_max_us = late;
+    dev->sched.fresh++;
+
+    return true;
+}
+
+/**
+ * @brief       counters of the scheduled reads since apds9930_dev_startSchedule(dev)
+ * @param       dev   device context
+ * @param       stats   filled in, rate_mhz computed for the time elapsed so far
+ * @return      NONE
+*/
+void apds9930_dev_getScheduleStats(apds9930_dev_t *dev, apds9930_sched_stats_t *stats)
+{
+    uint32_t elapsed_us = apds9930_nowUs() - dev->schedStart;
+
+    *stats = dev->sched;
+    stats->rate_mhz = elapsed_us ? (uint32_t)((uint64_t)dev->sched.fresh * 1000000000ULL / elapsed_us) : 0;
+    if(stats->fresh == 0)
+        stats->lat_min_us = 0;
+}
+
+/**
+ * @brief       supply charge of one cycle of a register image, MCU read included
+ * @param       reg   ENABLE..CONTROL
+ * @return      charge in fC (nA * us)
+*/
+static uint64_t apds9930_cycleChargeFc(const uint8_t *reg)
+{
+    uint32_t cycle_us = apds9930_cycleTimeUs(reg);
+    uint32_t wait_us = apds9930_waitTimeUs(reg);
+    uint64_t charge_fc;
+    uint32_t led_na;
+
+    if(cycle_us == 0)
+        return 0;
+
+    charge_fc = (uint64_t)(cycle_us - wait_us) * APDS9930_IDD_ACTIVE_NA
+              + (uint64_t)wait_us * APDS9930_IDD_WAIT_NA;
+
+    /* The LED sink and the LDR current flow for the on time of each pulse */
+    if(reg[APDS9930_ENABLE] & APDS9930_PEN)
+    {
+        led_na = (APDS9930_LED_DRIVE_NA >> (reg[APDS9930_CONTROL] >> 6)) + APDS9930_IDD_LDR_NA
+               - APDS9930_IDD_ACTIVE_NA;
+        charge_fc += (uint64_t)reg[APDS9930_PPULSE] * led_na * APDS9930_LED_ON_NS / 1000;
+    }
+
+    return charge_fc + (uint64_t)APDS9930_MCU_RUN_NA * APDS9930_MCU_SAMPLE_US;
+}
+
+/**
+ * @brief       fill in the settings and estimate of a register image
+ * @param       reg   ENABLE..CONTROL
+ * @param       plan   filled in
+ * @return      NONE
+*/
+static void apds9930_powerEstimate(const uint8_t *reg, apds9930_power_t *plan)
+{
+    uint32_t cycle_us = apds9930_cycleTimeUs(reg);
+    uint64_t charge_fc = apds9930_cycleChargeFc(reg);
+    uint64_t mcu_fc = (uint64_t)APDS9930_MCU_RUN_NA * APDS9930_MCU_SAMPLE_US;
+
+    plan->enable = reg[APDS9930_ENABLE];
+    plan->atime = reg[APDS9930_ATIME];
+    plan->ptime = reg[APDS9930_PTIME];
+    plan->wtime = reg[APDS9930_WTIME];
+    plan->config = reg[APDS9930_CONFIG];
+    plan->ppulse = reg[APDS9930_PPULSE];
+    plan->period_us = cycle_us;
+
+    if(cycle_us == 0)
+    {
+        plan->rate_mhz = 0;
+        plan->sensor_na = 0;
+        plan->mcu_na = 0;
+        plan->sample_nj = 0;
+        return;
+    }
+
+    plan->rate_mhz = 1000000000UL / cycle_us;
+    plan->sensor_na = (uint32_t)((charge_fc - mcu_fc) / cycle_us);
+    plan->mcu_na = (uint32_t)(mcu_fc / cycle_us);
+    plan->sample_nj = (uint32_t)(charge_fc * APDS9930_VDD_MV / 1000000000ULL);
+}
+
+/**
+ * @brief       register image of a plan without the Wait state
+ * @param       dev   device context, supplies every field the plan keeps
+ * @param       reg   APDS9930_SHADOW_SIZE bytes, filled in
+ * @param       engines   APDS9930_AEN and/or APDS9930_PEN, plus APDS9930_AIEN/APDS9930_PIEN
+ * @return      conversion time in us, 0 without an engine
+*/
+static uint32_t apds9930_planImage(apds9930_dev_t *dev, uint8_t *reg, uint8_t engines)
+{
+    uint8_t i;
+
+    for(i = 0; i < APDS9930_SHADOW_SIZE; i++)
+    {
+        reg[i] = dev->shadow[i];
+    }
+
+    engines &= APDS9930_AEN | APDS9930_PEN | APDS9930_AIEN | APDS9930_PIEN;
+    reg[APDS9930_ENABLE] = APDS9930_PON | engines;
+    if(engines & (APDS9930_AIEN | APDS9930_PIEN))
+        reg[APDS9930_ENABLE] |= APDS9930_SAI;
+    reg[APDS9930_CONFIG] &= ~APDS9930_WLONG;
+
+    return apds9930_cycleTimeUs(reg);
+}
+
+/**
+ * @brief       add the Wait state that stretches a plan by wait_us
+ * @param       reg   image from apds9930_planImage()
+ * @param       wait_us   time to fill
+ * @param       round_up   true to wait at least wait_us, false at most
+ * @return      NONE
+*/
+static void apds9930_planWait(uint8_t *reg, uint32_t wait_us, bool round_up)
+{
+    uint32_t step_us = APDS9930_STEP_US;
+    uint32_t steps;
+
+    /* WLONG only once the 256 normal steps run out, it is 12x coarser */
+    if(wait_us > 256UL * APDS9930_STEP_US)
+    {
+        reg[APDS9930_CONFIG] |= APDS9930_WLONG;
+        step_us *= 12;
+    }
+
+    steps = round_up ? (wait_us + step_us - 1) / step_us : wait_us / step_us;
+    if(steps > 256)
+        steps = 256;
+
+    if(steps > 0)
+    {
+        reg[APDS9930_ENABLE] |= APDS9930_WEN;
+        reg[APDS9930_WTIME] = (uint8_t)(256 - steps);
+    }
+}
+
+/**
+ * @brief       plan a duty cycle that samples at least at a given rate
+ *              The Wait state fills the time between conversions. ATIME,
+ *              PTIME and PPULSE are kept from the shadow, except that ATIME
+ *              is shortened when the ALS integration alone is too long for
+ *              the rate. With an interrupt enable in engines, SAI is set
+ *              too: the device then sleeps once it raises INT until the
+ *              interrupt is cleared, and draws less than estimated.
+ * @param       dev   device context
+ * @param       plan   settings for apds9930_dev_applyPowerPlan(dev) and their estimate
+ * @param       engines   APDS9930_AEN and/or APDS9930_PEN, plus APDS9930_AIEN/APDS9930_PIEN
+ * @param       rate_mhz   samples per 1000 s
+ * @return      false if the rate cannot be reached, plan then holds the fastest cycle
+*/
+bool apds9930_dev_planPowerForRate(apds9930_dev_t *dev, apds9930_power_t *plan, uint8_t engines, uint32_t rate_mhz)
+{
+    uint8_t reg[APDS9930_SHADOW_SIZE];
+    uint32_t period_us = rate_mhz ? 1000000000UL / rate_mhz : UINT32_MAX;
+    uint32_t conv_us = apds9930_planImage(dev, reg, engines);
+    uint32_t other_us;
+    uint32_t steps;
+
+    if(conv_us > period_us && (engines & APDS9930_AEN))
+    {
+        other_us = conv_us - (uint32_t)(256 - reg[APDS9930_ATIME]) * APDS9930_STEP_US;
+        steps = period_us > other_us ? (period_us - other_us) / APDS9930_STEP_US : 0;
+        reg[APDS9930_ATIME] = (uint8_t)(256 - (steps ? steps : 1));
+        conv_us = apds9930_cycleTimeUs(reg);
+    }
+
+    if(conv_us != 0 && conv_us <= period_us)
+        apds9930_planWait(reg, period_us - conv_us, false);
+
+    apds9930_powerEstimate(reg, plan);
+
+    return conv_us != 0 && conv_us <= period_us;
+}
+
+/**
+ * @brief       plan the fastest duty cycle within a supply current budget
+ *              The conversion settings are kept from the shadow, only the
+ *              Wait state is chosen, so the average can never drop below
+ *              APDS9930_IDD_WAIT_NA. SAI as in apds9930_dev_planPowerForRate(dev).
+ * @param       dev   device context
+ * @param       plan   settings for apds9930_dev_applyPowerPlan(dev) and their estimate
+ * @param       engines   APDS9930_AEN and/or APDS9930_PEN, plus APDS9930_AIEN/APDS9930_PIEN
+ * @param       budget_na   average sensor plus MCU current in nA
+ * @return      false if the budget cannot be met, plan then holds the longest cycle
+*/
+bool apds9930_dev_planPowerForCurrent(apds9930_dev_t *dev, apds9930_power_t *plan, uint8_t engines, uint32_t budget_na)
+{
+    uint8_t reg[APDS9930_SHADOW_SIZE];
+    uint32_t conv_us = apds9930_planImage(dev, reg, engines);
+    uint64_t charge_fc = apds9930_cycleChargeFc(reg);
+    uint64_t period_us;
+
+    if(conv_us == 0)
+    {
+        apds9930_powerEstimate(reg, plan);
+        return false;
+    }
+
+    /* Average over period T: (Q + Iwait * (T - conv)) / T <= budget */
+    if(charge_fc > (uint64_t)budget_na * conv_us)
+    {
+        if(budget_na > APDS9930_IDD_WAIT_NA)
+            period_us = (charge_fc - (uint64_t)APDS9930_IDD_WAIT_NA * conv_us) / (budget_na - APDS9930_IDD_WAIT_NA) + 1;
+        else
+            period_us = UINT32_MAX;
+
+        if(period_us > UINT32_MAX)
+            period_us = UINT32_MAX;
+
+        apds9930_planWait(reg, (uint32_t)period_us - conv_us, true);
+    }
+
+    apds9930_powerEstimate(reg, plan);
+
+    return plan->sensor_na + plan->mcu_na <= budget_na;
+}
+
+/**
+ * @brief       estimate the supply current of the shadowed settings
+ * @param       dev   device context
+ * @param       plan   filled in with the current settings
+ * @return      NONE
+*/
+void apds9930_dev_getPowerEstimate(apds9930_dev_t *dev, apds9930_power_t *plan)
+{
+    apds9930_powerEstimate(dev->shadow, plan);
+}
+
+/**
+ * @brief       write a plan in one configuration batch, ENABLE last
+ *              The new timing also moves the schedule of
+ *              apds9930_dev_startSchedule(dev), call it again afterwards.
+ * @param       dev   device context
+ * @param       plan   from apds9930_dev_planPowerForRate(dev) or apds9930_dev_planPowerForCurrent(dev)
+ * @return      NONE
+*/
+void apds9930_dev_applyPowerPlan(apds9930_dev_t *dev, const apds9930_power_t *plan)
+{
+    apds9930_dev_beginConfig(dev);
+
+    apds9930_dev_WriteRegData(dev, APDS9930_ATIME, plan->atime);
+    apds9930_dev_WriteRegData(dev, APDS9930_PTIME, plan->ptime);
+    apds9930_dev_WriteRegData(dev, APDS9930_WTIME, plan->wtime);
+    apds9930_dev_WriteRegData(dev, APDS9930_CONFIG, plan->config);
+    apds9930_dev_WriteRegData(dev, APDS9930_PPULSE, plan->ppulse);
+    apds9930_dev_WriteRegData(dev, APDS9930_ENABLE, plan->enable);
+
+    apds9930_dev_commitConfig(dev);
+}
+
+/**
+ * @brief       read APDS9930   Mode
+ * @param       dev   device context
+ * @return      enable_value
+*/
+uint8_t apds9930_dev_getMode(apds9930_dev_t *dev)
+{
+    return dev->shadow[APDS9930_ENABLE];
+}
+
+/**
+ * @brief       set APDS9930 mode
+ * @param       dev   device context
+ * @param       mode which feature to enable
+ * @param       enable ON (1) or OFF (0)
+ * @return      enable_value
+*/
+void apds9930_dev_setMode(apds9930_dev_t *dev, uint8_t mode, uint8_t enable)
+{
+    uint8_t reg_val;
+
+    APDS9930_PROF_BEGIN();
+
+    reg_val = apds9930_dev_getMode(dev);
+
+    enable = enable & 0x01;
+
+    if(mode <= 6)
+    {
+        if(enable){
+            reg_val |= (1<<mode);
+        }else{
+            reg_val &= ~(1<<mode);
+        }
+    } else if(mode == ALL)
+    {
+        if(enable){
+            reg_val = 0x7F;
+        } else {
+            reg_val = 0x00;
+        }
+    }
+
+    apds9930_dev_WriteRegData(dev, APDS9930_ENABLE,reg_val);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_MODE);
+}
+
+/**
+ * @brief       Starts the light (Ambient/IR) sensor on the APDS-9930
+ * @param       dev   device context
+ * @param       interrupts true to enable hardware interrupt on high or low lighte
+ * @return      NONE
+*/
+void apds9930_dev_enableLightSensor(apds9930_dev_t *dev, bool interrupts)
+{
+    APDS9930_PROF_BEGIN();
+
+    apds9930_dev_beginConfig(dev);
+
+    apds9930_dev_setAmbientLightGain(dev, DEFAULT_AGAIN);
+
+    if(interrupts){
+        apds9930_dev_setAmbientLightIntEnable(dev, 1);
+    } else {
+        apds9930_dev_setAmbientLightIntEnable(dev, 0);
+    }
+
+    apds9930_dev_enablePower(dev);
+
+    apds9930_dev_setMode(dev, AMBIENT_LIGHT,1);
+
+    apds9930_dev_commitConfig(dev);
+
+    APDS9930_PROF_END(APDS9930_PROF_ENABLE_LIGHT);
+}
+
+/**
+ * @brief       Ends the light sensor on the APDS-9930
+ * @param       dev   device context
+ * @return      NONE
+*/
+void apds9930_dev_disableLightSensor(apds9930_dev_t *dev)
+{
+    APDS9930_PROF_BEGIN();
+
+    apds9930_dev_beginConfig(dev);
+
+    apds9930_dev_setAmbientLightIntEnable(dev, 0);
+
+    apds9930_dev_setMode(dev, AMBIENT_LIGHT,0);
+
+    apds9930_dev_commitConfig(dev);
+
+    APDS9930_PROF_END(APDS9930_PROF_DISABLE_LIGHT);
+}
+
+
+/**
+ * @brief       Ends the light sensor on the APDS-9930
+ * @param       dev   device context
+ * @return      NONE
+*/
+uint8_t apds9930_dev_getAmbientLightGain(apds9930_dev_t *dev)
+{
+    uint8_t val;
+
+    val = dev->shadow[APDS9930_CONTROL];
+
+    val &= 0x03;
+
+    return val;
+}
+
+
+/**
+ * @brief       read APDS9930   Ch0 light
+ * @param       dev   device context
+ * @return      light
+*/
+uint16_t apds9930_dev_readCh0Light(apds9930_dev_t *dev)
+{
+    uint8_t val_byte[2];
+
+    APDS9930_PROF_BEGIN();
+
+    apds9930_dev_readRegBlock(dev, APDS9930_Ch0DATAL, val_byte, 2);
+
+    APDS9930_PROF_END(APDS9930_PROF_READ_CH0);
+
+    return (uint16_t)((val_byte[0]) + (uint16_t)(val_byte[1]*256));
+}
+
+/**
+ * @brief       read APDS9930   Ch1 light
+ * @param       dev   device context
+ * @return      light
+*/
+uint16_t apds9930_dev_readCh1Light(apds9930_dev_t *dev)
+{
+    uint8_t val_byte[2];
+
+    APDS9930_PROF_BEGIN();
+
+    apds9930_dev_readRegBlock(dev, APDS9930_Ch1DATAL, val_byte, 2);
+
+    APDS9930_PROF_END(APDS9930_PROF_READ_CH1);
+
+    return (uint16_t)((val_byte[0]) + (uint16_t)(val_byte[1]*256));
+}
+
+/**
+ * @brief       read APDS9930   Proximity
+ * @param       dev   device context
+ * @return      Proximity
+*/
+uint16_t apds9930_dev_readProximity(apds9930_dev_t *dev)
+{
+    uint8_t val_byte[2];
+
+    APDS9930_PROF_BEGIN();
+
+    apds9930_dev_readRegBlock(dev, APDS9930_PDATAL, val_byte, 2);
+
+    APDS9930_PROF_END(APDS9930_PROF_READ_PROXIMITY);
+
+    return (uint16_t)((val_byte[0]) + (uint16_t)(val_byte[1]*256));
+}
+
+/**
+ * @brief       Sets the low threshold for ambient light interrupts
+ * @param       dev   device context
+ * @param       threshold  interrupts threshold
+ * @return      NONE
+*/
+void apds9930_dev_setLightIntLowThreshold(apds9930_dev_t *dev, uint16_t threshold)
+{
+    uint8_t val_low;
+    uint8_t val_high;
+
+    APDS9930_PROF_BEGIN();
+
+    val_low = threshold & 0x00FF;
+    val_high = (threshold & 0xFF00) >> 8;
+    
+
+    apds9930_dev_beginConfig(dev);
+    apds9930_dev_WriteRegData(dev, APDS9930_AILTL, val_low);
+    apds9930_dev_WriteRegData(dev, APDS9930_AILTH, val_high);
+    apds9930_dev_commitConfig(dev);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_LIGHT_THRESHOLD);
+}
+
+/**
+ * @brief       Sets the high threshold for ambient light interrupts
+ * @param       dev   device context
+ * @param       threshold  interrupts threshold
+ * @return      NONE
+*/
+void apds9930_dev_setLightIntHighThreshold(apds9930_dev_t *dev, uint16_t threshold)
+{
+    uint8_t val_low;
+    uint8_t val_high;
+
+    APDS9930_PROF_BEGIN();
+
+    val_low = (threshold & 0x00FF);
+    val_high = (threshold & 0xFF00) >> 8;
+
+    apds9930_dev_beginConfig(dev);
+    apds9930_dev_WriteRegData(dev, APDS9930_AIHTL, val_low);
+    apds9930_dev_WriteRegData(dev, APDS9930_AIHTH, val_high);
+    apds9930_dev_commitConfig(dev);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_LIGHT_THRESHOLD);
+}
+
+/**
+ * @brief       Sets both ambient light thresholds in one block write
+ * @param       dev   device context
+ * @param       low   AILT, interrupt when Ch0 falls below
+ * @param       high   AIHT, interrupt when Ch0 rises above
+ * @return      NONE
+*/
+void apds9930_dev_setLightIntWindow(apds9930_dev_t *dev, uint16_t low, uint16_t high)
+{
+    uint8_t val_byte[4];
+
+    APDS9930_PROF_BEGIN();
+
+    val_byte[0] = low & 0x00FF;
+    val_byte[1] = (low & 0xFF00) >> 8;
+    val_byte[2] = high & 0x00FF;
+    val_byte[3] = (high & 0xFF00) >> 8;
+
+    apds9930_dev_writeRegBlock(dev, APDS9930_AILTL, val_byte, 4);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_LIGHT_WINDOW);
+}
+
+/**
+ * @brief       re-centre the ALS window on a Ch0 reading
+ *              The half-width is the tracking band of ch0, at least
+ *              APDS9930_TRACK_MIN_COUNTS, so INT only fires once Ch0 moves
+ *              by more than the band for APERS consecutive cycles.
+ * @param       dev   device context
+ * @param       ch0   latest Ch0 counts
+ * @return      NONE
+*/
+void apds9930_dev_trackLight(apds9930_dev_t *dev, uint16_t ch0)
+{
+    uint32_t delta = (uint32_t)ch0 * dev->trackBand / 100;
+    uint32_t low;
+    uint32_t high;
+
+    if(delta < APDS9930_TRACK_MIN_COUNTS)
+        delta = APDS9930_TRACK_MIN_COUNTS;
+
+    low = ch0 > delta ? ch0 - delta : 0;
+    high = ch0 + delta < 0xFFFF ? ch0 + delta : 0xFFFF;
+
+    apds9930_dev_setLightIntWindow(dev, (uint16_t)low, (uint16_t)high);
+}
+
+/* Gain multiplier of each AGAIN setting */
+static const uint8_t apds9930_againX[4] = {1, 8, 16, 120};
+
+/* LPC of the default integration time, folded at compile time */
+static const uint32_t apds9930_lpcDefault[4] = {
+    APDS9930_LPC_Q16(DEFAULT_ATIME, 1),
+    APDS9930_LPC_Q16(DEFAULT_ATIME, 8),
+    APDS9930_LPC_Q16(DEFAULT_ATIME, 16),
+    APDS9930_LPC_Q16(DEFAULT_ATIME, 120)
+};
+
+/**
+ * @brief       lux-per-count factor of an ALS configuration
+ * @param       again   AGAIN setting (AGAIN_1X..AGAIN_120X)
+ * @param       atime   ATIME register value
+ * @return      LPC in Q16 mlux per count
+*/
+uint32_t apds9930_getLpcQ16(uint8_t again, uint8_t atime)
+{
+    again &= 0x03;
+
+    if(atime == DEFAULT_ATIME)
+        return apds9930_lpcDefault[again];
+
+    return APDS9930_LPC_Q16_NUM / ((256UL - atime) * apds9930_againX[again]);
+}
+
+/**
+ * @brief       integer lux from raw channel counts and a precomputed LPC
+ *              IAC in Q14, one 32x32->64 multiply, no float. Error against
+ *              the exact formula is at most 0.5 mlux + 2.6e-5 * (ch0 + ch1)
+ *              counts of IAC, from the Q14 rounding of ALS_C/ALS_D; that is
+ *              below the precision of the datasheet coefficients themselves.
+ * @param       ch0   Ch0 counts
+ * @param       ch1   Ch1 counts
+ * @param       lpc   apds9930_getLpcQ16() of the configuration
+ * @return      illuminance in mlux
+*/
+uint32_t apds9930_scaleMilliLux(uint16_t ch0, uint16_t ch1, uint32_t lpc)
+{
+    int32_t iac;
+    int32_t iac_alt;
+
+    iac = ((int32_t)ch0 << 14) - (int32_t)ALS_B_Q14 * ch1;
+    iac_alt = (int32_t)ALS_C_Q14 * ch0 - (int32_t)ALS_D_Q14 * ch1;
+    if(iac_alt > iac)
+        iac = iac_alt;
+
+    if(iac <= 0)
+        return 0;
+
+    /* Q14 * Q16 -> Q30, rounded */
+    return (uint32_t)(((uint64_t)(uint32_t)iac * lpc + (1UL << 29)) >> 30);
+}
+
+/**
+ * @brief       integer lux from raw channel counts
+ * @param       ch0   Ch0 counts
+ * @param       ch1   Ch1 counts
+ * @param       again   AGAIN setting (AGAIN_1X..AGAIN_120X)
+ * @param       atime   ATIME register value
+ * @return      illuminance in mlux
+*/
+uint32_t apds9930_calcMilliLux(uint16_t ch0, uint16_t ch1, uint8_t again, uint8_t atime)
+{
+    return apds9930_scaleMilliLux(ch0, ch1, apds9930_getLpcQ16(again, atime));
+}
+
+#ifdef APDS9930_FLOAT_LUX
+/**
+ * @brief       floating-point reference of apds9930_calcMilliLux()
+ * @param       ch0   Ch0 counts
+ * @param       ch1   Ch1 counts
+ * @param       again   AGAIN setting (AGAIN_1X..AGAIN_120X)
+ * @param       atime   ATIME register value
+ * @return      illuminance in lux
+*/
+float apds9930_calcLux(uint16_t ch0, uint16_t ch1, uint8_t again, uint8_t atime)
+{
+    float ALSIT = 2.73f * (256 - atime);
+    float iac;
+    float lpc;
+
+    if ((ch0 - ALS_B * ch1) > (ALS_C * ch0 - ALS_D * ch1))
+    {
+        iac = ch0 - ALS_B * ch1;
+    }
+    else
+    {
+        iac = ALS_C * ch0 - ALS_D * ch1;
+    }
+
+    if (iac < 0)
+        iac = 0;
+
+    lpc = (GA * DF) / (ALSIT * apds9930_againX[again & 0x03]);
+
+    return iac * lpc;
+}
+#endif
+
+/**
+ * @brief       Reads the ambient light level and converts it to mlux
+ * @param       dev   device context
+ * @return      illuminance in mlux at the current ATIME and AGAIN
+*/
+uint32_t apds9930_dev_readAmbientLightMilliLux(apds9930_dev_t *dev)
+{
+    apds9930_sample_t sample;
+
+    APDS9930_PROF_BEGIN();
+
+    apds9930_dev_readSample(dev, &sample);
+
+    APDS9930_PROF_END(APDS9930_PROF_READ_LUX);
+
+    return apds9930_calcMilliLux(sample.ch0, sample.ch1,
+                                 apds9930_dev_getAmbientLightGain(dev),
+                                 dev->shadow[APDS9930_ATIME]);
+}
+
+/**
+ * @brief       get light
+ *              Legacy float interface; the multiply pulls soft-float into a
+ *              build without an FPU, apds9930_dev_readAmbientLightMilliLux()
+ *              returns the same reading without it.
+ * @param       dev   device context
+ * @param       light_gain   unused, the gain in CONTROL is used
+ * @return      light value in lux
+*/
+float apds9930_dev_readAmbientLightLux(apds9930_dev_t *dev, uint8_t light_gain)
+{
+    (void)light_gain;
+    return apds9930_dev_readAmbientLightMilliLux(dev) * 0.001f;
+}
+
+/* ALS configuration of one auto-ranging step */
+typedef struct {
+    uint8_t  again;
+    uint8_t  agl;               /* AGL set: gain scaled by 0.16 */
+    uint8_t  atime;
+    uint32_t sens;              /* gain x 100 x integration steps */
+} apds9930_range_t;
+
+/* Neighbouring ranges are at most 8x apart, the top one trades time for counts */
+static const apds9930_range_t apds9930_ranges[APDS9930_RANGE_COUNT] = {
+    { AGAIN_1X,   1, DEFAULT_ATIME, 16UL * (256 - DEFAULT_ATIME) },
+    { AGAIN_1X,   0, DEFAULT_ATIME, 100UL * (256 - DEFAULT_ATIME) },
+    { AGAIN_8X,   0, DEFAULT_ATIME, 800UL * (256 - DEFAULT_ATIME) },
+    { AGAIN_16X,  0, DEFAULT_ATIME, 1600UL * (256 - DEFAULT_ATIME) },
+    { AGAIN_120X, 0, DEFAULT_ATIME, 12000UL * (256 - DEFAULT_ATIME) },
+    { AGAIN_120X, 0, 0xC0,          12000UL * (256 - 0xC0) },
+};
+
+/**
+ * @brief       full-scale Ch0/Ch1 count of an integration time
+ * @param       atime   ATIME register value
+ * @return      counts
+*/
+static uint16_t apds9930_alsMaxCount(uint8_t atime)
+{
+    uint32_t max = 1024UL * (256 - atime) - 1;
+
+    return max > 0xFFFF ? 0xFFFF : (uint16_t)max;
+}
+
+/**
+ * @brief       program ATIME, AGL and AGAIN of an auto-ranging step
+ *              only registers that change are written; the next sample
+ *              may straddle the change and is discarded by apds9930_dev_autoRange(dev)
+ * @param       dev   device context
+ * @param       range   0 (least sensitive) .. APDS9930_RANGE_COUNT-1
+ * @return      NONE
+*/
+void apds9930_dev_setRange(apds9930_dev_t *dev, uint8_t range)
+{
+    const apds9930_range_t *r;
+    uint8_t val;
+
+    if(range >= APDS9930_RANGE_COUNT)
+        range = APDS9930_RANGE_COUNT - 1;
+    r = &apds9930_ranges[range];
+
+    if(dev->shadow[APDS9930_ATIME] != r->atime)
+        apds9930_dev_WriteRegData(dev, APDS9930_ATIME, r->atime);
+
+    /* AGL is only legal at 1x/8x: leave it before raising AGAIN, set it after */
+    val = r->agl ? (dev->shadow[APDS9930_CONFIG] | APDS9930_AGL) : (dev->shadow[APDS9930_CONFIG] & ~APDS9930_AGL);
+    if(!r->agl && val != dev->shadow[APDS9930_CONFIG])
+        apds9930_dev_WriteRegData(dev, APDS9930_CONFIG, val);
+
+    if(apds9930_dev_getAmbientLightGain(dev) != r->again)
+        apds9930_dev_setAmbientLightGain(dev, r->again);
+
+    if(r->agl && val != dev->shadow[APDS9930_CONFIG])
+        apds9930_dev_WriteRegData(dev, APDS9930_CONFIG, val);
+
+    dev->range = range;
+    dev->rangeSettle = 1;
+}
+
+/**
+ * @brief       current auto-ranging step
+ * @param       dev   device context
+ * @return      range index
+*/
+uint8_t apds9930_dev_getRange(apds9930_dev_t *dev)
+{
+    return dev->range;
+}
+
+/**
+ * @brief       feed one ALS sample to the auto-ranging controller
+ *              Saturation jumps straight to range 0; otherwise the range
+ *              steps down above APDS9930_RANGE_HIGH_PCT of full scale and
+ *              jumps up to the most sensitive range predicted to stay under
+ *              APDS9930_RANGE_LOW_PCT. After a light change the controller
+ *              makes at most two changes, each costing the straddling sample
+ *              plus one measurement, so a reading comes within five cycles.
+ * @param       dev   device context
+ * @param       sample   sample read at the current range
+ * @param       mlux   illuminance normalised for the range, set when true is returned
+ * @return      true if the sample was usable; false if discarded, the range
+ *              changed, or range 0 is saturated
+*/
+bool apds9930_dev_autoRange(apds9930_dev_t *dev, const apds9930_sample_t *sample, uint32_t *mlux)
+{
+    const apds9930_range_t *cur = &apds9930_ranges[dev->range];
+    uint16_t max = apds9930_alsMaxCount(cur->atime);
+    uint8_t target = dev->range;
+    uint64_t predicted;
+    uint8_t r;
+
+    if(!(sample->status & APDS9930_AVALID))
+        return false;
+
+    /* someone else reprogrammed the ALS, e.g. apds9930_dev_enableLightSensor(dev) */
+    if(dev->shadow[APDS9930_ATIME] != cur->atime ||
+       apds9930_dev_getAmbientLightGain(dev) != cur->again ||
+       !(dev->shadow[APDS9930_CONFIG] & APDS9930_AGL) != !cur->agl)
+    {
+        apds9930_dev_setRange(dev, dev->range);
+        return false;
+    }
+
+    if(dev->rangeSettle)
+    {
+        dev->rangeSettle--;
+        return false;
+    }
+
+    if(sample->ch0 >= max || sample->ch1 >= max)
+    {
+        /* brighter than the least sensitive range can measure */
+        if(dev->range == 0)
+            return false;
+        target = 0;
+    }
+    else if((uint32_t)sample->ch0 * 100 >= (uint32_t)max * APDS9930_RANGE_HIGH_PCT)
+    {
+        if(target > 0)
+            target--;
+    }
+    else
+    {
+        for(r = APDS9930_RANGE_COUNT - 1; r > dev->range; r--)
+        {
+            predicted = (uint64_t)sample->ch0 * apds9930_ranges[r].sens / cur->sens;
+            if(predicted * 100 < (uint64_t)apds9930_alsMaxCount(apds9930_ranges[r].atime) * APDS9930_RANGE_LOW_PCT)
+            {
+                target = r;
+                break;
+            }
+        }
+    }
+
+    if(target != dev->range)
+    {
+        apds9930_dev_setRange(dev, target);
+        return false;
+    }
+
+    *mlux = apds9930_calcMilliLux(sample->ch0, sample->ch1, cur->again, cur->atime);
+    if(cur->agl)
+        *mlux = (uint32_t)((uint64_t)*mlux * 100 / 16);
+
+    return true;
+}
+
+/**
+ * @brief       read the ALS data and run the auto-ranging controller on it
+ * @param       dev   device context
+ * @param       mlux   illuminance normalised for the range, set when true is returned
+ * @return      true if mlux holds a new reading
+*/
+bool apds9930_dev_readAmbientLightAuto(apds9930_dev_t *dev, uint32_t *mlux)
+{
+    apds9930_sample_t sample;
+
+    apds9930_dev_readSample(dev, &sample);
+
+    return apds9930_dev_autoRange(dev, &sample, mlux);
+}
+
+/**
+ * @brief       Sets the LED drive strength for proximity and ALS
+ * @param       dev   device context
+ * @param       drive the value (0-3) for the LED drive strength
+ * @return      NONE
+*/
+void apds9930_dev_setLEDDriver(apds9930_dev_t *dev, uint8_t driver)
+{
+    uint8_t val;
+
+    APDS9930_PROF_BEGIN();
+
+    val = dev->shadow[APDS9930_CONTROL];
+
+    driver &= 0x03;
+    driver = driver << 6;
+    val &= 0x3F;
+    val |= driver;
+
+    apds9930_dev_WriteRegData(dev, APDS9930_CONTROL,val);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_CONTROL);
+}
+
+/**
+ * @brief       Sets the receiver gain for proximity detection
+ * @param       dev   device context
+ * @param       drive the value (0-3) for the LED drive strength
+ * @return      NONE
+*/
+void apds9930_dev_setProximityGain(apds9930_dev_t *dev, uint8_t driver)
+{
+    uint8_t val;
+
+    APDS9930_PROF_BEGIN();
+
+    val = dev->shadow[APDS9930_CONTROL];
+
+    driver &= 0x03;
+    driver = driver << 2;
+    val &= 0xF3;
+    val |= driver;
+
+    apds9930_dev_WriteRegData(dev, APDS9930_CONTROL,val);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_CONTROL);
+}
+
+/**
+ * @brief       Sets the receiver gain for the ambient light sensor (ALS)
+ * @param       dev   device context
+ * @param       drive the value (0-3) for the LED drive strength
+ * @return      NONE
+*/
+void apds9930_dev_setAmbientLightGain(apds9930_dev_t *dev, uint8_t drive)
+{
+    uint8_t val;
+
+    APDS9930_PROF_BEGIN();
+
+    val = dev->shadow[APDS9930_CONTROL];
+
+    drive &= 0x03;
+    val &= 0xFC;
+    val |= drive;
+
+    apds9930_dev_WriteRegData(dev, APDS9930_CONTROL,val);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_CONTROL);
+}
+
+/**
+ * @brief       Selects the proximity diode
+ * @param       dev   device context
+ * @param       drive the value (0-3) for the LED drive strength
+ * @return      NONE
+*/
+void apds9930_dev_setProximityDiode(apds9930_dev_t *dev, uint8_t drive)
+{
+    uint8_t val;
+
+    APDS9930_PROF_BEGIN();
+
+    val = dev->shadow[APDS9930_CONTROL];
+
+    drive &= 0x03;
+    drive = drive << 4;
+    val &= 0xCF;
+    val |= drive;
+
+    apds9930_dev_WriteRegData(dev, APDS9930_CONTROL,val);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_CONTROL);
+}
+
+/**
+ * @brief       Sets the low threshold for proximity interrupts
+ * @param       dev   device context
+ * @param       threshold  interrupts threshold
+ * @return      NONE
+*/
+void apds9930_dev_setProximityIntLowThreshold(apds9930_dev_t *dev, uint16_t threshold)
+{
+    uint8_t val_byte[2];
+
+    APDS9930_PROF_BEGIN();
+
+    val_byte[0] = threshold & 0x00FF;
+    val_byte[1] = (threshold & 0xFF00) >> 8;
+
+    apds9930_dev_writeRegBlock(dev, APDS9930_PILTL, val_byte, 2);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_PROX_THRESHOLD);
+}
+
+/**
+ * @brief       Sets the high threshold for proximity interrupts
+ * @param       dev   device context
+ * @param       threshold  interrupts threshold
+ * @return      NONE
+*/
+void apds9930_dev_setProximityIntHighThreshold(apds9930_dev_t *dev, uint16_t threshold)
+{
+    uint8_t val_byte[2];
+
+    APDS9930_PROF_BEGIN();
+
+    val_byte[0] = threshold & 0x00FF;
+    val_byte[1] = (threshold & 0xFF00) >> 8;
+
+    apds9930_dev_writeRegBlock(dev, APDS9930_PIHTL, val_byte, 2);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_PROX_THRESHOLD);
+}
+
+/**
+ * @brief       Sets both proximity thresholds in one block write
+ * @param       dev   device context
+ * @param       low   PILT, interrupt when PDATA falls below
+ * @param       high   PIHT, interrupt when PDATA rises above
+ * @return      NONE
+*/
+void apds9930_dev_setProximityIntWindow(apds9930_dev_t *dev, uint16_t low, uint16_t high)
+{
+    uint8_t val_byte[4];
+
+    APDS9930_PROF_BEGIN();
+
+    val_byte[0] = low & 0x00FF;
+    val_byte[1] = (low & 0xFF00) >> 8;
+    val_byte[2] = high & 0x00FF;
+    val_byte[3] = (high & 0xFF00) >> 8;
+
+    apds9930_dev_writeRegBlock(dev, APDS9930_PILTL, val_byte, 4);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_PROX_WINDOW);
+}
+
+/**
+ * @brief Turns proximity interrupts on or off
+ *
+ * @param[in] dev device context
+ * @param[in] enable 1 to enable interrupts, 0 to turn them off
+ * @return NONE
+ */
+void apds9930_dev_setProximityIntEnable(apds9930_dev_t *dev, uint8_t enable)
+{
+    uint8_t val;
+
+    APDS9930_PROF_BEGIN();
+
+    val = dev->shadow[APDS9930_ENABLE];
+
+    enable &= 0x01;
+    enable = enable << 5;
+    val &= 0xDF;
+    val |= enable;
+
+    apds9930_dev_WriteRegData(dev, APDS9930_ENABLE,val);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_PROX_INT_ENABLE);
+}
+
+/**
+ * @brief Turns ambient light interrupts on or off
+ *
+ * @param[in] dev device context
+ * @param[in] enable 1 to enable interrupts, 0 to turn them off
+ * @return True if operation successful. False otherwise.
+ */
+void apds9930_dev_setAmbientLightIntEnable(apds9930_dev_t *dev, uint8_t enable)
+{
+    uint8_t val;
+
+    APDS9930_PROF_BEGIN();
+
+    val = dev->shadow[APDS9930_ENABLE];
+
+    enable &= 0x01;
+    enable = enable << 4;
+    val &= 0xEF;
+    val |= enable;  
+
+    apds9930_dev_WriteRegData(dev, APDS9930_ENABLE,val);
+
+    APDS9930_PROF_END(APDS9930_PROF_SET_LIGHT_INT_ENABLE);
+}
+
+/**
+ * @brief Clears the ambient light interrupt
+ *
+ * @param[in] dev device context
+ * @return True if operation completed successfully. False otherwise.
+ */
+void apds9930_dev_clearAmbientLightInt(apds9930_dev_t *dev)
+{
+    APDS9930_PROF_BEGIN();
+
+    apds9930_dev_wireWriteByte(dev, CLEAR_ALS_INT);
+
+    APDS9930_PROF_END(APDS9930_PROF_CLEAR_INT);
+}
+
+/**
+ * @brief Clears the proximity interrupt
+ *
+ * @param[in] dev device context
+ * @return NONE
+ */
+void apds9930_dev_clearProximityInt(apds9930_dev_t *dev)
+{
+    APDS9930_PROF_BEGIN();
+
+    apds9930_dev_wireWriteByte(dev, CLEAR_PROX_INT);
+
+    APDS9930_PROF_END(APDS9930_PROF_CLEAR_INT);
+}
+
+/**
+ * @brief Clears all interrupts
+ *
+ * @param[in] dev device context
+ * @return True if operation completed successfully. False otherwise.
+ */
+void apds9930_dev_clearAllInts(apds9930_dev_t *dev)
+{
+    APDS9930_PROF_BEGIN();
+
+    apds9930_dev_wireWriteByte(dev, CLEAR_ALL_INTS);
+
+    APDS9930_PROF_END(APDS9930_PROF_CLEAR_INT);
+}
+
+#ifdef APDS9930_HOST_SIM
+/**
+ * @brief       simulated EXTI: route a model's INT edge to its instance
+ * @param       ctx   device context
+ * @return      NONE
+*/
+static void apds9930_simInt(void *ctx)
+{
+    apds9930_dev_onInterrupt((apds9930_dev_t *)ctx);
+}
+#endif
+
+/**
+ * @brief       configure the INT pin of an instance as a falling-edge EXTI source
+ * @param       dev   device context
+ * @return      NONE
+*/
+static void apds9930_intGpioInit(apds9930_dev_t *dev)
+{
+#ifdef APDS9930_HOST_SIM
+    /* the simulated INT line is serviced from HAL_Delay() */
+    apds9930_sim_setIntHandler(dev->int_sim ? dev->int_sim : &apds9930_sim_default, apds9930_simInt, dev);
+#else
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    if(dev->int_port == GPIOA)
+        __HAL_RCC_GPIOA_CLK_ENABLE();
+    else if(dev->int_port == GPIOB)
+        __HAL_RCC_GPIOB_CLK_ENABLE();
+    else if(dev->int_port == GPIOC)
+        __HAL_RCC_GPIOC_CLK_ENABLE();
+
+    /* INT is open drain, active low */
+    GPIO_InitStruct.Pin = dev->int_pin;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
+    GPIO_InitStruct.Pull = GPIO_PULLUP;
+    HAL_GPIO_Init(dev->int_port, &GPIO_InitStruct);
+
+    HAL_NVIC_SetPriority(dev->int_irq, APDS9930_INT_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(dev->int_irq);
+#endif
+}
+
+/**
+ * @brief       interrupt-driven ALS acquisition: every ALS cycle raises INT
+ *              and apds9930_dev_onInterrupt(dev) queues the sample. While running,
+ *              the bus belongs to the handler; stop before other accesses.
+ * @param       dev   device context
+ * @return      NONE
+*/
+void apds9930_dev_startAcquisition(apds9930_dev_t *dev)
+{
+    dev->trackBand = 0;
+    dev->ringHead = 0;
+    dev->ringTail = 0;
+    dev->ringDropped = 0;
+
+    /* APERS = 0: an interrupt after every ALS cycle */
+    apds9930_dev_WriteRegData(dev, APDS9930_PERS, dev->shadow[APDS9930_PERS] & 0xF0);
+    apds9930_dev_clearAmbientLightInt(dev);
+
+    apds9930_intGpioInit(dev);
+    apds9930_dev_enableLightSensor(dev, true);
+}
+
+/**
+ * @brief       interrupt-driven acquisition that only wakes on a light change
+ *              Each interrupt re-centres AILT/AIHT on the new Ch0 value, so
+ *              queued samples differ from the previous one by more than
+ *              band_pct for apers cycles.
+ * @param       dev   device context
+ * @param       band_pct   window half-width in percent of Ch0, 1-100
+ * @param       apers   APERS persistence filter (1-15), 0 is taken as 1
+ * @return      NONE
+*/
+void apds9930_dev_startTracking(apds9930_dev_t *dev, uint8_t band_pct, uint8_t apers)
+{
+    apds9930_sample_t sample;
+
+    dev->ringHead = 0;
+    dev->ringTail = 0;
+    dev->ringDropped = 0;
+    dev->trackBand = band_pct ? band_pct : 1;
+
+    /* APERS 0 interrupts on every cycle whatever the window */
+    if(apers == 0)
+        apers = 1;
+
+    apds9930_dev_WriteRegData(dev, APDS9930_PERS, (dev->shadow[APDS9930_PERS] & 0xF0) | (apers & 0x0F));
+
+    /* start from a real reading when one is available, else from the full range */
+    apds9930_dev_readSample(dev, &sample);
+    if(sample.status & APDS9930_AVALID)
+        apds9930_dev_trackLight(dev, sample.ch0);
+    else
+        apds9930_dev_setLightIntWindow(dev, 0xFFFF, 0);
+    apds9930_dev_clearAmbientLightInt(dev);
+
+    apds9930_intGpioInit(dev);
+    apds9930_dev_enableLightSensor(dev, true);
+}
+
+/**
+ * @brief       arm the proximity window for the current presence state
+ *              FAR waits for PDATA above the near threshold, NEAR waits for
+ *              PDATA below the far one; the gap between them is the hysteresis
+ * @param       dev   device context
+ * @return      NONE
+*/
+static void apds9930_proxArm(apds9930_dev_t *dev)
+{
+    if(dev->proxState == NEAR_STATE)
+        apds9930_dev_setProximityIntWindow(dev, dev->proxFar, 0xFFFF);
+    else
+        apds9930_dev_setProximityIntWindow(dev, 0, dev->proxNear);
+}
+
+/**
+ * @brief       interrupt-driven NEAR/FAR presence detection
+ *              Every state change queues an event carrying the new state.
+ *              An event is raised at the end of the proximity cycle that
+ *              crosses the threshold, i.e. within ppers * apds9930_dev_getCycleTimeUs(dev).
+ * @param       dev   device context
+ * @param       near   PDATA above which the target is NEAR
+ * @param       far   PDATA below which a NEAR target is FAR again, < near
+ * @param       ppers   PPERS persistence filter (1-15), 0 is taken as 1
+ * @return      worst-case event latency in us
+*/
+uint32_t apds9930_dev_startPresence(apds9930_dev_t *dev, uint16_t near, uint16_t far, uint8_t ppers)
+{
+    apds9930_sample_t sample;
+
+    if(far >= near)
+        far = near ? near - 1 : 0;
+    if(ppers == 0)
+        ppers = 1;
+
+    dev->proxNear = near;
+    dev->proxFar = far;
+
+    apds9930_dev_WriteRegData(dev, APDS9930_PERS, (uint8_t)((dev->shadow[APDS9930_PERS] & 0x0F) | (ppers << 4)));
+
+    /* start in the state the last reading says, FAR before the first one */
+    apds9930_dev_readSample(dev, &sample);
+    dev->proxState = (sample.status & APDS9930_PVALID) && sample.proximity > near ? NEAR_STATE : FAR_STATE;
+    apds9930_proxArm(dev);
+    apds9930_dev_clearProximityInt(dev);
+
+    apds9930_intGpioInit(dev);
+    apds9930_dev_beginConfig(dev);
+    apds9930_dev_setProximityIntEnable(dev, 1);
+    apds9930_dev_enablePower(dev);
+    apds9930_dev_setMode(dev, PROXIMITY, 1);
+    apds9930_dev_commitConfig(dev);
+
+    return apds9930_dev_getCycleTimeUs(dev) * ppers;
+}
+
+/**
+ * @brief       stop presence detection
+ * @param       dev   device context
+ * @return      NONE
+*/
+void apds9930_dev_stopPresence(apds9930_dev_t *dev)
+{
+    dev->proxState = NOTAVAILABLE_STATE;
+    apds9930_dev_beginConfig(dev);
+    apds9930_dev_setProximityIntEnable(dev, 0);
+    apds9930_dev_setMode(dev, PROXIMITY, 0);
+    apds9930_dev_commitConfig(dev);
+    apds9930_dev_clearProximityInt(dev);
+}
+
+/**
+ * @brief       current presence state
+ * @param       dev   device context
+ * @return      NEAR_STATE, FAR_STATE, or NOTAVAILABLE_STATE when stopped
+*/
+uint8_t apds9930_dev_getProximityState(apds9930_dev_t *dev)
+{
+    return dev->proxState;
+}
+
+/**
+ * @brief       POFFSET register value of a signed correction
+ * @param       shift   >0 lowers PDATA, <0 raises it, -127..127
+ * @return      sign-magnitude POFFSET
+*/
+static uint8_t apds9930_poffsetEncode(int16_t shift)
+{
+    return shift >= 0 ? (uint8_t)shift : (uint8_t)(0x80 | -shift);
+}
+
+/**
+ * @brief       PDATA of one fresh proximity cycle at a POFFSET value
+ *              The prox engine is restarted so the conversion read back
+ *              started after the POFFSET write.
+ * @param       dev   device context
+ * @param       poffset   POFFSET register value
+ * @return      PDATA
+*/
+static uint16_t apds9930_proxMeasure(apds9930_dev_t *dev, uint8_t poffset)
+{
+    apds9930_dev_WriteRegData(dev, APDS9930_POFFSET, poffset);
+
+    apds9930_dev_WriteRegData(dev, APDS9930_ENABLE, APDS9930_PON);
+    apds9930_dev_WriteRegData(dev, APDS9930_ENABLE, APDS9930_PON | APDS9930_PEN);
+    apds9930_dev_waitReady(dev, APDS9930_PVALID, 2);
+
+    return apds9930_dev_readProximity(dev);
+}
+
+/**
+ * @brief       cancel cover-glass crosstalk with POFFSET, no target in front
+ *              Bisection over the signed offset: at most 8 proximity cycles,
+ *              each as short as the operating PPULSE/PTIME allow since ALS
+ *              and wait are off meanwhile. PPULSE and PDRIVE must already be
+ *              at their operating values, as both change the crosstalk.
+ *              Presence detection must be stopped. Crosstalk beyond the
+ *              POFFSET range ends at the nearest limit; check PDATA after.
+ * @param       dev   device context
+ * @param       target   wanted no-target PDATA
+ * @param       tolerance   stop once PDATA is this close to target
+ * @param       save   called with the chosen POFFSET to persist it, may be NULL
+ * @param       cycles   receives the number of proximity cycles used, may be NULL
+ * @return      POFFSET register value now in use
+*/
+uint8_t apds9930_dev_calibrateProximityOffset(apds9930_dev_t *dev, uint16_t target, uint16_t tolerance,
+                                              apds9930_poffset_save_t save, uint8_t *cycles)
+{
+    uint8_t enable = dev->shadow[APDS9930_ENABLE];
+    int16_t lo = -127;
+    int16_t hi = 127;
+    int16_t mid;
+    uint8_t poffset;
+    uint8_t best = 0;
+    uint8_t last = 0;
+    uint16_t best_err = 0xFFFF;
+    uint16_t pdata;
+    uint16_t err;
+    uint8_t n = 0;
+
+    /* PDATA falls as the signed offset grows */
+    while(lo <= hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        poffset = apds9930_poffsetEncode(mid);
+        pdata = apds9930_proxMeasure(dev, poffset);
+        last = poffset;
+        n++;
+
+        err = pdata > target ? pdata - target : target - pdata;
+        /* on ties (saturated PDATA) keep the offset nearest the range end */
+        if(err <= best_err)
+        {
+            best_err = err;
+            best = poffset;
+        }
+        if(err <= tolerance)
+            break;
+
+        if(pdata > target)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+
+    if(last != best)
+        apds9930_dev_WriteRegData(dev, APDS9930_POFFSET, best);
+    apds9930_dev_WriteRegData(dev, APDS9930_ENABLE, enable);
+
+    if(save != NULL)
+        save(best);
+    if(cycles != NULL)
+        *cycles = n;
+
+    return best;
+}
+
+/**
+ * @brief       stop interrupt-driven acquisition, queued samples stay readable
+ * @param       dev   device context
+ * @return      NONE
+*/
+void apds9930_dev_stopAcquisition(apds9930_dev_t *dev)
+{
+#ifdef APDS9930_HOST_SIM
+    apds9930_sim_setIntHandler(dev->int_sim ? dev->int_sim : &apds9930_sim_default, NULL, NULL);
+#else
+    /* mask only this line, the EXTI vector may be shared with other instances */
+    EXTI->IMR &= ~(uint32_t)dev->int_pin;
+#endif
+    dev->trackBand = 0;
+    apds9930_dev_disableLightSensor(dev);
+    apds9930_dev_clearAmbientLightInt(dev);
+}
+
+/**
+ * @brief       burst-read STATUS..PDATAH, update tracking/presence and clear the interrupt
+ * @param       dev   device context
+ * @param       ev   filled in with the sample
+ * @return      NONE
+*/
+static void apds9930_serviceInt(apds9930_dev_t *dev, apds9930_event_t *ev)
+{
+    ev->tick = HAL_GetTick();
+
+    apds9930_dev_readSample(dev, &ev->sample);
+
+    if(dev->trackBand && (ev->sample.status & APDS9930_AINT))
+        apds9930_dev_trackLight(dev, ev->sample.ch0);
+
+    if(dev->proxState != NOTAVAILABLE_STATE && (ev->sample.status & APDS9930_PINT))
+    {
+        if(dev->proxState == FAR_STATE && ev->sample.proximity > dev->proxNear)
+            dev->proxState = NEAR_STATE;
+        else if(dev->proxState == NEAR_STATE && ev->sample.proximity < dev->proxFar)
+            dev->proxState = FAR_STATE;
+        apds9930_proxArm(dev);
+    }
+
+    /* clear whatever is pending, either source holds INT low */
+    if((ev->sample.status & (APDS9930_AINT | APDS9930_PINT)) == (APDS9930_AINT | APDS9930_PINT))
+        apds9930_dev_clearAllInts(dev);
+    else if(ev->sample.status & APDS9930_PINT)
+        apds9930_dev_clearProximityInt(dev);
+    else
+        apds9930_dev_clearAmbientLightInt(dev);
+
+    ev->prox_state = dev->proxState;
+}
+
+/**
+ * @brief       INT handler, call from HAL_GPIO_EXTI_Callback() for the int_pin of dev
+ *              burst-reads STATUS..PDATAH, queues it and clears the interrupt.
+ *              With apds9930_bus_hal the I2C IRQ must preempt this EXTI.
+ * @param       dev   device context
+ * @return      NONE
+*/
+void apds9930_dev_onInterrupt(apds9930_dev_t *dev)
+{
+    uint32_t head = dev->ringHead;
+    apds9930_event_t ev;
+
+    apds9930_serviceInt(dev, &ev);
+
+    if(head - dev->ringTail >= APDS9930_RING_SIZE)
+    {
+        dev->ringDropped++;
+        return;
+    }
+
+    dev->ring[head & (APDS9930_RING_SIZE - 1)] = ev;
+
+    APDS9930_RING_BARRIER();
+    dev->ringHead = head + 1;
+}
+
+/**
+ * @brief       hand the INT line of dev to a low-power platform for apds9930_dev_waitEvent(dev)
+ *              The line no longer reaches the EXTI handler of
+ *              apds9930_dev_startAcquisition(dev) until that is called again.
+ * @param       dev   device context
+ * @param       lp   apds9930_lp_stm32l0, apds9930_lp_sim, ...
+ * @return      NONE
+*/
+void apds9930_dev_armWake(apds9930_dev_t *dev, const apds9930_lp_t *lp)
+{
+    lp->arm(lp->ctx, dev);
+}
+
+/**
+ * @brief       sleep until the sensor raises INT, then read and clear it
+ *              The core stays in STOP between interrupts; on wake it does
+ *              only the STATUS..PDATAH burst and the interrupt clear, which
+ *              also restarts a device that went to sleep under SAI. The
+ *              tick of ev is the HAL tick after wake-up, SysTick does not
+ *              run in STOP.
+ * @param       dev   device context, armed with apds9930_dev_armWake(dev)
+ * @param       lp   platform dev was armed with
+ * @param       ev   filled in when true is returned
+ * @return      false if the core woke up for another reason
+*/
+bool apds9930_dev_waitEvent(apds9930_dev_t *dev, const apds9930_lp_t *lp, apds9930_event_t *ev)
+{
+    if(!lp->stop(lp->ctx, dev))
+        return false;
+
+    apds9930_serviceInt(dev, ev);
+
+    return true;
+}
+
+/**
+ * @brief       take the oldest queued sample
+ * @param       dev   device context
+ * @param       ev   receives the sample
+ * @return      false if the ring is empty
+*/
+bool apds9930_dev_popSample(apds9930_dev_t *dev, apds9930_event_t *ev)
+{
+    uint32_t tail = dev->ringTail;
+
+    if(tail == dev->ringHead)
+        return false;
+
+    APDS9930_RING_BARRIER();
+    *ev = dev->ring[tail & (APDS9930_RING_SIZE - 1)];
+    APDS9930_RING_BARRIER();
+
+    dev->ringTail = tail + 1;
+
+    return true;
+}
+
+/**
+ * @brief       samples lost because the ring was full
+ * @param       dev   device context
+ * @return      count since apds9930_dev_startAcquisition(dev)
+*/
+uint32_t apds9930_dev_getDroppedSamples(apds9930_dev_t *dev)
+{
+    return dev->ringDropped;
+}
+
+/**
+ * @brief       Turn the APDS-9930 on
+ * @param       dev   device context
+ * @return      NONE
+*/
+void apds9930_dev_enablePower(apds9930_dev_t *dev)
+{
+    apds9930_dev_setMode(dev, POWER,1);
+}
+
+/**
+ * @brief       Turn the APDS-9930 off
+ * @param       dev   device context
+ * @return      NONE
+*/
+void apds9930_dev_disablePower(apds9930_dev_t *dev)
+{
+    apds9930_dev_setMode(dev, POWER,0);
+}
+
+/**
+ * @brief       get Light Int Low Threshold
+ * @param       dev   device context
+ * @return      threshold
+*/
+uint16_t apds9930_dev_getLightIntLowThreshold(apds9930_dev_t *dev)
+{
+    uint16_t threshold=0;
+    
+    threshold = (uint16_t)(dev->shadow[APDS9930_AILTL] + (uint16_t)(dev->shadow[APDS9930_AILTH]*256));
+    
+    return threshold;
+}
+
+/**
+ * @brief       get Light Int High Threshold
+ * @param       dev   device context
+ * @return      threshold
+*/
+uint16_t apds9930_dev_getLightIntHighThreshold(apds9930_dev_t *dev)
+{
+    uint16_t threshold=0;
+    
+    threshold = (uint16_t)(dev->shadow[APDS9930_AIHTL] + (uint16_t)(dev->shadow[APDS9930_AIHTH]*256));
+    
+    return threshold;
+}
+
+/**
+ * @brief       get Proximity Int Low Threshold
+ * @param       dev   device context
+ * @return      threshold
+*/
+uint16_t apds9930_dev_getProximityIntLowThreshold(apds9930_dev_t *dev)
+{
+    return (uint16_t)(dev->shadow[APDS9930_PILTL] + (uint16_t)(dev->shadow[APDS9930_PILTH]*256));
+}
+
+/**
+ * @brief       get Proximity Int High Threshold
+ * @param       dev   device context
+ * @return      threshold
+*/
+uint16_t apds9930_dev_getProximityIntHighThreshold(apds9930_dev_t *dev)
+{
+    return (uint16_t)(dev->shadow[APDS9930_PIHTL] + (uint16_t)(dev->shadow[APDS9930_PIHTH]*256));
+}
+
+#ifdef APDS9930_ASYNC
+
+#include "iic.h"
+
+/* Operations */
+enum {
+  APDS9930_ASYNC_OP_INIT,
+  APDS9930_ASYNC_OP_READ_SAMPLE,
+  APDS9930_ASYNC_OP_SET_LIGHT_WINDOW
+};
+
+/* Bus phases of a transfer; a transport other than apds9930_bus_iic runs it as one WHOLE phase */
+enum {
+  APDS9930_ASYNC_PH_IDLE,
+  APDS9930_ASYNC_PH_START,
+  APDS9930_ASYNC_PH_ADDR,
+  APDS9930_ASYNC_PH_CMD,
+  APDS9930_ASYNC_PH_RESTART,
+  APDS9930_ASYNC_PH_ADDR_RD,
+  APDS9930_ASYNC_PH_DATA,
+  APDS9930_ASYNC_PH_STOP,
+  APDS9930_ASYNC_PH_WHOLE
+};
+
+/**
+ * @brief       common part of every apds9930_async_*() start call
+ * @param       op   operation state, owned by the caller until done
+ * @param       dev   device context
+ * @param       kind   APDS9930_ASYNC_OP_*
+ * @param       done   completion callback, may be NULL
+ * @return      NONE
+*/
+static void apds9930_asyncBegin(apds9930_async_t *op, apds9930_dev_t *dev, uint8_t kind,
+                                void (*done)(apds9930_async_t *op))
+{
+    op->dev = dev;
+    op->done = done;
+    op->slice_us = APDS9930_ASYNC_SLICE_US;
+    op->status = APDS9930_ASYNC_BUSY;
+    op->op = kind;
+    op->stage = 0;
+    op->phase = APDS9930_ASYNC_PH_IDLE;
+    op->nack = 0;
+}
+
+/**
+ * @brief       queue one register transfer on op->buf
+ * @param       op   operation state
+ * @param       rd   1 = read len bytes into op->buf, 0 = write them from it
+ * @param       cmd   command byte
+ * @param       len   number of data bytes
+ * @return      NONE
+*/
+static void apds9930_asyncXfer(apds9930_async_t *op, uint8_t rd, uint8_t cmd, uint8_t len)
+{
+    op->rd = rd;
+    op->cmd = cmd;
+    op->len = len;
+    op->idx = 0;
+    op->phase = (op->dev->bus->read == apds9930_bus_iic.read) ? APDS9930_ASYNC_PH_START : APDS9930_ASYNC_PH_WHOLE;
+}
+
+/**
+ * @brief       queue a register write, updating the shadow as the blocking writes do
+ * @param       op   operation state
+ * @param       cmd   REPEATED_BYTE or AUTO_INCREMENT plus the first register
+ * @param       len   number of bytes in op->buf
+ * @return      NONE
+*/
+static void apds9930_asyncWrite(apds9930_async_t *op, uint8_t cmd, uint8_t len)
+{
+    uint8_t i;
+
+    for(i = 0; i < len; i++)
+    {
+        apds9930_shadowStore(op->dev, apds9930_shadowIndex((cmd & 0x1F) + i), op->buf[i]);
+    }
+
+    apds9930_asyncXfer(op, 0, cmd, len);
+}
+
+/**
+ * @brief       set up the next transfer of the operation, or finish it
+ * @param       op   operation state, between transfers
+ * @return      0 while the device is not ready yet, 1 otherwise
+*/
+static uint8_t apds9930_asyncNext(apds9930_async_t *op)
+{
+    apds9930_dev_t *dev = op->dev;
+    const apds9930_regs_t *regs = op->regs;
+    uint8_t i;
+
+    if(op->nack)
+    {
+        op->status = APDS9930_ASYNC_NACK;
+        return 1;
+    }
+
+    switch(op->op)
+    {
+    case APDS9930_ASYNC_OP_INIT:
+        switch(op->stage++)
+        {
+        case 0:
+            /*read apds9930 id and the current POFFSET in one pass*/
+            dev->bus->init(dev->bus->ctx);
+            apds9930_asyncXfer(op, 1, AUTO_INCREMENT | APDS9930_ID, APDS9930_POFFSET - APDS9930_ID + 1);
+            return 1;
+
+        case 1:
+            if(!apds9930_isId(op->buf[0]))
+            {
+                op->status = APDS9930_ASYNC_BAD_ID;
+                return 1;
+            }
+            dev->shadow[APDS9930_SHADOW_POFFSET] = op->buf[APDS9930_POFFSET - APDS9930_ID];
+
+            /* Write 0x00-0x0F in one block with every feature still disabled */
+            for(i = 0; i <= APDS9930_CONTROL; i++)
+            {
+                op->buf[i] = regs->reg[i];
+            }
+            op->buf[APDS9930_ENABLE] = 0;
+            apds9930_asyncWrite(op, AUTO_INCREMENT | APDS9930_ENABLE, APDS9930_CONTROL + 1);
+            return 1;
+
+        case 2:
+            if(regs->poffset != dev->shadow[APDS9930_SHADOW_POFFSET])
+            {
+                op->buf[0] = regs->poffset;
+                apds9930_asyncWrite(op, REPEATED_BYTE | APDS9930_POFFSET, 1);
+                return 1;
+            }
+            op->stage++;
+            /* fall through */
+
+        case 3:
+            /* Start the device only once it is fully configured */
+            if(regs->reg[APDS9930_ENABLE] != 0)
+            {
+                op->buf[0] = regs->reg[APDS9930_ENABLE];
+                apds9930_asyncWrite(op, REPEATED_BYTE | APDS9930_ENABLE, 1);
+                return 1;
+            }
+            op->stage++;
+            /* fall through */
+
+        default:
+            /* Done once the first conversion can be read, without sleeping for it */
+            op->stage = 4;
+            if(regs->reg[APDS9930_ENABLE] != 0 && (int32_t)(dev->readyTick - HAL_GetTick()) > 0)
+                return 0;
+            op->status = APDS9930_ASYNC_DONE;
+            return 1;
+        }
+
+    case APDS9930_ASYNC_OP_READ_SAMPLE:
+        if(op->stage++ == 0)
+        {
+            apds9930_asyncXfer(op, 1, AUTO_INCREMENT | APDS9930_STATUS, APDS9930_SAMPLE_LEN);
+            return 1;
+        }
+        apds9930_decodeSample(op->buf, op->sample);
+        op->status = APDS9930_ASYNC_DONE;
+        return 1;
+
+    default:
+        /* APDS9930_ASYNC_OP_SET_LIGHT_WINDOW, the block write is queued at start */
+        op->status = APDS9930_ASYNC_DONE;
+        return 1;
+    }
+}
+
+/**
+ * @brief       bus time of the phase about to run
+ * @param       op   operation state
+ * @return      upper estimate in ns from the bit time at i2c_GetSpeed()
+*/
+static uint32_t apds9930_asyncPhaseNs(const apds9930_async_t *op)
+{
+    uint32_t half_ns = 500000000UL / i2c_GetSpeed();
+
+    /* START/STOP take about 1.4 bit times and a byte with its ACK 9, plus rounding */
+    switch(op->phase)
+    {
+    case APDS9930_ASYNC_PH_START:
+    case APDS9930_ASYNC_PH_RESTART:
+    case APDS9930_ASYNC_PH_STOP:
+        return half_ns * 3;
+
+    case APDS9930_ASYNC_PH_WHOLE:
+        return half_ns * (3 * (op->rd ? 3 : 2) + 19 * ((op->rd ? 3 : 2) + op->len));
+
+    default:
+        return half_ns * 19;
+    }
+}
+
+/**
+ * @brief       run one bus phase of the transfer in progress
+ * @param       op   operation state
+ * @return      NONE
+*/
+static void apds9930_asyncPhase(apds9930_async_t *op)
+{
+    apds9930_dev_t *dev = op->dev;
+
+    switch(op->phase)
+    {
+    case APDS9930_ASYNC_PH_START:
+        i2c_Start();
+        op->phase = APDS9930_ASYNC_PH_ADDR;
+        break;
+
+    case APDS9930_ASYNC_PH_ADDR:
+        i2c_SendByte((dev->addr << 1) & (0xFE));
+        op->nack |= i2c_WaitAck();
+        op->phase = APDS9930_ASYNC_PH_CMD;
+        break;
+
+    case APDS9930_ASYNC_PH_CMD:
+        i2c_SendByte(op->cmd);
+        op->nack |= i2c_WaitAck();
+        if(op->rd)
+            op->phase = APDS9930_ASYNC_PH_RESTART;
+        else
+            op->phase = op->len ? APDS9930_ASYNC_PH_DATA : APDS9930_ASYNC_PH_STOP;
+        break;
+
+    case APDS9930_ASYNC_PH_RESTART:
+        i2c_Start();
+        op->phase = APDS9930_ASYNC_PH_ADDR_RD;
+        break;
+
+    case APDS9930_ASYNC_PH_ADDR_RD:
+        i2c_SendByte((dev->addr << 1) | (0x01));
+        op->nack |= i2c_WaitAck();
+        op->phase = APDS9930_ASYNC_PH_DATA;
+        break;
+
+    case APDS9930_ASYNC_PH_DATA:
+        if(op->rd)
+        {
+            /* ACK every byte but the last so the device keeps auto-incrementing */
+            op->buf[op->idx] = i2c_ReadByte(op->idx != (op->len - 1));
+        }
+        else
+        {
+            i2c_SendByte(op->buf[op->idx]);
+            op->nack |= i2c_WaitAck();
+        }
+        if(++op->idx == op->len)
+            op->phase = APDS9930_ASYNC_PH_STOP;
+        break;
+
+    case APDS9930_ASYNC_PH_STOP:
+        i2c_Stop();
+        op->phase = APDS9930_ASYNC_PH_IDLE;
+        break;
+
+    default:
+        /* APDS9930_ASYNC_PH_WHOLE */
+        if(op->rd)
+            op->nack |= dev->bus->read(dev->bus->ctx, dev->addr, op->cmd, op->buf, op->len);
+        else
+            op->nack |= dev->bus->write(dev->bus->ctx, dev->addr, op->cmd, op->buf, op->len);
+        op->phase = APDS9930_ASYNC_PH_IDLE;
+        break;
+    }
+}
+
+/**
+ * @brief       start a non-blocking init, apds9930_dev_initRegs() in steps
+ *              completes once the first conversion is due, a wrong ID ends
+ *              it with APDS9930_ASYNC_BAD_ID, where initRegs returns ERROR
+ * @param       op   operation state, owned by the caller until done
+ * @param       dev   device context
+ * @param       regs   image built with APDS9930_REGS_IMAGE(), NULL for DEFAULT_*
+ * @param       done   completion callback, may be NULL
+ * @return      NONE
+*/
+void apds9930_async_init(apds9930_async_t *op, apds9930_dev_t *dev, const apds9930_regs_t *regs,
+                         void (*done)(apds9930_async_t *op))
+{
+    apds9930_asyncBegin(op, dev, APDS9930_ASYNC_OP_INIT, done);
+    op->regs = regs ? regs : &apds9930_defaultRegs;
+}
+
+/**
+ * @brief       start a non-blocking STATUS..PDATAH burst read
+ * @param       op   operation state, owned by the caller until done
+ * @param       dev   device context
+ * @param       sample   filled in when the operation completes
+ * @param       done   completion callback, may be NULL
+ * @return      NONE
+*/
+void apds9930_async_readSample(apds9930_async_t *op, apds9930_dev_t *dev, apds9930_sample_t *sample,
+                               void (*done)(apds9930_async_t *op))
+{
+    apds9930_asyncBegin(op, dev, APDS9930_ASYNC_OP_READ_SAMPLE, done);
+    op->sample = sample;
+}
+
+/**
+ * @brief       start a non-blocking write of both ambient light thresholds
+ * @param       op   operation state, owned by the caller until done
+ * @param       dev   device context
+ * @param       low   AILT, interrupt when Ch0 falls below
+ * @param       high   AIHT, interrupt when Ch0 rises above
+ * @param       done   completion callback, may be NULL
+ * @return      NONE
+*/
+void apds9930_async_setLightIntWindow(apds9930_async_t *op, apds9930_dev_t *dev, uint16_t low, uint16_t high,
+                                      void (*done)(apds9930_async_t *op))
+{
+    apds9930_asyncBegin(op, dev, APDS9930_ASYNC_OP_SET_LIGHT_WINDOW, done);
+
+    op->buf[0] = low & 0x00FF;
+    op->buf[1] = (low & 0xFF00) >> 8;
+    op->buf[2] = high & 0x00FF;
+    op->buf[3] = (high & 0xFF00) >> 8;
+    apds9930_asyncWrite(op, AUTO_INCREMENT | APDS9930_AILTL, 4);
+    op->stage = 1;
+}
+
+/**
+ * @brief       advance an operation by as many bus phases as fit in its slice
+ *              the first phase always runs, so a slice below one byte time
+ *              still makes progress one phase per call
+ * @param       op   operation started by apds9930_async_*()
+ * @return      APDS9930_ASYNC_BUSY until done, then the final status
+*/
+uint8_t apds9930_async_step(apds9930_async_t *op)
+{
+    uint32_t budget_ns = (uint32_t)op->slice_us * 1000;
+    uint32_t spent_ns = 0;
+    uint32_t cost_ns;
+
+    if(op->status != APDS9930_ASYNC_BUSY)
+        return op->status;
+
+#ifdef IIC_MULTI_BUS
+    /* Another task may have switched buses since the last step */
+    if(op->dev->bus->read == apds9930_bus_iic.read)
+        i2c_SelectBus((const iic_bus_t *)op->dev->bus->ctx);
+#endif
+
+    while(op->status == APDS9930_ASYNC_BUSY)
+    {
+        if(op->phase == APDS9930_ASYNC_PH_IDLE)
+        {
+            if(!apds9930_asyncNext(op))
+                break;
+            continue;
+        }
+
+        cost_ns = apds9930_asyncPhaseNs(op);
+        if(spent_ns != 0 && spent_ns + cost_ns > budget_ns)
+            break;
+
+        apds9930_asyncPhase(op);
+        spent_ns += cost_ns;
+    }
+
+    if(op->status != APDS9930_ASYNC_BUSY && op->done)
+        op->done(op);
+
+    return op->status;
+}
+
+#endif
+
+#ifdef APDS9930_PROFILE
+
+#ifdef APDS9930_HOST_SIM
+#include <time.h>
+#endif
+
+apds9930_prof_t apds9930_prof[APDS9930_PROF_COUNT];
+
+static const char *const apds9930_profNames[APDS9930_PROF_COUNT] = {
+    "init",
+    "setMode",
+    "readSample",
+    "readCh0Light",
+    "readCh1Light",
+    "readProximity",
+    "readAmbientLightLux",
+    "setLightIntThreshold",
+    "setLightIntWindow",
+    "setProximityIntThreshold",
+    "setProximityIntWindow",
+    "setProximityIntEnable",
+    "setControl",
+    "setAmbientLightIntEnable",
+    "enableLightSensor",
+    "disableLightSensor",
+    "clearInt",
+    "resync",
+    "verify",
+    "waitReady",
+};
+
+#ifdef APDS9930_HOST_SIM
+/**
+ * @brief       host CPU time of this process
+ * @param       NONE
+ * @return      nanoseconds
+*/
+static uint64_t apds9930_profCpuNs(void)
+{
+    return (uint64_t)clock() * 1000000000ULL / CLOCKS_PER_SEC;
+}
+#endif
+
+/**
+ * @brief       snapshot the counters at the start of a profiled call
+ * @param       mark   snapshot
+ * @return      NONE
+*/
+void apds9930_profMark(apds9930_prof_mark_t *mark)
+{
+    mark->bus = i2c_stats;
+#ifdef APDS9930_HOST_SIM
+    mark->sim_ns = apds9930_sim_now();
+    mark->cpu_ns = apds9930_profCpuNs();
+#endif
+}
+
+/**
+ * @brief       close a profiling scope and charge its bus cost to an API entry
+ * @param       id   APDS9930_PROF_*
+ * @param       start   snapshot taken by APDS9930_PROF_BEGIN()
+ * @return      NONE
+*/
+void apds9930_profEnd(uint8_t id, const apds9930_prof_mark_t *start)
+{
+    apds9930_prof_t *p = &apds9930_prof[id];
+
+    p->calls++;
+    p->cost.starts += i2c_stats.starts - start->bus.starts;
+    p->cost.stops += i2c_stats.stops - start->bus.stops;
+    p->cost.bytes_tx += i2c_stats.bytes_tx - start->bus.bytes_tx;
+    p->cost.bytes_rx += i2c_stats.bytes_rx - start->bus.bytes_rx;
+    p->cost.nacks += i2c_stats.nacks - start->bus.nacks;
+    p->cost.scl_edges += i2c_stats.scl_edges - start->bus.scl_edges;
+    p->cost.delay_cycles += i2c_stats.delay_cycles - start->bus.delay_cycles;
+#ifdef APDS9930_HOST_SIM
+    p->sim_ns += apds9930_sim_now() - start->sim_ns;
+    p->cpu_ns += apds9930_profCpuNs() - start->cpu_ns;
+#endif
+}
+
+/**
+ * @brief       clear every profiling entry
+ * @param       NONE
+ * @return      NONE
+*/
+void apds9930_profReset(void)
+{
+    apds9930_prof_t empty = {0};
+    uint8_t i;
+
+    for(i = 0; i < APDS9930_PROF_COUNT; i++)
+    {
+        apds9930_prof[i] = empty;
+    }
+}
+
+/**
+ * @brief       printable name of a profiling entry
+ * @param       id   APDS9930_PROF_*
+ * @return      name
+*/
+const char *apds9930_profName(uint8_t id)
+{
+    return id < APDS9930_PROF_COUNT ? apds9930_profNames[id] : "?";
+}
+
+/**
+ * @brief       print the totals of every called API, one row or object per API
+ * @param       format   APDS9930_PROF_CSV or APDS9930_PROF_JSON
+ * @return      NONE
+*/
+void apds9930_profPrint(uint8_t format)
+{
+    const apds9930_prof_t *p;
+    uint8_t i;
+    uint8_t first = 1;
+
+    if(format == APDS9930_PROF_CSV)
+        printf("api,calls,starts,stops,bytes_tx,bytes_rx,nacks,scl_edges,delay_cycles,sim_ns,cpu_ns\r\n");
+    else
+        printf("[");
+
+    for(i = 0; i < APDS9930_PROF_COUNT; i++)
+    {
+        unsigned long long sim_ns = 0, cpu_ns = 0;
+
+        p = &apds9930_prof[i];
+        if(p->calls == 0)
+            continue;
+#ifdef APDS9930_HOST_SIM
+        sim_ns = p->sim_ns;
+        cpu_ns = p->cpu_ns;
+#endif
+
+        if(format == APDS9930_PROF_CSV)
+        {
+            printf("%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%llu,%llu\r\n",
+                   apds9930_profNames[i], (unsigned long)p->calls,
+                   (unsigned long)p->cost.starts, (unsigned long)p->cost.stops,
+                   (unsigned long)p->cost.bytes_tx, (unsigned long)p->cost.bytes_rx,
+                   (unsigned long)p->cost.nacks, (unsigned long)p->cost.scl_edges,
+                   (unsigned long)p->cost.delay_cycles, sim_ns, cpu_ns);
+        }
+        else
+        {
+            printf("%s\r\n{\"api\":\"%s\",\"calls\":%lu,\"starts\":%lu,\"stops\":%lu,"
+                   "\"bytes_tx\":%lu,\"bytes_rx\":%lu,\"nacks\":%lu,\"scl_edges\":%lu,"
+                   "\"delay_cycles\":%lu,\"sim_ns\":%llu,\"cpu_ns\":%llu}",
+                   first ? "" : ",",
+                   apds9930_profNames[i], (unsigned long)p->calls,
+                   (unsigned long)p->cost.starts, (unsigned long)p->cost.stops,
+                   (unsigned long)p->cost.bytes_tx, (unsigned long)p->cost.bytes_rx,
+                   (unsigned long)p->cost.nacks, (unsigned long)p->cost.scl_edges,
+                   (unsigned long)p->cost.delay_cycles, sim_ns, cpu_ns);
+        }
+        first = 0;
+    }
+
+    if(format == APDS9930_PROF_JSON)
+        printf("\r\n]\r\n");
+}
+
+/**
+ * @brief       check one counter against its per-call baseline
+ * @param       id   APDS9930_PROF_*
+ * @param       field   counter name for the report
+ * @param       total   counter total over calls
+ * @param       calls   number of calls
+ * @param       base   expected per-call value
+ * @param       tolerance_pct   allowed excess in percent
+ * @return      1 on regression, 0 otherwise
+*/
+static uint8_t apds9930_profCheck(uint8_t id, const char *field, uint64_t total,
+                                  uint32_t calls, uint64_t base, uint8_t tolerance_pct)
+{
+    if(total * 100 <= base * calls * (100 + tolerance_pct))
+        return 0;
+
+    printf("REGRESSION %s.%s: %llu per call, baseline %llu\r\n", apds9930_profNames[id],
+           field, (unsigned long long)(total / calls), (unsigned long long)base);
+
+    return 1;
+}
+
+/**
+ * @brief       compare the per-call cost of every called API with a baseline
+ *              Bus counters may not exceed their baseline at all; on the
+ *              host the simulated time may exceed it by tolerance_pct.
+ * @param       baseline   per-call costs, entries with calls == 0 are skipped
+ * @param       tolerance_pct   allowed excess of sim_ns in percent
+ * @return      number of counters above their baseline
+*/
+uint8_t apds9930_profCompare(const apds9930_prof_t *baseline, uint8_t tolerance_pct)
+{
+    const apds9930_prof_t *p;
+    const i2c_stats_t *b;
+    uint8_t failed = 0;
+    uint8_t i;
+
+    for(i = 0; i < APDS9930_PROF_COUNT; i++)
+    {
+        p = &apds9930_prof[i];
+        b = &baseline[i].cost;
+        if(p->calls == 0 || baseline[i].calls == 0)
+            continue;
+
+        failed += apds9930_profCheck(i, "starts", p->cost.starts, p->calls, b->starts, 0);
+        failed += apds9930_profCheck(i, "stops", p->cost.stops, p->calls, b->stops, 0);
+        failed += apds9930_profCheck(i, "bytes_tx", p->cost.bytes_tx, p->calls, b->bytes_tx, 0);
+        failed += apds9930_profCheck(i, "bytes_rx", p->cost.bytes_rx, p->calls, b->bytes_rx, 0);
+        failed += apds9930_profCheck(i, "nacks", p->cost.nacks, p->calls, b->nacks, 0);
+#ifdef APDS9930_HOST_SIM
+        failed += apds9930_profCheck(i, "sim_ns", p->sim_ns, p->calls, baseline[i].sim_ns, tolerance_pct);
+#endif
+    }
+
+    return failed;
+}
+
+#endif
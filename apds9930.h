@@ -1,167 +1,1044 @@
-#ifndef __APDS9930_H
-#define __APDS9930_H
-
-#include <stdbool.h>
-
-/* APDS9930-INT*/
-#define APDS9930_INT_PORT       GPIOA
-#define APDS9930_INT_PIN        GPIO_PIN_0
-
-/*DEBUG*/
-#define DEBUG 0
-
-/* APDS-9930 I2C address */
-#define APDS9930_I2C_ADDR       0x39
-
-/* Command register modes */
-#define REPEATED_BYTE           0x80
-#define AUTO_INCREMENT          0xA0
-#define SPECIAL_FN              0xE0
-
-/* Error code for returned values */
-#define ERROR                   0xFF
-
-/* Acceptable device IDs */
-#define APDS9930_ID_1           0x12
-#define APDS9930_ID_2           0x39
-
-/* Misc parameters */
-#define FIFO_PAUSE_TIME         30      // Wait period (ms) between FIFO reads
-
-/* APDS-9930 registers*/
-#define APDS9930_ENABLE         0x00        /*Enable of states and interrupts*/
-#define APDS9930_ATIME          0x01        /*ALS ADC time*/
-#define APDS9930_PTIME          0X02        /*Proximity ADC time*/
-#define APDS9930_WTIME          0X03        /*Wait time*/
-#define APDS9930_AILTL          0x04        /*ALS interrupt low threshold low byte*/
-#define APDS9930_AILTH          0x05        /*ALS interrupt low threshold hi byte*/
-#define APDS9930_AIHTL          0x06        /*ALS interrupt hi threshold low byte*/
-#define APDS9930_AIHTH          0x07        /*ALS interrupt hi threshold hi byte*/
-#define APDS9930_PILTL          0x08        /*Proximity interrupt low threshold low byte*/
-#define APDS9930_PILTH          0x09        /*Proximity interrupt low threshold hi byte*/
-#define APDS9930_PIHTL          0x0A        /*Proximity interrupt hi threshold low byte*/
-#define APDS9930_PIHTH          0x0B        /*Proximity interrupt hi threshold hi byte*/
-#define APDS9930_PERS           0x0C        /*Interrupt persistence filters*/
-#define APDS9930_CONFIG         0x0D        /*Configuration*/
-#define APDS9930_PPULSE         0x0E        /*Proximity pulse count*/
-#define APDS9930_CONTROL        0x0F        /*Gain control register*/
-#define APDS9930_ID             0x12        /*Device ID*/
-#define APDS9930_STATUS         0x13        /*Device status*/
-#define APDS9930_Ch0DATAL       0x14        /*Ch0 ADC low data register*/
-#define APDS9930_Ch0DATAH       0x15        /*Ch0 ADC high data register*/
-#define APDS9930_Ch1DATAL       0x16        /*Ch1 ADC low data register*/
-#define APDS9930_Ch1DATAH       0x17        /*Ch1 ADC high data register*/
-#define APDS9930_PDATAL         0x18        /*Proximity ADC low data register*/
-#define APDS9930_PDATAH         0x19        /*Proximity ADC high data register*/
-#define APDS9930_POFFSET        0x1E        /*Proximity offset register*/
-
-/*bit fields*/
-#define APDS9930_PON            0b00000001
-#define APDS9930_AEN            0b00000010
-#define APDS9930_PEN            0b00000100
-#define APDS9930_WEN            0b00001000
-#define APSD9930_AIEN           0b00010000
-#define APDS9930_PIEN           0b00100000
-#define APDS9930_SAI            0b01000000
-
-/*on/off definitions*/
-#define OFF                     0
-#define ON                      1
-
-/* Acceptable parameters for setMode */
-#define POWER                   0
-#define AMBIENT_LIGHT           1
-#define PROXIMITY               2
-#define WAIT                    3
-#define AMBIENT_LIGHT_INT       4
-#define PROXIMITY_INT           5
-#define SLEEP_AFTER_INT         6
-#define ALL                     7
-
-/* LED Drive values */
-#define LED_DRIVE_100MA         0
-#define LED_DRIVE_50MA          1
-#define LED_DRIVE_25MA          2
-#define LED_DRIVE_12_5MA        3
-
-/* Proximity Gain (PGAIN) values */
-#define PGAIN_1X                0
-#define PGAIN_2X                1
-#define PGAIN_4X                2
-#define PGAIN_8X                3
-
-/* ALS Gain (AGAIN) values */
-#define AGAIN_1X                0
-#define AGAIN_8X                1
-#define AGAIN_16X               2
-#define AGAIN_120X              3
-
-/* Interrupt clear values */
-#define CLEAR_PROX_INT          0xE5
-#define CLEAR_ALS_INT           0xE6
-#define CLEAR_ALL_INTS          0xE7
-
-/* Default values */
-#define DEFAULT_ATIME           0xED
-#define DEFAULT_WTIME           0xFF
-#define DEFAULT_PTIME           0xFF
-#define DEFAULT_PPULSE          0x08
-#define DEFAULT_POFFSET         0       // 0 offset
-#define DEFAULT_CONFIG          0
-#define DEFAULT_PDRIVE          LED_DRIVE_100MA
-#define DEFAULT_PDIODE          2
-#define DEFAULT_PGAIN           PGAIN_8X
-#define DEFAULT_AGAIN           AGAIN_1X
-#define DEFAULT_PILT            0       // Low proximity threshold
-#define DEFAULT_PIHT            50      // High proximity threshold
-#define DEFAULT_AILT            0xFFFF  // Force interrupt for calibration
-#define DEFAULT_AIHT            0
-#define DEFAULT_PERS            0x22    // 2 consecutive prox or ALS for int.
-
-/* ALS coefficients */
-#define DF                      52
-#define GA                      0.49
-#define ALS_B                   1.862
-#define ALS_C                   0.746
-#define ALS_D                   1.291
-
-/* State definitions */
-enum {
-  NOTAVAILABLE_STATE,
-  NEAR_STATE,
-  FAR_STATE,
-  ALL_STATE
-};
-
-
-
-/* APDS9930 functions*/
-void apds9930_init(void);
-uint8_t apds9930_getMode(void);
-void apds9930_setMode(uint8_t mode, uint8_t enable);
-uint16_t apds9930_readCh0Light(void);
-uint16_t apds9930_readCh1Light(void);
-uint16_t apds9930_readProximity(void);
-void apds9930_setLightIntLowThreshold(uint16_t threshold);
-void apds9930_setLightIntHighThreshold(uint16_t threshold);
-float apds9930_readAmbientLightLux(uint8_t light_gain);
-void apds9930_setLEDDriver(uint8_t driver);
-void apds9930_setProximityGain(uint8_t driver);
-void apds9930_setAmbientLightGain(uint8_t drive);
-void apds9930_setProximityDiode(uint8_t drive);
-void apds9930_setProximityIntLowThreshold(uint16_t threshold);
-void apds9930_setProximityIntHighThreshold(uint16_t threshold);
-void apds9930_enableLightSensor(bool interrupts);
-void apds9930_setAmbientLightIntEnable(uint8_t enable);
-void apds9930_enablePower(void);
-void apds9930_disablePower(void);
-void apds9930_disableLightSensor(void);
-uint8_t apds9930_getAmbientLightGain(void);
-void apds9930_WriteRegData(uint8_t address, uint8_t dat);
-uint8_t apds9930_readRegData(uint8_t address);
-void apds9930_clearAmbientLightInt(void);
-void apds9930_clearAllInts(void);
-uint16_t apds9930_getLightIntLowThreshold(void);
-uint16_t apds9930_getLightIntHighThreshold(void);
-#endif
-
+#ifndef __APDS9930_H
+#define __APDS9930_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "apds9930_bus.h"
+
+#ifdef APDS9930_HOST_SIM
+#include "apds9930_sim.h"
+#endif
+
+/* APDS9930-INT*/
+#define APDS9930_INT_PORT       GPIOA
+#define APDS9930_INT_PIN        GPIO_PIN_0
+#define APDS9930_INT_IRQn       EXTI0_1_IRQn
+#define APDS9930_INT_PRIORITY   3
+
+/* Tracking window never narrower than this many Ch0 counts either side */
+#ifndef APDS9930_TRACK_MIN_COUNTS
+#define APDS9930_TRACK_MIN_COUNTS   4
+#endif
+
+/* Auto-ranging: ranges from least (0, AGL) to most sensitive */
+#define APDS9930_RANGE_COUNT        6
+#define APDS9930_RANGE_DEFAULT      1       /* 1x at DEFAULT_ATIME */
+
+/* Step down above this share of full scale, step up only if the new range
+   is predicted to stay below the lower share */
+#ifndef APDS9930_RANGE_HIGH_PCT
+#define APDS9930_RANGE_HIGH_PCT     80
+#endif
+#ifndef APDS9930_RANGE_LOW_PCT
+#define APDS9930_RANGE_LOW_PCT      50
+#endif
+
+/* Configuration batches rewrite up to this many unchanged registers from
+   the shadow rather than open another transaction, which costs about as
+   much as two data bytes */
+#ifndef APDS9930_COALESCE_GAP
+#define APDS9930_COALESCE_GAP   2
+#endif
+
+/* Scheduled reads start this long after the predicted end of a conversion */
+#ifndef APDS9930_SCHED_GUARD_US
+#define APDS9930_SCHED_GUARD_US 100
+#endif
+
+/* The float reference apds9930_calcLux() is built on the host and with
+   APDS9930_FLOAT_LUX; on a core without an FPU it pulls in soft-float */
+#if defined(APDS9930_HOST_SIM) && !defined(APDS9930_FLOAT_LUX)
+#define APDS9930_FLOAT_LUX
+#endif
+
+/* Depth of the interrupt sample ring, a power of two */
+#ifndef APDS9930_RING_SIZE
+#define APDS9930_RING_SIZE      16
+#endif
+
+/*DEBUG*/
+#define DEBUG 0
+
+/* APDS-9930 I2C address */
+#define APDS9930_I2C_ADDR       0x39
+
+/* Command register modes */
+#define REPEATED_BYTE           0x80
+#define AUTO_INCREMENT          0xA0
+#define SPECIAL_FN              0xE0
+
+/* Error code for returned values */
+#define ERROR                   0xFF
+
+/* Acceptable device IDs */
+#define APDS9930_ID_1           0x12
+#define APDS9930_ID_2           0x39
+
+/* Misc parameters */
+#define FIFO_PAUSE_TIME         30      // Wait period (ms) between FIFO reads
+
+/* APDS-9930 registers*/
+#define APDS9930_ENABLE         0x00        /*Enable of states and interrupts*/
+#define APDS9930_ATIME          0x01        /*ALS ADC time*/
+#define APDS9930_PTIME          0X02        /*Proximity ADC time*/
+#define APDS9930_WTIME          0X03        /*Wait time*/
+#define APDS9930_AILTL          0x04        /*ALS interrupt low threshold low byte*/
+#define APDS9930_AILTH          0x05        /*ALS interrupt low threshold hi byte*/
+#define APDS9930_AIHTL          0x06        /*ALS interrupt hi threshold low byte*/
+#define APDS9930_AIHTH          0x07        /*ALS interrupt hi threshold hi byte*/
+#define APDS9930_PILTL          0x08        /*Proximity interrupt low threshold low byte*/
+#define APDS9930_PILTH          0x09        /*Proximity interrupt low threshold hi byte*/
+#define APDS9930_PIHTL          0x0A        /*Proximity interrupt hi threshold low byte*/
+#define APDS9930_PIHTH          0x0B        /*Proximity interrupt hi threshold hi byte*/
+#define APDS9930_PERS           0x0C        /*Interrupt persistence filters*/
+#define APDS9930_CONFIG         0x0D        /*Configuration*/
+#define APDS9930_PPULSE         0x0E        /*Proximity pulse count*/
+#define APDS9930_CONTROL        0x0F        /*Gain control register*/
+#define APDS9930_ID             0x12        /*Device ID*/
+#define APDS9930_STATUS         0x13        /*Device status*/
+#define APDS9930_Ch0DATAL       0x14        /*Ch0 ADC low data register*/
+#define APDS9930_Ch0DATAH       0x15        /*Ch0 ADC high data register*/
+#define APDS9930_Ch1DATAL       0x16        /*Ch1 ADC low data register*/
+#define APDS9930_Ch1DATAH       0x17        /*Ch1 ADC high data register*/
+#define APDS9930_PDATAL         0x18        /*Proximity ADC low data register*/
+#define APDS9930_PDATAH         0x19        /*Proximity ADC high data register*/
+#define APDS9930_POFFSET        0x1E        /*Proximity offset register*/
+
+/* State machine timing */
+#define APDS9930_STEP_US        2730    // Init/ADC/wait step
+#define APDS9930_PULSE_US       16      // Prox Accum time per LED pulse
+#define APDS9930_LED_ON_NS      7300    // LED on time of each pulse
+
+/* Typical supply currents at VDD = 3 V for the power planner, nA */
+#define APDS9930_IDD_ACTIVE_NA  195000UL    // Init, Accum and ADC states
+#define APDS9930_IDD_WAIT_NA    90000UL     // Wait state
+#define APDS9930_IDD_LDR_NA     3000000UL   // extra IDD while the LED is on
+#define APDS9930_LED_DRIVE_NA   100000000UL // LED sink at PDRIVE 0, halved per step
+
+/* MCU side of every sample: run current while it reads the burst and clears
+   INT, and how long that takes; set for the board's clock and bus */
+#ifndef APDS9930_MCU_RUN_NA
+#define APDS9930_MCU_RUN_NA     3000000UL
+#endif
+#ifndef APDS9930_MCU_SAMPLE_US
+#define APDS9930_MCU_SAMPLE_US  300
+#endif
+
+/* Supply voltage the energy per sample is reported at */
+#ifndef APDS9930_VDD_MV
+#define APDS9930_VDD_MV         3000
+#endif
+
+/* Register shadow layout: 0x00-0x0F followed by POFFSET */
+#define APDS9930_SHADOW_POFFSET (APDS9930_CONTROL + 1)
+#define APDS9930_SHADOW_SIZE    (APDS9930_SHADOW_POFFSET + 1)
+
+/*bit fields*/
+#define APDS9930_PON            0b00000001
+#define APDS9930_AEN            0b00000010
+#define APDS9930_PEN            0b00000100
+#define APDS9930_WEN            0b00001000
+#define APDS9930_AIEN           0b00010000
+#define APSD9930_AIEN           APDS9930_AIEN   // original misspelling
+#define APDS9930_PIEN           0b00100000
+#define APDS9930_SAI            0b01000000
+
+/*config bits*/
+#define APDS9930_PDL            0b00000001
+#define APDS9930_WLONG          0b00000010
+#define APDS9930_AGL            0b00000100
+
+/*status bits*/
+#define APDS9930_AVALID         0b00000001
+#define APDS9930_PVALID         0b00000010
+#define APDS9930_AINT           0b00010000
+#define APDS9930_PINT           0b00100000
+#define APDS9930_PSAT           0b01000000
+
+/* STATUS..PDATAH data block length */
+#define APDS9930_SAMPLE_LEN     (APDS9930_PDATAH - APDS9930_STATUS + 1)
+
+/*on/off definitions*/
+#define OFF                     0
+#define ON                      1
+
+/* Acceptable parameters for setMode */
+#define POWER                   0
+#define AMBIENT_LIGHT           1
+#define PROXIMITY               2
+#define WAIT                    3
+#define AMBIENT_LIGHT_INT       4
+#define PROXIMITY_INT           5
+#define SLEEP_AFTER_INT         6
+#define ALL                     7
+
+/* LED Drive values */
+#define LED_DRIVE_100MA         0
+#define LED_DRIVE_50MA          1
+#define LED_DRIVE_25MA          2
+#define LED_DRIVE_12_5MA        3
+
+/* Proximity Gain (PGAIN) values */
+#define PGAIN_1X                0
+#define PGAIN_2X                1
+#define PGAIN_4X                2
+#define PGAIN_8X                3
+
+/* ALS Gain (AGAIN) values */
+#define AGAIN_1X                0
+#define AGAIN_8X                1
+#define AGAIN_16X               2
+#define AGAIN_120X              3
+
+/* Interrupt clear values */
+#define CLEAR_PROX_INT          0xE5
+#define CLEAR_ALS_INT           0xE6
+#define CLEAR_ALL_INTS          0xE7
+
+/* Default values */
+#define DEFAULT_ATIME           0xED
+#define DEFAULT_WTIME           0xFF
+#define DEFAULT_PTIME           0xFF
+#define DEFAULT_PPULSE          0x08
+#define DEFAULT_POFFSET         0       // 0 offset
+#define DEFAULT_CONFIG          0
+#define DEFAULT_PDRIVE          LED_DRIVE_100MA
+#define DEFAULT_PDIODE          2
+#define DEFAULT_PGAIN           PGAIN_8X
+#define DEFAULT_AGAIN           AGAIN_1X
+#define DEFAULT_PILT            0       // Low proximity threshold
+#define DEFAULT_PIHT            50      // High proximity threshold
+#define DEFAULT_AILT            0xFFFF  // Force interrupt for calibration
+#define DEFAULT_AIHT            0
+#define DEFAULT_PERS            0x22    // 2 consecutive prox or ALS for int.
+
+/* CONTROL register value from its four fields */
+#define APDS9930_CONTROL_VAL(pdrive, pdiode, pgain, again) \
+    ((uint8_t)((((pdrive) & 0x03) << 6) | (((pdiode) & 0x03) << 4) | \
+               (((pgain) & 0x03) << 2) | ((again) & 0x03)))
+
+/*
+ * Register image argument list, in this order:
+ * enable, atime, ptime, wtime, ailt, aiht, pilt, piht, pers, config,
+ * ppulse, pdrive, pdiode, pgain, again, poffset
+ */
+#define APDS9930_DEFAULT_CONFIG \
+    0, DEFAULT_ATIME, DEFAULT_PTIME, DEFAULT_WTIME, DEFAULT_AILT, DEFAULT_AIHT, \
+    DEFAULT_PILT, DEFAULT_PIHT, DEFAULT_PERS, DEFAULT_CONFIG, DEFAULT_PPULSE, \
+    DEFAULT_PDRIVE, DEFAULT_PDIODE, DEFAULT_PGAIN, DEFAULT_AGAIN, DEFAULT_POFFSET
+
+/* Build an apds9930_regs_t initializer from an argument list */
+#define APDS9930_REGS_IMAGE(...)  APDS9930_REGS_IMAGE_(__VA_ARGS__)
+#define APDS9930_REGS_IMAGE_(enable, atime, ptime, wtime, ailt, aiht, pilt, piht, \
+                             pers, config, ppulse, pdrive, pdiode, pgain, again, poffset) \
+    { { (enable), (atime), (ptime), (wtime), \
+        (ailt) & 0xFF, ((ailt) >> 8) & 0xFF, (aiht) & 0xFF, ((aiht) >> 8) & 0xFF, \
+        (pilt) & 0xFF, ((pilt) >> 8) & 0xFF, (piht) & 0xFF, ((piht) >> 8) & 0xFF, \
+        (pers), (config), (ppulse), \
+        APDS9930_CONTROL_VAL(pdrive, pdiode, pgain, again) }, (poffset) }
+
+/* Constant expression: true if every field of an argument list is in range */
+#define APDS9930_REGS_VALID(...)  APDS9930_REGS_VALID_(__VA_ARGS__)
+#define APDS9930_REGS_VALID_(enable, atime, ptime, wtime, ailt, aiht, pilt, piht, \
+                             pers, config, ppulse, pdrive, pdiode, pgain, again, poffset) \
+    ((enable) >= 0 && (enable) <= 0x7F && \
+     (atime) >= 0 && (atime) <= 0xFF && (ptime) >= 0 && (ptime) <= 0xFF && \
+     (wtime) >= 0 && (wtime) <= 0xFF && \
+     (ailt) >= 0 && (ailt) <= 0xFFFF && (aiht) >= 0 && (aiht) <= 0xFFFF && \
+     (pilt) >= 0 && (pilt) <= 0xFFFF && (piht) >= 0 && (piht) <= 0xFFFF && \
+     (pers) >= 0 && (pers) <= 0xFF && (config) >= 0 && (config) <= 0x07 && \
+     (ppulse) >= 0 && (ppulse) <= 0xFF && \
+     (pdrive) >= 0 && (pdrive) <= 3 && (pdiode) >= 0 && (pdiode) <= 3 && \
+     (pgain) >= 0 && (pgain) <= 3 && (again) >= 0 && (again) <= 3 && \
+     !(((config) & APDS9930_AGL) && (again) > AGAIN_8X) && \
+     (poffset) >= 0 && (poffset) <= 0xFF)
+
+/* Reject an out-of-range register image at compile time */
+#define APDS9930_REGS_ASSERT(...) \
+    _Static_assert(APDS9930_REGS_VALID(__VA_ARGS__), "invalid APDS9930 register image")
+
+/* ALS coefficients */
+#define DF                      52
+#define GA                      0.49
+#define ALS_B                   1.862
+#define ALS_C                   0.746
+#define ALS_D                   1.291
+
+/* ALS coefficients in Q14 for the integer lux path */
+#define ALS_B_Q14               30507
+#define ALS_C_Q14               12222
+#define ALS_D_Q14               21152
+
+/* GA*DF/2.73 ms in mlux per count per integration step, Q16 */
+#define APDS9930_LPC_Q16_NUM    611669333UL
+
+/* Q16 mlux per count for an ATIME value and a gain multiplier, a constant expression */
+#define APDS9930_LPC_Q16(atime, gain_x) \
+    (APDS9930_LPC_Q16_NUM / ((256UL - (atime)) * (gain_x)))
+
+/* State definitions */
+enum {
+  NOTAVAILABLE_STATE,
+  NEAR_STATE,
+  FAR_STATE,
+  ALL_STATE
+};
+
+/* Image of the writable registers 0x00-0x0F plus POFFSET */
+typedef struct {
+    uint8_t reg[APDS9930_CONTROL + 1];
+    uint8_t poffset;
+} apds9930_regs_t;
+
+/* One STATUS + Ch0 + Ch1 + PDATA snapshot */
+typedef struct {
+    uint8_t  status;
+    uint16_t ch0;
+    uint16_t ch1;
+    uint16_t proximity;
+} apds9930_sample_t;
+
+/* Stores a calibrated POFFSET, e.g. to flash */
+typedef void (*apds9930_poffset_save_t)(uint8_t poffset);
+
+/* Sample captured by apds9930_onInterrupt() */
+typedef struct {
+    uint32_t tick;              /* HAL tick of the INT edge */
+    apds9930_sample_t sample;
+    uint8_t  prox_state;        /* NEAR_STATE/FAR_STATE after this sample */
+} apds9930_event_t;
+
+/* Counters of the conversion-synchronous reader, see apds9930_dev_pollSample() */
+typedef struct {
+    uint32_t reads;             /* STATUS+data bursts issued */
+    uint32_t fresh;             /* bursts that returned a new conversion */
+    uint32_t early;             /* bursts before the valid bits were set, retried */
+    uint32_t avoided;           /* polls answered without bus access */
+    uint32_t missed;            /* conversions replaced before they were read */
+    uint32_t rate_mhz;          /* fresh samples per 1000 s since the start */
+    uint32_t lat_min_us;        /* read start after the predicted end of conversion */
+    uint32_t lat_max_us;
+} apds9930_sched_stats_t;
+
+/* Duty-cycle settings and their estimated cost, see apds9930_dev_planPowerForRate() */
+typedef struct {
+    uint8_t  enable;            /* PON, the engines, WEN if there is a Wait state, SAI with interrupts */
+    uint8_t  atime;
+    uint8_t  ptime;
+    uint8_t  wtime;
+    uint8_t  config;            /* WLONG set for waits beyond 256 steps */
+    uint8_t  ppulse;
+    uint32_t period_us;         /* one Prox/Wait/ALS cycle, one sample */
+    uint32_t rate_mhz;          /* samples per 1000 s */
+    uint32_t sensor_na;         /* average APDS-9930 supply current, LED pulses included */
+    uint32_t mcu_na;            /* average MCU current for reading the samples */
+    uint32_t sample_nj;         /* sensor plus MCU energy per sample at APDS9930_VDD_MV */
+} apds9930_power_t;
+
+/*
+ * One sensor: its transport and address plus everything the driver keeps
+ * about it. Every apds9930_dev_*() call takes one. The apds9930_*() free
+ * functions are inline wrappers bound to apds9930_dev_default, whose
+ * address is a link-time constant like the former file-scope state.
+ */
+typedef struct {
+    const apds9930_bus_t *bus;  /* transport every register access goes through */
+    uint8_t  addr;              /* 7-bit I2C address */
+    uint8_t  shadow[APDS9930_SHADOW_SIZE];  /* RAM copy of the writable registers */
+    uint32_t readyTick;         /* HAL tick the first enabled conversion is valid at */
+
+    /* configuration batch, see apds9930_dev_beginConfig() */
+    uint8_t  cfgDepth;          /* nesting of open batches, 0 = writes go out at once */
+    uint8_t  cfgEnable;         /* ENABLE when the outermost batch was opened */
+    uint32_t cfgDirty;          /* bit per shadow slot staged but not written */
+
+    /* auto-ranging */
+    uint8_t  range;
+    uint8_t  rangeSettle;       /* samples still to discard after a range change */
+
+    /* half-width of the ALS tracking window in percent, 0 = off */
+    uint8_t  trackBand;
+
+    /* conversion-synchronous reads, schedMask 0 while off */
+    uint8_t  schedMask;         /* valid bits a sample needs */
+    uint32_t schedDue;          /* us time the next conversion ends, a multiple of the cycle */
+    uint32_t schedRetry;        /* us time of the next read, later than schedDue after an early read */
+    uint32_t schedStart;        /* us time the schedule was started */
+    apds9930_sched_stats_t sched;
+
+    /* NEAR/FAR presence detection, NOTAVAILABLE_STATE while off */
+    volatile uint8_t proxState;
+    uint16_t proxNear;
+    uint16_t proxFar;
+
+    /*
+     * Samples captured by apds9930_dev_onInterrupt(). Single producer (the
+     * EXTI handler) advances head, single consumer (the main loop) advances
+     * tail; both only ever grow and are masked on access.
+     */
+    apds9930_event_t ring[APDS9930_RING_SIZE];
+    volatile uint32_t ringHead;
+    volatile uint32_t ringTail;
+    volatile uint32_t ringDropped;
+
+    /* INT line */
+#ifdef APDS9930_HOST_SIM
+    apds9930_sim_t *int_sim;    /* model whose INT drives this instance, NULL = apds9930_sim_default */
+#else
+    GPIO_TypeDef *int_port;     /* falling-edge EXTI pin */
+    uint16_t int_pin;
+    IRQn_Type int_irq;
+#endif
+} apds9930_dev_t;
+
+/* Sensor on bus at addr with INT on APDS9930_INT_PIN; set the int_* fields
+   before the interrupt-driven modes if INT is wired elsewhere */
+#ifdef APDS9930_HOST_SIM
+#define APDS9930_DEV_INIT(bus_, addr_) \
+    { .bus = (bus_), .addr = (addr_), .range = APDS9930_RANGE_DEFAULT, .proxState = NOTAVAILABLE_STATE }
+#else
+#define APDS9930_DEV_INIT(bus_, addr_) \
+    { .bus = (bus_), .addr = (addr_), .range = APDS9930_RANGE_DEFAULT, .proxState = NOTAVAILABLE_STATE, \
+      .int_port = APDS9930_INT_PORT, .int_pin = APDS9930_INT_PIN, .int_irq = APDS9930_INT_IRQn }
+#endif
+
+/* Instance behind the apds9930_*() free functions */
+extern apds9930_dev_t apds9930_dev_default;
+
+/*
+ * Low-power platform for apds9930_dev_waitEvent(). arm() routes the INT
+ * line of a device to a STOP-mode wake-up source without running its EXTI
+ * handler. stop() enters STOP unless INT is already low. It returns in run
+ * mode with the clocks and bus timing restored, and reports whether INT is
+ * low. Everything done around STOP sits behind these two calls, so a test
+ * can replace the whole transition.
+ */
+typedef struct {
+    void (*arm)(void *ctx, apds9930_dev_t *dev);
+    bool (*stop)(void *ctx, apds9930_dev_t *dev);
+    void *ctx;
+} apds9930_lp_t;
+
+#ifdef APDS9930_HOST_SIM
+/* Sleeps in simulated time, bound to apds9930_lp_sim_default */
+extern const apds9930_lp_t apds9930_lp_sim;
+#else
+/* STM32L0 STOP mode with the low-power regulator, see apds9930_lp_stm32l0_attach() */
+extern const apds9930_lp_t apds9930_lp_stm32l0;
+
+void apds9930_lp_stm32l0_attach(void (*resume)(void));
+#endif
+
+
+/*
+ * Per-API bus cost profiling. Build with APDS9930_PROFILE and IIC_STATS;
+ * each profiled call adds the iic.c counters it consumed, nested public
+ * calls included, to apds9930_prof[id]. Without APDS9930_PROFILE the
+ * scope macros expand to nothing.
+ */
+#ifdef APDS9930_PROFILE
+
+#ifndef IIC_STATS
+#error "APDS9930_PROFILE needs the IIC_STATS bus counters"
+#endif
+
+#include "iic.h"
+
+enum {
+  APDS9930_PROF_INIT,
+  APDS9930_PROF_SET_MODE,
+  APDS9930_PROF_READ_SAMPLE,
+  APDS9930_PROF_READ_CH0,
+  APDS9930_PROF_READ_CH1,
+  APDS9930_PROF_READ_PROXIMITY,
+  APDS9930_PROF_READ_LUX,
+  APDS9930_PROF_SET_LIGHT_THRESHOLD,
+  APDS9930_PROF_SET_LIGHT_WINDOW,
+  APDS9930_PROF_SET_PROX_THRESHOLD,
+  APDS9930_PROF_SET_PROX_WINDOW,
+  APDS9930_PROF_SET_PROX_INT_ENABLE,
+  APDS9930_PROF_SET_CONTROL,
+  APDS9930_PROF_SET_LIGHT_INT_ENABLE,
+  APDS9930_PROF_ENABLE_LIGHT,
+  APDS9930_PROF_DISABLE_LIGHT,
+  APDS9930_PROF_CLEAR_INT,
+  APDS9930_PROF_RESYNC,
+  APDS9930_PROF_VERIFY,
+  APDS9930_PROF_WAIT_READY,
+  APDS9930_PROF_COUNT
+};
+
+typedef struct {
+    uint32_t calls;
+    i2c_stats_t cost;
+#ifdef APDS9930_HOST_SIM
+    uint64_t sim_ns;            /* simulated time spent, bus and device waits */
+    uint64_t cpu_ns;            /* host CPU time spent */
+#endif
+} apds9930_prof_t;
+
+/* Counter snapshot taken when a profiled call starts */
+typedef struct {
+    i2c_stats_t bus;
+#ifdef APDS9930_HOST_SIM
+    uint64_t sim_ns;
+    uint64_t cpu_ns;
+#endif
+} apds9930_prof_mark_t;
+
+/* Report formats of apds9930_profPrint() */
+enum {
+  APDS9930_PROF_CSV,
+  APDS9930_PROF_JSON
+};
+
+extern apds9930_prof_t apds9930_prof[APDS9930_PROF_COUNT];
+
+#define APDS9930_PROF_BEGIN()   apds9930_prof_mark_t apds9930_prof_start; apds9930_profMark(&apds9930_prof_start)
+#define APDS9930_PROF_END(id)   apds9930_profEnd((id), &apds9930_prof_start)
+
+void apds9930_profMark(apds9930_prof_mark_t *mark);
+void apds9930_profEnd(uint8_t id, const apds9930_prof_mark_t *start);
+void apds9930_profReset(void);
+const char *apds9930_profName(uint8_t id);
+void apds9930_profPrint(uint8_t format);
+uint8_t apds9930_profCompare(const apds9930_prof_t *baseline, uint8_t tolerance_pct);
+
+#else
+
+#define APDS9930_PROF_BEGIN()
+#define APDS9930_PROF_END(id)
+
+#endif
+
+/*
+ * Parallel bit-banged bus (IIC_PARALLEL): identical sensors, one per SDA
+ * line, share SCL and every byte time. Transfers go to all lanes at once
+ * and return a mask of the lanes that did not ACK.
+ */
+#ifdef IIC_PARALLEL
+#include "iic.h"
+
+uint16_t apds9930_bus_iic_readParallel(const iic_par_t *par, uint8_t addr, uint8_t cmd, uint8_t *buf, uint8_t len);
+uint16_t apds9930_bus_iic_writeParallel(const iic_par_t *par, uint8_t addr, uint8_t cmd, const uint8_t *buf, uint8_t len);
+uint16_t apds9930_readSampleParallel(const iic_par_t *par, apds9930_sample_t *samples);
+#endif
+
+/*
+ * Non-blocking operations (APDS9930_ASYNC). apds9930_async_*() only fills
+ * in an apds9930_async_t; each apds9930_async_step() then runs bus phases
+ * (START, one byte, STOP) until the next one would overrun slice_us, and
+ * never waits for the device. On apds9930_bus_iic a phase is one byte, on
+ * any other transport it is a whole transfer. The bus is held from START
+ * to STOP across steps, so nothing else may use it until the op is done.
+ */
+#ifdef APDS9930_ASYNC
+
+/* apds9930_async_t.status */
+#define APDS9930_ASYNC_BUSY     0
+#define APDS9930_ASYNC_DONE     1
+#define APDS9930_ASYNC_NACK     2
+#define APDS9930_ASYNC_BAD_ID   3
+
+/* Bus time one step() may take, at least one byte time (23 us at 400 kHz) */
+#ifndef APDS9930_ASYNC_SLICE_US
+#define APDS9930_ASYNC_SLICE_US 100
+#endif
+
+typedef struct apds9930_async apds9930_async_t;
+
+struct apds9930_async {
+    apds9930_dev_t *dev;
+    void (*done)(apds9930_async_t *op);     /* called by the final step(), may be NULL */
+    void *arg;                  /* free for the caller, e.g. for done */
+    uint16_t slice_us;          /* APDS9930_ASYNC_SLICE_US unless changed after start */
+    volatile uint8_t status;    /* APDS9930_ASYNC_* */
+
+    /* operation */
+    uint8_t  op;
+    uint8_t  stage;
+    const apds9930_regs_t *regs;
+    apds9930_sample_t *sample;
+
+    /* transfer in progress */
+    uint8_t  phase;
+    uint8_t  idx;
+    uint8_t  rd;
+    uint8_t  cmd;
+    uint8_t  len;
+    uint8_t  nack;
+    uint8_t  buf[APDS9930_CONTROL + 1];
+};
+
+void apds9930_async_init(apds9930_async_t *op, apds9930_dev_t *dev, const apds9930_regs_t *regs,
+                         void (*done)(apds9930_async_t *op));
+void apds9930_async_readSample(apds9930_async_t *op, apds9930_dev_t *dev, apds9930_sample_t *sample,
+                               void (*done)(apds9930_async_t *op));
+void apds9930_async_setLightIntWindow(apds9930_async_t *op, apds9930_dev_t *dev, uint16_t low, uint16_t high,
+                                      void (*done)(apds9930_async_t *op));
+uint8_t apds9930_async_step(apds9930_async_t *op);
+#endif
+
+/* APDS9930 functions*/
+uint32_t apds9930_getLpcQ16(uint8_t again, uint8_t atime);
+uint32_t apds9930_scaleMilliLux(uint16_t ch0, uint16_t ch1, uint32_t lpc);
+uint32_t apds9930_calcMilliLux(uint16_t ch0, uint16_t ch1, uint8_t again, uint8_t atime);
+void apds9930_calcMilliLuxBatch(const uint16_t *ch0, const uint16_t *ch1, const uint8_t *again,
+                                uint8_t atime, uint32_t *mlux, uint32_t n);
+void apds9930_calcMilliLuxBatchScalar(const uint16_t *ch0, const uint16_t *ch1, const uint8_t *again,
+                                      uint8_t atime, uint32_t *mlux, uint32_t n);
+#ifdef APDS9930_FLOAT_LUX
+float apds9930_calcLux(uint16_t ch0, uint16_t ch1, uint8_t again, uint8_t atime);
+#endif
+
+/* Per-device API */
+void apds9930_dev_setBus(apds9930_dev_t *dev, const apds9930_bus_t *bus);
+void apds9930_dev_WriteRegData(apds9930_dev_t *dev, uint8_t address, uint8_t dat);
+void apds9930_dev_wireWriteByte(apds9930_dev_t *dev, uint8_t val);
+uint8_t apds9930_dev_readRegData(apds9930_dev_t *dev, uint8_t address);
+void apds9930_dev_writeRegBlock(apds9930_dev_t *dev, uint8_t address, const uint8_t *buf, uint8_t len);
+void apds9930_dev_readRegBlock(apds9930_dev_t *dev, uint8_t address, uint8_t *buf, uint8_t len);
+void apds9930_dev_beginConfig(apds9930_dev_t *dev);
+void apds9930_dev_commitConfig(apds9930_dev_t *dev);
+void apds9930_dev_readSample(apds9930_dev_t *dev, apds9930_sample_t *sample);
+uint8_t apds9930_dev_getRegShadow(apds9930_dev_t *dev, uint8_t address);
+void apds9930_dev_resync(apds9930_dev_t *dev);
+bool apds9930_dev_verify(apds9930_dev_t *dev);
+uint8_t apds9930_dev_init(apds9930_dev_t *dev);
+uint8_t apds9930_dev_initRegs(apds9930_dev_t *dev, const apds9930_regs_t *regs);
+uint32_t apds9930_dev_getCycleTimeUs(apds9930_dev_t *dev);
+uint32_t apds9930_dev_getFirstValidTimeUs(apds9930_dev_t *dev, uint8_t valid_mask);
+uint32_t apds9930_dev_getReadyTick(apds9930_dev_t *dev);
+bool apds9930_dev_waitReady(apds9930_dev_t *dev, uint8_t valid_mask, uint32_t timeout_ms);
+void apds9930_dev_startSchedule(apds9930_dev_t *dev, uint8_t valid_mask);
+void apds9930_dev_stopSchedule(apds9930_dev_t *dev);
+bool apds9930_dev_pollSample(apds9930_dev_t *dev, apds9930_sample_t *sample);
+void apds9930_dev_getScheduleStats(apds9930_dev_t *dev, apds9930_sched_stats_t *stats);
+bool apds9930_dev_planPowerForRate(apds9930_dev_t *dev, apds9930_power_t *plan, uint8_t engines, uint32_t rate_mhz);
+bool apds9930_dev_planPowerForCurrent(apds9930_dev_t *dev, apds9930_power_t *plan, uint8_t engines, uint32_t budget_na);
+void apds9930_dev_getPowerEstimate(apds9930_dev_t *dev, apds9930_power_t *plan);
+void apds9930_dev_applyPowerPlan(apds9930_dev_t *dev, const apds9930_power_t *plan);
+uint8_t apds9930_dev_getMode(apds9930_dev_t *dev);
+void apds9930_dev_setMode(apds9930_dev_t *dev, uint8_t mode, uint8_t enable);
+void apds9930_dev_enableLightSensor(apds9930_dev_t *dev, bool interrupts);
+void apds9930_dev_disableLightSensor(apds9930_dev_t *dev);
+uint8_t apds9930_dev_getAmbientLightGain(apds9930_dev_t *dev);
+uint16_t apds9930_dev_readCh0Light(apds9930_dev_t *dev);
+uint16_t apds9930_dev_readCh1Light(apds9930_dev_t *dev);
+uint16_t apds9930_dev_readProximity(apds9930_dev_t *dev);
+void apds9930_dev_setLightIntLowThreshold(apds9930_dev_t *dev, uint16_t threshold);
+void apds9930_dev_setLightIntHighThreshold(apds9930_dev_t *dev, uint16_t threshold);
+void apds9930_dev_setLightIntWindow(apds9930_dev_t *dev, uint16_t low, uint16_t high);
+void apds9930_dev_trackLight(apds9930_dev_t *dev, uint16_t ch0);
+uint32_t apds9930_dev_readAmbientLightMilliLux(apds9930_dev_t *dev);
+float apds9930_dev_readAmbientLightLux(apds9930_dev_t *dev, uint8_t light_gain);
+void apds9930_dev_setRange(apds9930_dev_t *dev, uint8_t range);
+uint8_t apds9930_dev_getRange(apds9930_dev_t *dev);
+bool apds9930_dev_autoRange(apds9930_dev_t *dev, const apds9930_sample_t *sample, uint32_t *mlux);
+bool apds9930_dev_readAmbientLightAuto(apds9930_dev_t *dev, uint32_t *mlux);
+void apds9930_dev_setLEDDriver(apds9930_dev_t *dev, uint8_t driver);
+void apds9930_dev_setProximityGain(apds9930_dev_t *dev, uint8_t driver);
+void apds9930_dev_setAmbientLightGain(apds9930_dev_t *dev, uint8_t drive);
+void apds9930_dev_setProximityDiode(apds9930_dev_t *dev, uint8_t drive);
+void apds9930_dev_setProximityIntLowThreshold(apds9930_dev_t *dev, uint16_t threshold);
+void apds9930_dev_setProximityIntHighThreshold(apds9930_dev_t *dev, uint16_t threshold);
+void apds9930_dev_setProximityIntWindow(apds9930_dev_t *dev, uint16_t low, uint16_t high);
+void apds9930_dev_setProximityIntEnable(apds9930_dev_t *dev, uint8_t enable);
+void apds9930_dev_setAmbientLightIntEnable(apds9930_dev_t *dev, uint8_t enable);
+void apds9930_dev_clearAmbientLightInt(apds9930_dev_t *dev);
+void apds9930_dev_clearProximityInt(apds9930_dev_t *dev);
+void apds9930_dev_clearAllInts(apds9930_dev_t *dev);
+void apds9930_dev_startAcquisition(apds9930_dev_t *dev);
+void apds9930_dev_startTracking(apds9930_dev_t *dev, uint8_t band_pct, uint8_t apers);
+uint32_t apds9930_dev_startPresence(apds9930_dev_t *dev, uint16_t near, uint16_t far, uint8_t ppers);
+void apds9930_dev_stopPresence(apds9930_dev_t *dev);
+uint8_t apds9930_dev_getProximityState(apds9930_dev_t *dev);
+uint8_t apds9930_dev_calibrateProximityOffset(apds9930_dev_t *dev, uint16_t target, uint16_t tolerance,
+                                              apds9930_poffset_save_t save, uint8_t *cycles);
+void apds9930_dev_stopAcquisition(apds9930_dev_t *dev);
+void apds9930_dev_onInterrupt(apds9930_dev_t *dev);
+void apds9930_dev_armWake(apds9930_dev_t *dev, const apds9930_lp_t *lp);
+bool apds9930_dev_waitEvent(apds9930_dev_t *dev, const apds9930_lp_t *lp, apds9930_event_t *ev);
+bool apds9930_dev_popSample(apds9930_dev_t *dev, apds9930_event_t *ev);
+uint32_t apds9930_dev_getDroppedSamples(apds9930_dev_t *dev);
+void apds9930_dev_enablePower(apds9930_dev_t *dev);
+void apds9930_dev_disablePower(apds9930_dev_t *dev);
+uint16_t apds9930_dev_getLightIntLowThreshold(apds9930_dev_t *dev);
+uint16_t apds9930_dev_getLightIntHighThreshold(apds9930_dev_t *dev);
+uint16_t apds9930_dev_getProximityIntLowThreshold(apds9930_dev_t *dev);
+uint16_t apds9930_dev_getProximityIntHighThreshold(apds9930_dev_t *dev);
+
+/* Default-instance API, bound to apds9930_dev_default */
+static inline void apds9930_setBus(const apds9930_bus_t *bus)
+{
+    apds9930_dev_setBus(&apds9930_dev_default, bus);
+}
+
+static inline void apds9930_WriteRegData(uint8_t address, uint8_t dat)
+{
+    apds9930_dev_WriteRegData(&apds9930_dev_default, address, dat);
+}
+
+static inline void apds9930_wireWriteByte(uint8_t val)
+{
+    apds9930_dev_wireWriteByte(&apds9930_dev_default, val);
+}
+
+static inline uint8_t apds9930_readRegData(uint8_t address)
+{
+    return apds9930_dev_readRegData(&apds9930_dev_default, address);
+}
+
+static inline void apds9930_writeRegBlock(uint8_t address, const uint8_t *buf, uint8_t len)
+{
+    apds9930_dev_writeRegBlock(&apds9930_dev_default, address, buf, len);
+}
+
+static inline void apds9930_readRegBlock(uint8_t address, uint8_t *buf, uint8_t len)
+{
+    apds9930_dev_readRegBlock(&apds9930_dev_default, address, buf, len);
+}
+
+static inline void apds9930_beginConfig(void)
+{
+    apds9930_dev_beginConfig(&apds9930_dev_default);
+}
+
+static inline void apds9930_commitConfig(void)
+{
+    apds9930_dev_commitConfig(&apds9930_dev_default);
+}
+
+static inline void apds9930_readSample(apds9930_sample_t *sample)
+{
+    apds9930_dev_readSample(&apds9930_dev_default, sample);
+}
+
+static inline uint8_t apds9930_getRegShadow(uint8_t address)
+{
+    return apds9930_dev_getRegShadow(&apds9930_dev_default, address);
+}
+
+static inline void apds9930_resync(void)
+{
+    apds9930_dev_resync(&apds9930_dev_default);
+}
+
+static inline bool apds9930_verify(void)
+{
+    return apds9930_dev_verify(&apds9930_dev_default);
+}
+
+static inline uint8_t apds9930_init(void)
+{
+    return apds9930_dev_init(&apds9930_dev_default);
+}
+
+static inline uint8_t apds9930_initRegs(const apds9930_regs_t *regs)
+{
+    return apds9930_dev_initRegs(&apds9930_dev_default, regs);
+}
+
+static inline uint32_t apds9930_getCycleTimeUs(void)
+{
+    return apds9930_dev_getCycleTimeUs(&apds9930_dev_default);
+}
+
+static inline uint32_t apds9930_getFirstValidTimeUs(uint8_t valid_mask)
+{
+    return apds9930_dev_getFirstValidTimeUs(&apds9930_dev_default, valid_mask);
+}
+
+static inline uint32_t apds9930_getReadyTick(void)
+{
+    return apds9930_dev_getReadyTick(&apds9930_dev_default);
+}
+
+static inline bool apds9930_waitReady(uint8_t valid_mask, uint32_t timeout_ms)
+{
+    return apds9930_dev_waitReady(&apds9930_dev_default, valid_mask, timeout_ms);
+}
+
+static inline void apds9930_startSchedule(uint8_t valid_mask)
+{
+    apds9930_dev_startSchedule(&apds9930_dev_default, valid_mask);
+}
+
+static inline void apds9930_stopSchedule(void)
+{
+    apds9930_dev_stopSchedule(&apds9930_dev_default);
+}
+
+static inline bool apds9930_pollSample(apds9930_sample_t *sample)
+{
+    return apds9930_dev_pollSample(&apds9930_dev_default, sample);
+}
+
+static inline void apds9930_getScheduleStats(apds9930_sched_stats_t *stats)
+{
+    apds9930_dev_getScheduleStats(&apds9930_dev_default, stats);
+}
+
+static inline bool apds9930_planPowerForRate(apds9930_power_t *plan, uint8_t engines, uint32_t rate_mhz)
+{
+    return apds9930_dev_planPowerForRate(&apds9930_dev_default, plan, engines, rate_mhz);
+}
+
+static inline bool apds9930_planPowerForCurrent(apds9930_power_t *plan, uint8_t engines, uint32_t budget_na)
+{
+    return apds9930_dev_planPowerForCurrent(&apds9930_dev_default, plan, engines, budget_na);
+}
+
+static inline void apds9930_getPowerEstimate(apds9930_power_t *plan)
+{
+    apds9930_dev_getPowerEstimate(&apds9930_dev_default, plan);
+}
+
+static inline void apds9930_applyPowerPlan(const apds9930_power_t *plan)
+{
+    apds9930_dev_applyPowerPlan(&apds9930_dev_default, plan);
+}
+
+static inline uint8_t apds9930_getMode(void)
+{
+    return apds9930_dev_getMode(&apds9930_dev_default);
+}
+
+static inline void apds9930_setMode(uint8_t mode, uint8_t enable)
+{
+    apds9930_dev_setMode(&apds9930_dev_default, mode, enable);
+}
+
+static inline void apds9930_enableLightSensor(bool interrupts)
+{
+    apds9930_dev_enableLightSensor(&apds9930_dev_default, interrupts);
+}
+
+static inline void apds9930_disableLightSensor(void)
+{
+    apds9930_dev_disableLightSensor(&apds9930_dev_default);
+}
+
+static inline uint8_t apds9930_getAmbientLightGain(void)
+{
+    return apds9930_dev_getAmbientLightGain(&apds9930_dev_default);
+}
+
+static inline uint16_t apds9930_readCh0Light(void)
+{
+    return apds9930_dev_readCh0Light(&apds9930_dev_default);
+}
+
+static inline uint16_t apds9930_readCh1Light(void)
+{
+    return apds9930_dev_readCh1Light(&apds9930_dev_default);
+}
+
+static inline uint16_t apds9930_readProximity(void)
+{
+    return apds9930_dev_readProximity(&apds9930_dev_default);
+}
+
+static inline void apds9930_setLightIntLowThreshold(uint16_t threshold)
+{
+    apds9930_dev_setLightIntLowThreshold(&apds9930_dev_default, threshold);
+}
+
+static inline void apds9930_setLightIntHighThreshold(uint16_t threshold)
+{
+    apds9930_dev_setLightIntHighThreshold(&apds9930_dev_default, threshold);
+}
+
+static inline void apds9930_setLightIntWindow(uint16_t low, uint16_t high)
+{
+    apds9930_dev_setLightIntWindow(&apds9930_dev_default, low, high);
+}
+
+static inline void apds9930_trackLight(uint16_t ch0)
+{
+    apds9930_dev_trackLight(&apds9930_dev_default, ch0);
+}
+
+static inline uint32_t apds9930_readAmbientLightMilliLux(void)
+{
+    return apds9930_dev_readAmbientLightMilliLux(&apds9930_dev_default);
+}
+
+static inline float apds9930_readAmbientLightLux(uint8_t light_gain)
+{
+    return apds9930_dev_readAmbientLightLux(&apds9930_dev_default, light_gain);
+}
+
+static inline void apds9930_setRange(uint8_t range)
+{
+    apds9930_dev_setRange(&apds9930_dev_default, range);
+}
+
+static inline uint8_t apds9930_getRange(void)
+{
+    return apds9930_dev_getRange(&apds9930_dev_default);
+}
+
+static inline bool apds9930_autoRange(const apds9930_sample_t *sample, uint32_t *mlux)
+{
+    return apds9930_dev_autoRange(&apds9930_dev_default, sample, mlux);
+}
+
+static inline bool apds9930_readAmbientLightAuto(uint32_t *mlux)
+{
+    return apds9930_dev_readAmbientLightAuto(&apds9930_dev_default, mlux);
+}
+
+static inline void apds9930_setLEDDriver(uint8_t driver)
+{
+    apds9930_dev_setLEDDriver(&apds9930_dev_default, driver);
+}
+
+static inline void apds9930_setProximityGain(uint8_t driver)
+{
+    apds9930_dev_setProximityGain(&apds9930_dev_default, driver);
+}
+
+static inline void apds9930_setAmbientLightGain(uint8_t drive)
+{
+    apds9930_dev_setAmbientLightGain(&apds9930_dev_default, drive);
+}
+
+static inline void apds9930_setProximityDiode(uint8_t drive)
+{
+    apds9930_dev_setProximityDiode(&apds9930_dev_default, drive);
+}
+
+static inline void apds9930_setProximityIntLowThreshold(uint16_t threshold)
+{
+    apds9930_dev_setProximityIntLowThreshold(&apds9930_dev_default, threshold);
+}
+
+static inline void apds9930_setProximityIntHighThreshold(uint16_t threshold)
+{
+    apds9930_dev_setProximityIntHighThreshold(&apds9930_dev_default, threshold);
+}
+
+static inline void apds9930_setProximityIntWindow(uint16_t low, uint16_t high)
+{
+    apds9930_dev_setProximityIntWindow(&apds9930_dev_default, low, high);
+}
+
+static inline void apds9930_setProximityIntEnable(uint8_t enable)
+{
+    apds9930_dev_setProximityIntEnable(&apds9930_dev_default, enable);
+}
+
+static inline void apds9930_setAmbientLightIntEnable(uint8_t enable)
+{
+    apds9930_dev_setAmbientLightIntEnable(&apds9930_dev_default, enable);
+}
+
+static inline void apds9930_clearAmbientLightInt(void)
+{
+    apds9930_dev_clearAmbientLightInt(&apds9930_dev_default);
+}
+
+static inline void apds9930_clearProximityInt(void)
+{
+    apds9930_dev_clearProximityInt(&apds9930_dev_default);
+}
+
+static inline void apds9930_clearAllInts(void)
+{
+    apds9930_dev_clearAllInts(&apds9930_dev_default);
+}
+
+static inline void apds9930_startAcquisition(void)
+{
+    apds9930_dev_startAcquisition(&apds9930_dev_default);
+}
+
+static inline void apds9930_startTracking(uint8_t band_pct, uint8_t apers)
+{
+    apds9930_dev_startTracking(&apds9930_dev_default, band_pct, apers);
+}
+
+static inline uint32_t apds9930_startPresence(uint16_t near, uint16_t far, uint8_t ppers)
+{
+    return apds9930_dev_startPresence(&apds9930_dev_default, near, far, ppers);
+}
+
+static inline void apds9930_stopPresence(void)
+{
+    apds9930_dev_stopPresence(&apds9930_dev_default);
+}
+
+static inline uint8_t apds9930_getProximityState(void)
+{
+    return apds9930_dev_getProximityState(&apds9930_dev_default);
+}
+
+static inline uint8_t apds9930_calibrateProximityOffset(uint16_t target, uint16_t tolerance,
+                                                        apds9930_poffset_save_t save, uint8_t *cycles)
+{
+    return apds9930_dev_calibrateProximityOffset(&apds9930_dev_default, target, tolerance, save, cycles);
+}
+
+static inline void apds9930_stopAcquisition(void)
+{
+    apds9930_dev_stopAcquisition(&apds9930_dev_default);
+}
+
+static inline void apds9930_onInterrupt(void)
+{
+    apds9930_dev_onInterrupt(&apds9930_dev_default);
+}
+
+static inline void apds9930_armWake(const apds9930_lp_t *lp)
+{
+    apds9930_dev_armWake(&apds9930_dev_default, lp);
+}
+
+static inline bool apds9930_waitEvent(const apds9930_lp_t *lp, apds9930_event_t *ev)
+{
+    return apds9930_dev_waitEvent(&apds9930_dev_default, lp, ev);
+}
+
+static inline bool apds9930_popSample(apds9930_event_t *ev)
+{
+    return apds9930_dev_popSample(&apds9930_dev_default, ev);
+}
+
+static inline uint32_t apds9930_getDroppedSamples(void)
+{
+    return apds9930_dev_getDroppedSamples(&apds9930_dev_default);
+}
+
+static inline void apds9930_enablePower(void)
+{
+    apds9930_dev_enablePower(&apds9930_dev_default);
+}
+
+static inline void apds9930_disablePower(void)
+{
+    apds9930_dev_disablePower(&apds9930_dev_default);
+}
+
+static inline uint16_t apds9930_getLightIntLowThreshold(void)
+{
+    return apds9930_dev_getLightIntLowThreshold(&apds9930_dev_default);
+}
+
+static inline uint16_t apds9930_getLightIntHighThreshold(void)
+{
+    return apds9930_dev_getLightIntHighThreshold(&apds9930_dev_default);
+}
+
+static inline uint16_t apds9930_getProximityIntLowThreshold(void)
+{
+    return apds9930_dev_getProximityIntLowThreshold(&apds9930_dev_default);
+}
+
+static inline uint16_t apds9930_getProximityIntHighThreshold(void)
+{
+    return apds9930_dev_getProximityIntHighThreshold(&apds9930_dev_default);
+}
+#endif
+
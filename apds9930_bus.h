@@ -0,0 +1,49 @@
+#ifndef __APDS9930_BUS_H
+#define __APDS9930_BUS_H
+
+#include <stdint.h>
+
+/*
+ * Transport used by the sensor driver. Every operation is one complete
+ * bus transaction and returns 0 on success, 1 if the device did not ACK.
+ * cmd is the APDS-9930 command byte (REPEATED_BYTE/AUTO_INCREMENT/SPECIAL_FN).
+ */
+typedef struct {
+    void (*init)(void *ctx);
+    uint8_t (*read)(void *ctx, uint8_t addr, uint8_t cmd, uint8_t *buf, uint8_t len);
+    uint8_t (*write)(void *ctx, uint8_t addr, uint8_t cmd, const uint8_t *buf, uint8_t len);
+    uint8_t (*command)(void *ctx, uint8_t addr, uint8_t cmd);
+    void *ctx;
+} apds9930_bus_t;
+
+/* Bit-banged I2C from iic.c */
+extern const apds9930_bus_t apds9930_bus_iic;
+
+#ifdef HAL_I2C_MODULE_ENABLED
+/* STM32 HAL I2C peripheral, see apds9930_bus_hal_attach() */
+extern const apds9930_bus_t apds9930_bus_hal;
+
+/* Transfers of at least this many bytes use DMA, shorter ones use IT */
+#ifndef APDS9930_BUS_HAL_DMA_MIN
+#define APDS9930_BUS_HAL_DMA_MIN    4
+#endif
+
+void apds9930_bus_hal_attach(I2C_HandleTypeDef *hi2c);
+#endif
+
+#ifdef APDS9930_BUS_WAVE
+/* Bit-banged I2C compiled by iic_wave.c and played by timer-paced DMA,
+   see apds9930_bus_wave_attach() */
+extern const apds9930_bus_t apds9930_bus_wave;
+
+/* Longest transfer played as a waveform, longer ones are bit-banged */
+#ifndef APDS9930_BUS_WAVE_MAX_LEN
+#define APDS9930_BUS_WAVE_MAX_LEN   8
+#endif
+
+#ifndef APDS9930_HOST_SIM
+void apds9930_bus_wave_attach(TIM_HandleTypeDef *htim, DMA_HandleTypeDef *hdma_out, DMA_HandleTypeDef *hdma_in);
+#endif
+#endif
+
+#endif
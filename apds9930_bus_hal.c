@@ -0,0 +1,114 @@
+#include "apds9930_bus.h"
+
+#ifdef HAL_I2C_MODULE_ENABLED
+
+/* Peripheral handle configured by CubeMX, e.g. &hi2c1 */
+static I2C_HandleTypeDef *apds9930_hi2c;
+
+/**
+ * @brief       select the I2C peripheral used by apds9930_bus_hal
+ * @param       hi2c   initialised HAL handle, its IRQs (and DMA IRQs) enabled
+ * @return      NONE
+*/
+void apds9930_bus_hal_attach(I2C_HandleTypeDef *hi2c)
+{
+    apds9930_hi2c = hi2c;
+}
+
+/**
+ * @brief       sleep until the running IT/DMA transfer has finished
+ * @param       status   result of the HAL start call
+ * @return      0 on success, 1 on NACK or any other bus error
+*/
+static uint8_t apds9930_bus_hal_wait(HAL_StatusTypeDef status)
+{
+    if(status != HAL_OK)
+        return 1;
+
+    /* The CPU is free while the peripheral moves the bytes. A completion
+       that lands just before WFI is picked up on the next SysTick. */
+    while(HAL_I2C_GetState(apds9930_hi2c) != HAL_I2C_STATE_READY)
+    {
+        __WFI();
+    }
+
+    return HAL_I2C_GetError(apds9930_hi2c) != HAL_I2C_ERROR_NONE;
+}
+
+/**
+ * @brief       peripheral needs no extra bring-up, CubeMX already did it
+ * @param       ctx   unused
+ * @return      NONE
+*/
+static void apds9930_bus_hal_init(void *ctx)
+{
+    (void)ctx;
+}
+
+/**
+ * @brief       command byte as the memory address, then a repeated-START read
+ * @param       ctx   unused
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @param       buf   receive buffer
+ * @param       len   number of bytes to read
+ * @return      0 on success
+*/
+static uint8_t apds9930_bus_hal_read(void *ctx, uint8_t addr, uint8_t cmd, uint8_t *buf, uint8_t len)
+{
+    (void)ctx;
+
+    if(len >= APDS9930_BUS_HAL_DMA_MIN)
+        return apds9930_bus_hal_wait(HAL_I2C_Mem_Read_DMA(apds9930_hi2c, addr << 1, cmd,
+                                                          I2C_MEMADD_SIZE_8BIT, buf, len));
+
+    return apds9930_bus_hal_wait(HAL_I2C_Mem_Read_IT(apds9930_hi2c, addr << 1, cmd,
+                                                     I2C_MEMADD_SIZE_8BIT, buf, len));
+}
+
+/**
+ * @brief       command byte as the memory address, followed by the data
+ * @param       ctx   unused
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @param       buf   data to write
+ * @param       len   number of bytes to write
+ * @return      0 on success
+*/
+static uint8_t apds9930_bus_hal_write(void *ctx, uint8_t addr, uint8_t cmd, const uint8_t *buf, uint8_t len)
+{
+    (void)ctx;
+
+    if(len >= APDS9930_BUS_HAL_DMA_MIN)
+        return apds9930_bus_hal_wait(HAL_I2C_Mem_Write_DMA(apds9930_hi2c, addr << 1, cmd,
+                                                           I2C_MEMADD_SIZE_8BIT, (uint8_t *)buf, len));
+
+    return apds9930_bus_hal_wait(HAL_I2C_Mem_Write_IT(apds9930_hi2c, addr << 1, cmd,
+                                                      I2C_MEMADD_SIZE_8BIT, (uint8_t *)buf, len));
+}
+
+/**
+ * @brief       write a bare command byte
+ * @param       ctx   unused
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @return      0 on success
+*/
+static uint8_t apds9930_bus_hal_command(void *ctx, uint8_t addr, uint8_t cmd)
+{
+    uint8_t tx = cmd;
+
+    (void)ctx;
+
+    return apds9930_bus_hal_wait(HAL_I2C_Master_Transmit_IT(apds9930_hi2c, addr << 1, &tx, 1));
+}
+
+const apds9930_bus_t apds9930_bus_hal = {
+    apds9930_bus_hal_init,
+    apds9930_bus_hal_read,
+    apds9930_bus_hal_write,
+    apds9930_bus_hal_command,
+    0
+};
+
+#endif
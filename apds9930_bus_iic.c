@@ -0,0 +1,189 @@
+#include "apds9930_bus.h"
+#include "iic.h"
+
+/* With IIC_MULTI_BUS ctx is the iic_bus_t of the sensor (NULL = iic_bus_default),
+   otherwise there is only the one bus and ctx is unused */
+#ifdef IIC_MULTI_BUS
+#define APDS9930_BUS_IIC_SELECT(ctx)    i2c_SelectBus((const iic_bus_t *)(ctx))
+#else
+#define APDS9930_BUS_IIC_SELECT(ctx)    ((void)(ctx))
+#endif
+
+/**
+ * @brief       bring up the bit-banged bus
+ * @param       ctx   bus pins, see APDS9930_BUS_IIC_SELECT
+ * @return      NONE
+*/
+static void apds9930_bus_iic_init(void *ctx)
+{
+    APDS9930_BUS_IIC_SELECT(ctx);
+
+    /*init i2c gpio*/
+    iic_gpio_init();
+
+    /*i2c stop*/
+    i2c_Stop();
+}
+
+/**
+ * @brief       write the command byte, then read len bytes after a repeated START
+ * @param       ctx   bus pins, see APDS9930_BUS_IIC_SELECT
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @param       buf   receive buffer
+ * @param       len   number of bytes to read
+ * @return      0 if every address/command byte was ACKed
+*/
+static uint8_t apds9930_bus_iic_read(void *ctx, uint8_t addr, uint8_t cmd, uint8_t *buf, uint8_t len)
+{
+    uint8_t nack;
+    uint8_t i;
+
+    APDS9930_BUS_IIC_SELECT(ctx);
+
+    i2c_Start();
+    i2c_SendByte((addr << 1) & (0xFE));
+    nack = i2c_WaitAck();
+
+    i2c_SendByte(cmd);
+    nack |= i2c_WaitAck();
+
+    i2c_Start();
+    i2c_SendByte((addr << 1) | (0x01));
+    nack |= i2c_WaitAck();
+
+    /* ACK every byte but the last so the device keeps auto-incrementing */
+    for(i = 0; i < len; i++)
+    {
+        buf[i] = i2c_ReadByte(i != (len - 1));
+    }
+
+    i2c_Stop();
+
+    return nack;
+}
+
+/**
+ * @brief       write the command byte followed by len data bytes
+ * @param       ctx   bus pins, see APDS9930_BUS_IIC_SELECT
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @param       buf   data to write
+ * @param       len   number of bytes to write
+ * @return      0 if every byte was ACKed
+*/
+static uint8_t apds9930_bus_iic_write(void *ctx, uint8_t addr, uint8_t cmd, const uint8_t *buf, uint8_t len)
+{
+    uint8_t nack;
+    uint8_t i;
+
+    APDS9930_BUS_IIC_SELECT(ctx);
+
+    i2c_Start();
+
+    i2c_SendByte((addr << 1) & (0xFE));
+    nack = i2c_WaitAck();
+
+    i2c_SendByte(cmd);
+    nack |= i2c_WaitAck();
+
+    for(i = 0; i < len; i++)
+    {
+        i2c_SendByte(buf[i]);
+        nack |= i2c_WaitAck();
+    }
+
+    i2c_Stop();
+
+    return nack;
+}
+
+/**
+ * @brief       write a bare command byte, e.g. a special function
+ * @param       ctx   bus pins, see APDS9930_BUS_IIC_SELECT
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @return      0 if both bytes were ACKed
+*/
+static uint8_t apds9930_bus_iic_command(void *ctx, uint8_t addr, uint8_t cmd)
+{
+    return apds9930_bus_iic_write(ctx, addr, cmd, 0, 0);
+}
+
+const apds9930_bus_t apds9930_bus_iic = {
+    apds9930_bus_iic_init,
+    apds9930_bus_iic_read,
+    apds9930_bus_iic_write,
+    apds9930_bus_iic_command,
+    0
+};
+
+#ifdef IIC_PARALLEL
+/**
+ * @brief       read the same registers from every sensor of a parallel bus at once
+ * @param       par   parallel bus, one device per SDA line, all at addr
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @param       buf   receive buffer, lane i gets buf[i * len .. i * len + len - 1]
+ * @param       len   number of bytes to read per lane
+ * @return      mask of lanes that did not ACK, bit i = lane i
+*/
+uint16_t apds9930_bus_iic_readParallel(const iic_par_t *par, uint8_t addr, uint8_t cmd, uint8_t *buf, uint8_t len)
+{
+    uint16_t nack;
+    uint8_t i;
+
+    i2c_ParStart(par);
+    i2c_ParSendByte(par, (addr << 1) & (0xFE));
+    nack = i2c_ParWaitAck(par);
+
+    i2c_ParSendByte(par, cmd);
+    nack |= i2c_ParWaitAck(par);
+
+    i2c_ParStart(par);
+    i2c_ParSendByte(par, (addr << 1) | (0x01));
+    nack |= i2c_ParWaitAck(par);
+
+    for(i = 0; i < len; i++)
+    {
+        i2c_ParReadByte(par, &buf[i], len, i != (len - 1));
+    }
+
+    i2c_ParStop(par);
+
+    return nack;
+}
+
+/**
+ * @brief       write the same data to every sensor of a parallel bus at once
+ * @param       par   parallel bus, one device per SDA line, all at addr
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @param       buf   data to write
+ * @param       len   number of bytes to write
+ * @return      mask of lanes that did not ACK, bit i = lane i
+*/
+uint16_t apds9930_bus_iic_writeParallel(const iic_par_t *par, uint8_t addr, uint8_t cmd, const uint8_t *buf, uint8_t len)
+{
+    uint16_t nack;
+    uint8_t i;
+
+    i2c_ParStart(par);
+
+    i2c_ParSendByte(par, (addr << 1) & (0xFE));
+    nack = i2c_ParWaitAck(par);
+
+    i2c_ParSendByte(par, cmd);
+    nack |= i2c_ParWaitAck(par);
+
+    for(i = 0; i < len; i++)
+    {
+        i2c_ParSendByte(par, buf[i]);
+        nack |= i2c_ParWaitAck(par);
+    }
+
+    i2c_ParStop(par);
+
+    return nack;
+}
+#endif
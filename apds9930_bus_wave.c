@@ -0,0 +1,175 @@
+#include "apds9930_bus.h"
+#include "iic.h"
+#include "iic_wave.h"
+
+#ifdef APDS9930_BUS_WAVE
+
+/* One buffer pair sized for the longest transfer played as a waveform */
+#define APDS9930_BUS_WAVE_SLOTS     IIC_WAVE_READ_SLOTS(APDS9930_BUS_WAVE_MAX_LEN)
+
+static uint32_t apds9930_bus_wave_out[APDS9930_BUS_WAVE_SLOTS];
+static uint16_t apds9930_bus_wave_in[APDS9930_BUS_WAVE_SLOTS];
+
+#ifdef APDS9930_HOST_SIM
+
+/**
+ * @brief       play the waveform to the simulated port, sampling IDR mid-slot
+ * @param       n   number of slots
+ * @return      NONE
+*/
+static void apds9930_bus_wave_play(uint16_t n)
+{
+    uint64_t half_ns = 1000000000ULL / (6ULL * i2c_GetSpeed());
+    uint16_t k;
+
+    for(k = 0; k < n; k++)
+    {
+        iic_sim_bsrr(IIC_SCL_GPIO_Port, apds9930_bus_wave_out[k]);
+        apds9930_sim_advanceNs(half_ns);
+        apds9930_bus_wave_in[k] = iic_sim_idr(IIC_SCL_GPIO_Port);
+        apds9930_sim_advanceNs(half_ns);
+    }
+}
+
+#else
+
+/* Timer paced at three times the SCL frequency and its two DMA channels */
+static TIM_HandleTypeDef *apds9930_wave_htim;
+static DMA_HandleTypeDef *apds9930_wave_hdma_out;
+static DMA_HandleTypeDef *apds9930_wave_hdma_in;
+static volatile uint8_t apds9930_wave_done;
+
+/**
+ * @brief       select the timer and DMA channels used by apds9930_bus_wave
+ * @param       htim   timer, update rate 3x SCL, CC1 at half its period
+ * @param       hdma_out   channel on the timer's update request, memory to peripheral, word
+ * @param       hdma_in   channel on the timer's CC1 request, peripheral to memory, half-word, IRQ enabled
+ * @return      NONE
+*/
+void apds9930_bus_wave_attach(TIM_HandleTypeDef *htim, DMA_HandleTypeDef *hdma_out, DMA_HandleTypeDef *hdma_in)
+{
+    apds9930_wave_htim = htim;
+    apds9930_wave_hdma_out = hdma_out;
+    apds9930_wave_hdma_in = hdma_in;
+}
+
+/**
+ * @brief       capture stream complete, the last slot has been sampled
+ * @param       hdma   capture channel
+ * @return      NONE
+*/
+static void apds9930_bus_wave_complete(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+
+    apds9930_wave_done = 1;
+}
+
+/**
+ * @brief       play the waveform to the SCL/SDA port and sleep until it is captured
+ * @param       n   number of slots
+ * @return      NONE
+*/
+static void apds9930_bus_wave_play(uint16_t n)
+{
+    TIM_TypeDef *tim = apds9930_wave_htim->Instance;
+
+    apds9930_wave_done = 0;
+    apds9930_wave_hdma_in->XferCpltCallback = apds9930_bus_wave_complete;
+
+    HAL_DMA_Start(apds9930_wave_hdma_out, (uint32_t)apds9930_bus_wave_out,
+                  (uint32_t)&IIC_SCL_GPIO_Port->BSRR, n);
+    HAL_DMA_Start_IT(apds9930_wave_hdma_in, (uint32_t)&IIC_SCL_GPIO_Port->IDR,
+                     (uint32_t)apds9930_bus_wave_in, n);
+
+    /* UG puts slot 0 on the pins right away, CC1 samples it half a slot later */
+    tim->CNT = 0;
+    tim->DIER |= TIM_DMA_UPDATE | TIM_DMA_CC1;
+    tim->EGR = TIM_EGR_UG;
+    tim->CR1 |= TIM_CR1_CEN;
+
+    /* A completion that lands just before WFI is picked up on the next SysTick */
+    while(!apds9930_wave_done)
+    {
+        __WFI();
+    }
+
+    tim->CR1 &= ~TIM_CR1_CEN;
+    tim->DIER &= ~(TIM_DMA_UPDATE | TIM_DMA_CC1);
+    HAL_DMA_PollForTransfer(apds9930_wave_hdma_out, HAL_DMA_FULL_TRANSFER, 1);
+}
+
+#endif
+
+/**
+ * @brief       bring up the pins in open-drain mode, as the bit-banged bus does
+ * @param       ctx   unused
+ * @return      NONE
+*/
+static void apds9930_bus_wave_init(void *ctx)
+{
+    apds9930_bus_iic.init(ctx);
+}
+
+/**
+ * @brief       command byte, repeated START, then len bytes, played from a buffer
+ * @param       ctx   unused
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @param       buf   receive buffer
+ * @param       len   number of bytes to read
+ * @return      0 if every address/command byte was ACKed
+*/
+static uint8_t apds9930_bus_wave_read(void *ctx, uint8_t addr, uint8_t cmd, uint8_t *buf, uint8_t len)
+{
+    /* Longer transfers, such as a full shadow refresh, are rare: bit-bang them */
+    if(len > APDS9930_BUS_WAVE_MAX_LEN)
+        return apds9930_bus_iic.read(ctx, addr, cmd, buf, len);
+
+    apds9930_bus_wave_play(iic_wave_compileRead(apds9930_bus_wave_out, IIC_SCL_Pin, IIC_SDA_Pin,
+                                                addr, cmd, len));
+
+    return iic_wave_decodeRead(apds9930_bus_wave_in, IIC_SDA_Pin, buf, len);
+}
+
+/**
+ * @brief       command byte followed by len data bytes, played from a buffer
+ * @param       ctx   unused
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @param       buf   data to write
+ * @param       len   number of bytes to write
+ * @return      0 if every byte was ACKed
+*/
+static uint8_t apds9930_bus_wave_write(void *ctx, uint8_t addr, uint8_t cmd, const uint8_t *buf, uint8_t len)
+{
+    if(len > APDS9930_BUS_WAVE_MAX_LEN)
+        return apds9930_bus_iic.write(ctx, addr, cmd, buf, len);
+
+    apds9930_bus_wave_play(iic_wave_compileWrite(apds9930_bus_wave_out, IIC_SCL_Pin, IIC_SDA_Pin,
+                                                 addr, cmd, buf, len));
+
+    return iic_wave_decodeWrite(apds9930_bus_wave_in, IIC_SDA_Pin, len);
+}
+
+/**
+ * @brief       write a bare command byte, e.g. a special function
+ * @param       ctx   unused
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @return      0 if both bytes were ACKed
+*/
+static uint8_t apds9930_bus_wave_command(void *ctx, uint8_t addr, uint8_t cmd)
+{
+    return apds9930_bus_wave_write(ctx, addr, cmd, 0, 0);
+}
+
+const apds9930_bus_t apds9930_bus_wave = {
+    apds9930_bus_wave_init,
+    apds9930_bus_wave_read,
+    apds9930_bus_wave_write,
+    apds9930_bus_wave_command,
+    0
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "apds9930.h"
+#include "iic.h"
+
+#ifndef APDS9930_HOST_SIM
+
+/* Brings the system clock back after STOP, NULL if it runs from HSI16 */
+static void (*apds9930_lp_resume)(void);
+
+/**
+ * @brief       set how the system clock is restored after STOP
+ *              The core wakes up on HSI16. An application running from
+ *              the PLL or MSI passes its clock setup, e.g. SystemClock_Config.
+ * @param       resume   called right after wake-up, NULL if HSI16 is the system clock
+ * @return      NONE
+*/
+void apds9930_lp_stm32l0_attach(void (*resume)(void))
+{
+    apds9930_lp_resume = resume;
+}
+
+/**
+ * @brief       INT as a falling-edge EXTI line, masked until apds9930_lp_stm32l0_stop() opens it
+ * @param       ctx   unused
+ * @param       dev   device whose INT wakes the core
+ * @return      NONE
+*/
+static void apds9930_lp_stm32l0_arm(void *ctx, apds9930_dev_t *dev)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    (void)ctx;
+
+    if(dev->int_port == GPIOA)
+        __HAL_RCC_GPIOA_CLK_ENABLE();
+    else if(dev->int_port == GPIOB)
+        __HAL_RCC_GPIOB_CLK_ENABLE();
+    else if(dev->int_port == GPIOC)
+        __HAL_RCC_GPIOC_CLK_ENABLE();
+
+    GPIO_InitStruct.Pin = dev->int_pin;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
+    GPIO_InitStruct.Pull = GPIO_PULLUP;
+    HAL_GPIO_Init(dev->int_port, &GPIO_InitStruct);
+
+    /* Only ever pended with PRIMASK set, the handler never runs for this line */
+    EXTI->IMR &= ~(uint32_t)dev->int_pin;
+    HAL_NVIC_SetPriority(dev->int_irq, APDS9930_INT_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(dev->int_irq);
+
+    /* Wake straight onto HSI16 without waiting for VREFINT to settle */
+    __HAL_RCC_WAKEUPSTOP_CLK_CONFIG(RCC_STOP_WAKEUPCLOCK_HSI);
+    HAL_PWREx_EnableUltraLowPower();
+    HAL_PWREx_EnableFastWakeUp();
+}
+
+/**
+ * @brief       STOP with the low-power regulator until INT falls or another line wakes the core
+ *              SCL/SDA keep their open-drain configuration through STOP;
+ *              the bit-banged delays are retimed if the wake-up left the
+ *              core on another clock.
+ * @param       ctx   unused
+ * @param       dev   device whose INT wakes the core
+ * @return      true if INT is low
+*/
+static bool apds9930_lp_stm32l0_stop(void *ctx, apds9930_dev_t *dev)
+{
+    uint32_t clock = SystemCoreClock;
+    bool asserted;
+
+    (void)ctx;
+
+    /* An edge from here on pends the IRQ, which ends WFI even with PRIMASK set */
+    __disable_irq();
+    EXTI->PR = dev->int_pin;
+    EXTI->IMR |= dev->int_pin;
+
+    /* INT is held low until cleared, so a level check covers an earlier edge */
+    if(HAL_GPIO_ReadPin(dev->int_port, dev->int_pin) == GPIO_PIN_SET)
+    {
+        HAL_SuspendTick();
+        HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+        if(apds9930_lp_resume)
+            apds9930_lp_resume();
+        HAL_ResumeTick();
+    }
+
+    asserted = HAL_GPIO_ReadPin(dev->int_port, dev->int_pin) == GPIO_PIN_RESET;
+
+    EXTI->IMR &= ~(uint32_t)dev->int_pin;
+    EXTI->PR = dev->int_pin;
+    NVIC_ClearPendingIRQ(dev->int_irq);
+    __enable_irq();
+
+    SystemCoreClockUpdate();
+    if(SystemCoreClock != clock)
+        i2c_SetSpeed(i2c_GetSpeed());
+
+    return asserted;
+}
+
+const apds9930_lp_t apds9930_lp_stm32l0 = {
+    apds9930_lp_stm32l0_arm,
+    apds9930_lp_stm32l0_stop,
+    0
+};
+
+#endif
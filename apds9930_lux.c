@@ -0,0 +1,202 @@
+#include "apds9930.h"
+
+/*
+ * Batch lux conversion for logged Ch0/Ch1 counts. The vector kernels are
+ * picked at compile time (-mavx2, -msse4.1, or an ARM target with NEON)
+ * and produce exactly the values of apds9930_scaleMilliLux(): the same
+ * Q14 IAC in 32-bit lanes and the same rounded Q30 product in 64-bit lanes.
+ */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * @brief       LPC of each AGAIN setting at one ATIME
+ * @param       lpc   four Q16 factors
+ * @param       atime   ATIME register value
+ * @return      NONE
+*/
+static void apds9930_luxLpcTable(uint32_t lpc[4], uint8_t atime)
+{
+    uint8_t g;
+
+    for(g = 0; g < 4; g++)
+    {
+        lpc[g] = apds9930_getLpcQ16(g, atime);
+    }
+}
+
+#if defined(__AVX2__)
+/**
+ * @brief       8 samples per iteration
+ * @return      number of samples converted
+*/
+static uint32_t apds9930_luxKernel(const uint16_t *ch0, const uint16_t *ch1, const uint8_t *again,
+                                   const uint32_t lpc[4], uint32_t *mlux, uint32_t n)
+{
+    const __m256i b = _mm256_set1_epi32(ALS_B_Q14);
+    const __m256i c = _mm256_set1_epi32(ALS_C_Q14);
+    const __m256i d = _mm256_set1_epi32(ALS_D_Q14);
+    const __m256i lpc_tab = _mm256_setr_epi32((int)lpc[0], (int)lpc[1], (int)lpc[2], (int)lpc[3],
+                                              (int)lpc[0], (int)lpc[1], (int)lpc[2], (int)lpc[3]);
+    const __m256i gain_mask = _mm256_set1_epi32(0x03);
+    const __m256i round = _mm256_set1_epi64x(1LL << 29);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i v0, v1, l, iac, alt, even, odd;
+    uint32_t i;
+
+    for(i = 0; i + 8 <= n; i += 8)
+    {
+        v0 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(ch0 + i)));
+        v1 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(ch1 + i)));
+        l = _mm256_and_si256(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(again + i))), gain_mask);
+        l = _mm256_permutevar8x32_epi32(lpc_tab, l);
+
+        iac = _mm256_sub_epi32(_mm256_slli_epi32(v0, 14), _mm256_mullo_epi32(v1, b));
+        alt = _mm256_sub_epi32(_mm256_mullo_epi32(v0, c), _mm256_mullo_epi32(v1, d));
+        iac = _mm256_max_epi32(_mm256_max_epi32(iac, alt), zero);
+
+        /* Q14 * Q16 -> Q30 on even and odd lanes, results fit in 32 bits */
+        even = _mm256_srli_epi64(_mm256_add_epi64(_mm256_mul_epu32(iac, l), round), 30);
+        odd = _mm256_srli_epi64(_mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(iac, 32),
+                                                                  _mm256_srli_epi64(l, 32)), round), 30);
+        _mm256_storeu_si256((__m256i *)(mlux + i),
+                            _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA));
+    }
+
+    return i;
+}
+#elif defined(__SSE4_1__)
+/**
+ * @brief       4 samples per iteration
+ * @return      number of samples converted
+*/
+static uint32_t apds9930_luxKernel(const uint16_t *ch0, const uint16_t *ch1, const uint8_t *again,
+                                   const uint32_t lpc[4], uint32_t *mlux, uint32_t n)
+{
+    const __m128i b = _mm_set1_epi32(ALS_B_Q14);
+    const __m128i c = _mm_set1_epi32(ALS_C_Q14);
+    const __m128i d = _mm_set1_epi32(ALS_D_Q14);
+    const __m128i round = _mm_set1_epi64x(1LL << 29);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v0, v1, l, iac, alt, even, odd;
+    uint32_t i;
+
+    for(i = 0; i + 4 <= n; i += 4)
+    {
+        v0 = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)(ch0 + i)));
+        v1 = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)(ch1 + i)));
+        l = _mm_setr_epi32((int)lpc[again[i] & 0x03], (int)lpc[again[i + 1] & 0x03],
+                           (int)lpc[again[i + 2] & 0x03], (int)lpc[again[i + 3] & 0x03]);
+
+        iac = _mm_sub_epi32(_mm_slli_epi32(v0, 14), _mm_mullo_epi32(v1, b));
+        alt = _mm_sub_epi32(_mm_mullo_epi32(v0, c), _mm_mullo_epi32(v1, d));
+        iac = _mm_max_epi32(_mm_max_epi32(iac, alt), zero);
+
+        /* Q14 * Q16 -> Q30 on even and odd lanes, results fit in 32 bits */
+        even = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(iac, l), round), 30);
+        odd = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(iac, 32),
+                                                         _mm_srli_epi64(l, 32)), round), 30);
+        _mm_storeu_si128((__m128i *)(mlux + i), _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xCC));
+    }
+
+    return i;
+}
+#elif defined(__ARM_NEON)
+/**
+ * @brief       4 samples per iteration
+ * @return      number of samples converted
+*/
+static uint32_t apds9930_luxKernel(const uint16_t *ch0, const uint16_t *ch1, const uint8_t *again,
+                                   const uint32_t lpc[4], uint32_t *mlux, uint32_t n)
+{
+    const int32x4_t b = vdupq_n_s32(ALS_B_Q14);
+    const int32x4_t c = vdupq_n_s32(ALS_C_Q14);
+    const int32x4_t d = vdupq_n_s32(ALS_D_Q14);
+    const int32x4_t zero = vdupq_n_s32(0);
+    int32x4_t v0, v1, iac, alt;
+    uint32x4_t l, u;
+    uint64x2_t lo, hi;
+    uint32_t lane[4];
+    uint32_t i;
+
+    for(i = 0; i + 4 <= n; i += 4)
+    {
+        v0 = vreinterpretq_s32_u32(vmovl_u16(vld1_u16(ch0 + i)));
+        v1 = vreinterpretq_s32_u32(vmovl_u16(vld1_u16(ch1 + i)));
+        lane[0] = lpc[again[i] & 0x03];
+        lane[1] = lpc[again[i + 1] & 0x03];
+        lane[2] = lpc[again[i + 2] & 0x03];
+        lane[3] = lpc[again[i + 3] & 0x03];
+        l = vld1q_u32(lane);
+
+        iac = vsubq_s32(vshlq_n_s32(v0, 14), vmulq_s32(v1, b));
+        alt = vsubq_s32(vmulq_s32(v0, c), vmulq_s32(v1, d));
+        u = vreinterpretq_u32_s32(vmaxq_s32(vmaxq_s32(iac, alt), zero));
+
+        /* Q14 * Q16 -> Q30, the rounding shift adds 1 << 29 first */
+        lo = vrshrq_n_u64(vmull_u32(vget_low_u32(u), vget_low_u32(l)), 30);
+        hi = vrshrq_n_u64(vmull_u32(vget_high_u32(u), vget_high_u32(l)), 30);
+        vst1q_u32(mlux + i, vcombine_u32(vmovn_u64(lo), vmovn_u64(hi)));
+    }
+
+    return i;
+}
+#endif
+
+/**
+ * @brief       convert logged counts to mlux, one sample at a time
+ * @param       ch0   Ch0 counts
+ * @param       ch1   Ch1 counts
+ * @param       again   AGAIN setting of each sample
+ * @param       atime   ATIME register value shared by the batch
+ * @param       mlux   output, illuminance in mlux
+ * @param       n   number of samples
+ * @return      NONE
+*/
+void apds9930_calcMilliLuxBatchScalar(const uint16_t *ch0, const uint16_t *ch1, const uint8_t *again,
+                                      uint8_t atime, uint32_t *mlux, uint32_t n)
+{
+    uint32_t lpc[4];
+    uint32_t i;
+
+    apds9930_luxLpcTable(lpc, atime);
+
+    for(i = 0; i < n; i++)
+    {
+        mlux[i] = apds9930_scaleMilliLux(ch0[i], ch1[i], lpc[again[i] & 0x03]);
+    }
+}
+
+/**
+ * @brief       convert logged counts to mlux with the widest compiled kernel
+ *              results are identical to apds9930_calcMilliLuxBatchScalar()
+ * @param       ch0   Ch0 counts
+ * @param       ch1   Ch1 counts
+ * @param       again   AGAIN setting of each sample
+ * @param       atime   ATIME register value shared by the batch
+ * @param       mlux   output, illuminance in mlux
+ * @param       n   number of samples
+ * @return      NONE
+*/
+void apds9930_calcMilliLuxBatch(const uint16_t *ch0, const uint16_t *ch1, const uint8_t *again,
+                                uint8_t atime, uint32_t *mlux, uint32_t n)
+{
+    uint32_t lpc[4];
+    uint32_t i = 0;
+
+    apds9930_luxLpcTable(lpc, atime);
+
+#if defined(__AVX2__) || defined(__SSE4_1__) || defined(__ARM_NEON)
+    i = apds9930_luxKernel(ch0, ch1, again, lpc, mlux, n);
+#endif
+
+    for(; i < n; i++)
+    {
+        mlux[i] = apds9930_scaleMilliLux(ch0[i], ch1[i], lpc[again[i] & 0x03]);
+    }
+}
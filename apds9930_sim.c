@@ -0,0 +1,717 @@
+#include "apds9930.h"
+#include "apds9930_sim.h"
+
+/* Simulated time in ns */
+static uint64_t apds9930_sim_ns;
+
+/* Models with an INT handler attached, serviced by HAL_Delay() */
+static apds9930_sim_t *apds9930_sim_intModels[APDS9930_SIM_MAX_INT];
+static uint8_t apds9930_sim_intCount;
+
+apds9930_sim_t apds9930_sim_default = {
+    .regs = {
+        [APDS9930_ATIME] = 0xFF,
+        [APDS9930_PTIME] = 0xFF,
+        [APDS9930_WTIME] = 0xFF,
+        [APDS9930_ID] = APDS9930_ID_2,
+    },
+    .address = APDS9930_I2C_ADDR,
+    .int_line = 1,
+};
+
+/**
+ * @brief       current simulated time
+ * @param       NONE
+ * @return      time in ns
+*/
+uint64_t apds9930_sim_now(void)
+{
+    return apds9930_sim_ns;
+}
+
+/**
+ * @brief       move the simulated clock forward
+ * @param       ns   elapsed time
+ * @return      NONE
+*/
+void apds9930_sim_advanceNs(uint64_t ns)
+{
+    apds9930_sim_ns += ns;
+}
+
+/**
+ * @brief       duration of one state machine phase for the current registers
+ * @param       sim   model
+ * @param       phase   APDS9930_SIM_PROX/WAIT/ALS
+ * @return      duration in ns
+*/
+static uint64_t apds9930_sim_phaseNs(apds9930_sim_t *sim, uint8_t phase)
+{
+    uint64_t us = 0;
+
+    if(phase == APDS9930_SIM_PROX)
+    {
+        /* Prox Init + Prox Accum + Prox Wait + Prox ADC */
+        us = 2 * APDS9930_STEP_US
+           + (uint32_t)sim->regs[APDS9930_PPULSE] * APDS9930_PULSE_US
+           + (uint32_t)(256 - sim->regs[APDS9930_PTIME]) * APDS9930_STEP_US;
+    }
+    else if(phase == APDS9930_SIM_WAIT)
+    {
+        us = (uint32_t)(256 - sim->regs[APDS9930_WTIME]) * APDS9930_STEP_US;
+        if(sim->regs[APDS9930_CONFIG] & APDS9930_WLONG)
+            us *= 12;
+    }
+    else if(phase == APDS9930_SIM_ALS)
+    {
+        /* ALS Init + ALS ADC */
+        us = APDS9930_STEP_US + (uint32_t)(256 - sim->regs[APDS9930_ATIME]) * APDS9930_STEP_US;
+    }
+
+    return us * 1000;
+}
+
+/**
+ * @brief       phase that follows another in the Prox, Wait, ALS sequence
+ * @param       sim   model
+ * @param       phase   current phase, APDS9930_SIM_IDLE to get the first one
+ * @return      next enabled phase
+*/
+static uint8_t apds9930_sim_nextPhase(apds9930_sim_t *sim, uint8_t phase)
+{
+    static const uint8_t enable_bit[3] = {APDS9930_PEN, APDS9930_WEN, APDS9930_AEN};
+    uint8_t i;
+    uint8_t next = phase;
+
+    for(i = 0; i < 3; i++)
+    {
+        next = (next >= APDS9930_SIM_ALS || next == APDS9930_SIM_IDLE) ? APDS9930_SIM_PROX : next + 1;
+        if(sim->regs[APDS9930_ENABLE] & enable_bit[next - APDS9930_SIM_PROX])
+            return next;
+    }
+
+    return APDS9930_SIM_IDLE;
+}
+
+/**
+ * @brief       store a 16-bit ADC result
+ * @param       sim   model
+ * @param       address   low byte register
+ * @param       val   result
+ * @return      NONE
+*/
+static void apds9930_sim_store16(apds9930_sim_t *sim, uint8_t address, uint16_t val)
+{
+    sim->regs[address] = val & 0xFF;
+    sim->regs[address + 1] = val >> 8;
+}
+
+/**
+ * @brief       count of one ALS channel for the scene and the current gain/ATIME
+ * @param       sim   model
+ * @param       rate   counts per step at 1x gain, Q8
+ * @return      ADC counts, saturated like the device
+*/
+static uint16_t apds9930_sim_alsCount(apds9930_sim_t *sim, uint32_t rate)
+{
+    static const uint8_t gain[4] = {1, 8, 16, 120};
+    uint32_t steps = 256 - sim->regs[APDS9930_ATIME];
+    uint32_t max = steps * 1024 - 1;
+    uint64_t count;
+
+    count = ((uint64_t)rate * gain[sim->regs[APDS9930_CONTROL] & 0x03] * steps) >> 8;
+    if(sim->regs[APDS9930_CONFIG] & APDS9930_AGL)
+        count = count * 16 / 100;
+
+    if(max > 0xFFFF)
+        max = 0xFFFF;
+
+    return count > max ? (uint16_t)max : (uint16_t)count;
+}
+
+/**
+ * @brief       PDATA for the scene: target plus crosstalk minus the POFFSET correction
+ *              Crosstalk grows with PPULSE and the PDRIVE current, the
+ *              POFFSET correction with PPULSE only; bit 7 set shifts up.
+ * @param       sim   model
+ * @return      10-bit proximity count
+*/
+uint16_t apds9930_sim_pdata(apds9930_sim_t *sim)
+{
+    uint32_t pulses = sim->regs[APDS9930_PPULSE];
+    uint8_t poffset = sim->regs[APDS9930_POFFSET];
+    int32_t pdata;
+    int32_t shift;
+
+    pdata = sim->prox + (int32_t)(((uint64_t)sim->xtalk * pulses >> (sim->regs[APDS9930_CONTROL] >> 6)) >> 8);
+
+    shift = (int32_t)(((poffset & 0x7F) * pulses * APDS9930_SIM_POFFSET_STEP_Q8) >> 8);
+    pdata += (poffset & 0x80) ? shift : -shift;
+
+    if(pdata < 0)
+        pdata = 0;
+    if(pdata > 0x3FF)
+        pdata = 0x3FF;
+
+    return (uint16_t)pdata;
+}
+
+/**
+ * @brief       update a persistence filter with one conversion
+ * @param       count   consecutive out-of-range counter
+ * @param       pers   filter field value (0 = every cycle)
+ * @param       outside   the value was outside the threshold window
+ * @param       als   APERS coding (5x steps above 3) instead of PPERS
+ * @return      true if an interrupt must be raised
+*/
+static bool apds9930_sim_persist(uint8_t *count, uint8_t pers, bool outside, bool als)
+{
+    uint8_t needed;
+
+    if(pers == 0)
+        return true;
+
+    if(!outside)
+    {
+        *count = 0;
+        return false;
+    }
+
+    needed = (als && pers > 3) ? (uint8_t)(5 * (pers - 3)) : pers;
+    if(*count < 255)
+        (*count)++;
+
+    return *count >= needed;
+}
+
+/**
+ * @brief       end of a Prox or ALS ADC phase: latch data, valid and interrupt bits
+ * @param       sim   model
+ * @param       phase   completed phase
+ * @return      true if an interrupt was raised
+*/
+static bool apds9930_sim_complete(apds9930_sim_t *sim, uint8_t phase)
+{
+    uint8_t *r = sim->regs;
+    uint16_t ch0;
+    uint16_t pdata;
+    uint16_t low;
+    uint16_t high;
+
+    if(phase == APDS9930_SIM_PROX)
+    {
+        sim->prox_cycles++;
+        pdata = apds9930_sim_pdata(sim);
+        apds9930_sim_store16(sim, APDS9930_PDATAL, pdata);
+        r[APDS9930_STATUS] |= APDS9930_PVALID;
+
+        low = (uint16_t)(r[APDS9930_PILTL] | (r[APDS9930_PILTH] << 8));
+        high = (uint16_t)(r[APDS9930_PIHTL] | (r[APDS9930_PIHTH] << 8));
+        if(apds9930_sim_persist(&sim->ppers_count, r[APDS9930_PERS] >> 4,
+                                pdata < low || pdata > high, false))
+        {
+            r[APDS9930_STATUS] |= APDS9930_PINT;
+            return (r[APDS9930_ENABLE] & APDS9930_PIEN) != 0;
+        }
+    }
+    else if(phase == APDS9930_SIM_ALS)
+    {
+        sim->als_cycles++;
+        ch0 = apds9930_sim_alsCount(sim, sim->ch0_rate);
+        apds9930_sim_store16(sim, APDS9930_Ch0DATAL, ch0);
+        apds9930_sim_store16(sim, APDS9930_Ch1DATAL, apds9930_sim_alsCount(sim, sim->ch1_rate));
+        r[APDS9930_STATUS] |= APDS9930_AVALID;
+
+        low = (uint16_t)(r[APDS9930_AILTL] | (r[APDS9930_AILTH] << 8));
+        high = (uint16_t)(r[APDS9930_AIHTL] | (r[APDS9930_AIHTH] << 8));
+        if(apds9930_sim_persist(&sim->apers_count, r[APDS9930_PERS] & 0x0F,
+                                ch0 < low || ch0 > high, true))
+        {
+            r[APDS9930_STATUS] |= APDS9930_AINT;
+            return (r[APDS9930_ENABLE] & APDS9930_AIEN) != 0;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief       run the Prox/Wait/ALS state machine up to the current time
+ * @param       sim   model
+ * @return      NONE
+*/
+void apds9930_sim_update(apds9930_sim_t *sim)
+{
+    uint64_t now = apds9930_sim_now();
+    uint64_t t;
+    uint8_t enable = sim->regs[APDS9930_ENABLE];
+
+    if(!(enable & APDS9930_PON) || !(enable & (APDS9930_AEN | APDS9930_PEN)))
+    {
+        sim->phase = APDS9930_SIM_IDLE;
+        return;
+    }
+
+    if(sim->phase == APDS9930_SIM_SLEEP)
+        return;
+
+    if(sim->phase == APDS9930_SIM_IDLE)
+    {
+        sim->phase = apds9930_sim_nextPhase(sim, APDS9930_SIM_IDLE);
+        sim->phase_end_ns = now + apds9930_sim_phaseNs(sim, sim->phase);
+    }
+
+    while(sim->phase_end_ns <= now)
+    {
+        t = sim->phase_end_ns;
+        if(apds9930_sim_complete(sim, sim->phase) && (enable & APDS9930_SAI))
+        {
+            sim->phase = APDS9930_SIM_SLEEP;
+            return;
+        }
+        sim->phase = apds9930_sim_nextPhase(sim, sim->phase);
+        sim->phase_end_ns = t + apds9930_sim_phaseNs(sim, sim->phase);
+    }
+}
+
+/**
+ * @brief       power-on reset of the model
+ * @param       sim   model to reset
+ * @return      NONE
+*/
+void apds9930_sim_reset(apds9930_sim_t *sim)
+{
+    uint8_t i;
+
+    for(i = 0; i < APDS9930_SIM_REGS; i++)
+    {
+        sim->regs[i] = 0;
+    }
+    sim->regs[APDS9930_ATIME] = 0xFF;
+    sim->regs[APDS9930_PTIME] = 0xFF;
+    sim->regs[APDS9930_WTIME] = 0xFF;
+    sim->regs[APDS9930_ID] = APDS9930_ID_2;
+
+    sim->address = APDS9930_I2C_ADDR;
+    sim->pointer = 0;
+    sim->autoinc = 0;
+    sim->transactions = 0;
+    sim->bytes = 0;
+    sim->log_count = 0;
+    sim->ch0_rate = 0;
+    sim->ch1_rate = 0;
+    sim->prox = 0;
+    sim->xtalk = 0;
+    sim->phase = APDS9930_SIM_IDLE;
+    sim->phase_end_ns = 0;
+    sim->apers_count = 0;
+    sim->ppers_count = 0;
+    sim->als_cycles = 0;
+    sim->prox_cycles = 0;
+    sim->int_line = 1;
+}
+
+/**
+ * @brief       handle the command byte that follows a write address
+ * @param       sim   model
+ * @param       cmd   REPEATED_BYTE/AUTO_INCREMENT | register, or SPECIAL_FN | function
+ * @return      NONE
+*/
+void apds9930_sim_command(apds9930_sim_t *sim, uint8_t cmd)
+{
+    sim->bytes++;
+
+    /* CMD bit must be set, otherwise the byte is ignored */
+    if(!(cmd & 0x80))
+        return;
+
+    if(sim->log_count < APDS9930_SIM_LOG_SIZE)
+    {
+        sim->log[sim->log_count].cmd = cmd;
+        sim->log[sim->log_count].len = 0;
+    }
+    sim->log_count++;
+
+    if((cmd & SPECIAL_FN) == SPECIAL_FN)
+    {
+        if(cmd == CLEAR_PROX_INT || cmd == CLEAR_ALL_INTS)
+            sim->regs[APDS9930_STATUS] &= ~APDS9930_PINT;
+        if(cmd == CLEAR_ALS_INT || cmd == CLEAR_ALL_INTS)
+            sim->regs[APDS9930_STATUS] &= ~APDS9930_AINT;
+
+        /* Sleep-after-interrupt ends with the interrupt clear */
+        if(sim->phase == APDS9930_SIM_SLEEP)
+        {
+            sim->phase = APDS9930_SIM_IDLE;
+            apds9930_sim_update(sim);
+        }
+        return;
+    }
+
+    sim->pointer = cmd & 0x1F;
+    sim->autoinc = (cmd & SPECIAL_FN) == AUTO_INCREMENT;
+}
+
+/**
+ * @brief       store one data byte at the register pointer
+ * @param       sim   model
+ * @param       dat   data byte
+ * @return      NONE
+*/
+void apds9930_sim_writeByte(apds9930_sim_t *sim, uint8_t dat)
+{
+    sim->bytes++;
+    if(sim->log_count != 0 && sim->log_count <= APDS9930_SIM_LOG_SIZE)
+        sim->log[sim->log_count - 1].len++;
+
+    /* ID, STATUS and the ADC data are read only */
+    if(sim->pointer <= APDS9930_CONTROL || sim->pointer == APDS9930_POFFSET)
+    {
+        if(sim->pointer == APDS9930_ENABLE)
+            dat &= 0x7F;
+        sim->regs[sim->pointer] = dat;
+
+        /* Stopping an engine invalidates its data, enabling one starts a new cycle right away */
+        if(sim->pointer == APDS9930_ENABLE)
+        {
+            if(!(dat & APDS9930_PON) || !(dat & APDS9930_AEN))
+                sim->regs[APDS9930_STATUS] &= ~APDS9930_AVALID;
+            if(!(dat & APDS9930_PON) || !(dat & APDS9930_PEN))
+                sim->regs[APDS9930_STATUS] &= ~APDS9930_PVALID;
+            apds9930_sim_update(sim);
+        }
+    }
+
+    if(sim->autoinc)
+        sim->pointer = (sim->pointer + 1) & 0x1F;
+}
+
+/**
+ * @brief       return one data byte from the register pointer
+ * @param       sim   model
+ * @return      register data
+*/
+uint8_t apds9930_sim_readByte(apds9930_sim_t *sim)
+{
+    uint8_t dat = sim->regs[sim->pointer];
+
+    sim->bytes++;
+
+    if(sim->autoinc)
+        sim->pointer = (sim->pointer + 1) & 0x1F;
+
+    return dat;
+}
+
+/**
+ * @brief       load the ADC result registers directly
+ * @param       sim   model
+ * @param       ch0   Ch0 counts
+ * @param       ch1   Ch1 counts
+ * @param       pdata   proximity counts
+ * @return      NONE
+*/
+void apds9930_sim_setData(apds9930_sim_t *sim, uint16_t ch0, uint16_t ch1, uint16_t pdata)
+{
+    sim->regs[APDS9930_Ch0DATAL] = ch0 & 0xFF;
+    sim->regs[APDS9930_Ch0DATAH] = ch0 >> 8;
+    sim->regs[APDS9930_Ch1DATAL] = ch1 & 0xFF;
+    sim->regs[APDS9930_Ch1DATAH] = ch1 >> 8;
+    sim->regs[APDS9930_PDATAL] = pdata & 0xFF;
+    sim->regs[APDS9930_PDATAH] = pdata >> 8;
+    sim->regs[APDS9930_STATUS] |= APDS9930_AVALID | APDS9930_PVALID;
+}
+
+/**
+ * @brief       program the light and proximity seen by the model
+ * @param       sim   model
+ * @param       ch0_rate   Ch0 counts per 2.73 ms step at 1x gain, Q8
+ * @param       ch1_rate   Ch1 counts per 2.73 ms step at 1x gain, Q8
+ * @param       prox   PDATA the current target produces
+ * @return      NONE
+*/
+void apds9930_sim_setScene(apds9930_sim_t *sim, uint32_t ch0_rate, uint32_t ch1_rate, uint16_t prox)
+{
+    apds9930_sim_update(sim);
+
+    sim->ch0_rate = ch0_rate;
+    sim->ch1_rate = ch1_rate;
+    sim->prox = prox;
+}
+
+/**
+ * @brief       level of the open-drain INT pin
+ * @param       sim   model
+ * @return      0 while an enabled interrupt is pending, 1 otherwise
+*/
+uint8_t apds9930_sim_intLevel(apds9930_sim_t *sim)
+{
+    uint8_t status;
+    uint8_t enable = sim->regs[APDS9930_ENABLE];
+
+    apds9930_sim_update(sim);
+    status = sim->regs[APDS9930_STATUS];
+
+    if(((status & APDS9930_AINT) && (enable & APDS9930_AIEN)) ||
+       ((status & APDS9930_PINT) && (enable & APDS9930_PIEN)))
+        return 0;
+
+    return 1;
+}
+
+/**
+ * @brief       sample the INT line and run the handler on a falling edge
+ * @param       sim   model
+ * @return      NONE
+*/
+void apds9930_sim_serviceInt(apds9930_sim_t *sim)
+{
+    uint8_t level;
+
+    if(sim->int_handler == NULL)
+        return;
+
+    level = apds9930_sim_intLevel(sim);
+    if(sim->int_line && !level)
+    {
+        sim->int_line = 0;
+        sim->int_handler(sim->int_ctx);
+        level = apds9930_sim_intLevel(sim);
+    }
+    sim->int_line = level;
+}
+
+/**
+ * @brief       attach an EXTI-like handler to the INT line of a model
+ *              HAL_Delay() services every model that ever had one attached
+ * @param       sim   model
+ * @param       handler   called on each falling edge, NULL to detach
+ * @param       ctx   handed to handler
+ * @return      NONE
+*/
+void apds9930_sim_setIntHandler(apds9930_sim_t *sim, void (*handler)(void *ctx), void *ctx)
+{
+    uint8_t i;
+
+    sim->int_handler = handler;
+    sim->int_ctx = ctx;
+    sim->int_line = 1;
+
+    for(i = 0; i < apds9930_sim_intCount; i++)
+    {
+        if(apds9930_sim_intModels[i] == sim)
+            return;
+    }
+
+    if(handler != NULL && apds9930_sim_intCount < APDS9930_SIM_MAX_INT)
+        apds9930_sim_intModels[apds9930_sim_intCount++] = sim;
+}
+
+/**
+ * @brief       account the wire time of one register-level transaction
+ * @param       sim   model
+ * @param       bytes   bytes on the wire, address bytes included
+ * @param       conditions   START, repeated START and STOP conditions
+ * @return      NONE
+*/
+static void apds9930_bus_sim_elapse(apds9930_sim_t *sim, uint32_t bytes, uint32_t conditions)
+{
+    apds9930_sim_advanceNs((uint64_t)(bytes * 9 + conditions) * APDS9930_SIM_BUS_BIT_NS);
+    apds9930_sim_update(sim);
+}
+
+/**
+ * @brief       register-level transport: nothing to bring up
+ * @param       ctx   model
+ * @return      NONE
+*/
+static void apds9930_bus_sim_init(void *ctx)
+{
+    (void)ctx;
+}
+
+/**
+ * @brief       command byte, then len reads from the model
+ * @param       ctx   model
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @param       buf   receive buffer
+ * @param       len   number of bytes to read
+ * @return      1 if addr does not match the model
+*/
+static uint8_t apds9930_bus_sim_read(void *ctx, uint8_t addr, uint8_t cmd, uint8_t *buf, uint8_t len)
+{
+    apds9930_sim_t *sim = (apds9930_sim_t *)ctx;
+    uint8_t i;
+
+    if(addr != sim->address)
+        return 1;
+
+    apds9930_bus_sim_elapse(sim, 3 + len, 3);
+    sim->transactions++;
+    apds9930_sim_command(sim, cmd);
+    for(i = 0; i < len; i++)
+    {
+        buf[i] = apds9930_sim_readByte(sim);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief       command byte, then len writes to the model
+ * @param       ctx   model
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @param       buf   data to write
+ * @param       len   number of bytes to write
+ * @return      1 if addr does not match the model
+*/
+static uint8_t apds9930_bus_sim_write(void *ctx, uint8_t addr, uint8_t cmd, const uint8_t *buf, uint8_t len)
+{
+    apds9930_sim_t *sim = (apds9930_sim_t *)ctx;
+    uint8_t i;
+
+    if(addr != sim->address)
+        return 1;
+
+    apds9930_bus_sim_elapse(sim, 2 + len, 2);
+    sim->transactions++;
+    apds9930_sim_command(sim, cmd);
+    for(i = 0; i < len; i++)
+    {
+        apds9930_sim_writeByte(sim, buf[i]);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief       bare command byte
+ * @param       ctx   model
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @return      1 if addr does not match the model
+*/
+static uint8_t apds9930_bus_sim_command(void *ctx, uint8_t addr, uint8_t cmd)
+{
+    return apds9930_bus_sim_write(ctx, addr, cmd, 0, 0);
+}
+
+const apds9930_bus_t apds9930_bus_sim = {
+    apds9930_bus_sim_init,
+    apds9930_bus_sim_read,
+    apds9930_bus_sim_write,
+    apds9930_bus_sim_command,
+    &apds9930_sim_default
+};
+
+#ifdef APDS9930_HOST_SIM
+
+apds9930_lp_sim_t apds9930_lp_sim_default;
+
+/**
+ * @brief       take the INT line away from the EXTI-like handler, as masking its IMR bit does
+ * @param       ctx   apds9930_lp_sim_t
+ * @param       dev   device whose INT wakes the core
+ * @return      NONE
+*/
+static void apds9930_lp_sim_arm(void *ctx, apds9930_dev_t *dev)
+{
+    apds9930_lp_sim_t *lp = (apds9930_lp_sim_t *)ctx;
+
+    apds9930_sim_setIntHandler(dev->int_sim ? dev->int_sim : &apds9930_sim_default, NULL, NULL);
+    lp->arms++;
+}
+
+/**
+ * @brief       skip simulated time to the next INT assertion, the wake-up timer or forever
+ * @param       ctx   apds9930_lp_sim_t
+ * @param       dev   device whose INT wakes the core
+ * @return      true if INT is low
+*/
+static bool apds9930_lp_sim_stop(void *ctx, apds9930_dev_t *dev)
+{
+    apds9930_lp_sim_t *lp = (apds9930_lp_sim_t *)ctx;
+    apds9930_sim_t *sim = dev->int_sim ? dev->int_sim : &apds9930_sim_default;
+    uint64_t start = apds9930_sim_now();
+    uint64_t end = lp->max_ms ? start + (uint64_t)lp->max_ms * 1000000 : UINT64_MAX;
+    bool asserted;
+
+    if(lp->wake_at)
+        lp->run_ns += start - lp->wake_at;
+
+    if(!apds9930_sim_intLevel(sim))
+    {
+        lp->skipped++;
+        lp->wake_at = start;
+        return true;
+    }
+
+    lp->stops++;
+    /* Register-level transfers are atomic, only a bit-level bus can be left driven */
+    if(sim->bus_odr && (*sim->bus_odr & sim->bus_pins) != sim->bus_pins)
+        lp->bus_held++;
+
+    /* INT only ever falls when a phase completes */
+    while(apds9930_sim_intLevel(sim))
+    {
+        if(sim->phase == APDS9930_SIM_IDLE || sim->phase == APDS9930_SIM_SLEEP || sim->phase_end_ns >= end)
+        {
+            /* Nothing will pull INT low: a real core would never wake up */
+            if(end != UINT64_MAX)
+                apds9930_sim_advanceNs(end - apds9930_sim_now());
+            break;
+        }
+        apds9930_sim_advanceNs(sim->phase_end_ns - apds9930_sim_now());
+    }
+
+    asserted = !apds9930_sim_intLevel(sim);
+    if(!asserted)
+        lp->timeouts++;
+
+    lp->stop_ns += apds9930_sim_now() - start;
+    lp->wake_at = apds9930_sim_now();
+    apds9930_sim_advanceNs(lp->wake_ns);
+
+    return asserted;
+}
+
+const apds9930_lp_t apds9930_lp_sim = {
+    apds9930_lp_sim_arm,
+    apds9930_lp_sim_stop,
+    &apds9930_lp_sim_default
+};
+
+/**
+ * @brief       host HAL_GetTick() on the simulated clock
+ * @param       NONE
+ * @return      simulated ms
+*/
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(apds9930_sim_ns / 1000000);
+}
+
+/**
+ * @brief       host HAL_Delay() advances the simulated clock
+ *              in 1 ms steps, servicing the INT line of every attached model
+ * @param       Delay   ms
+ * @return      NONE
+*/
+void HAL_Delay(uint32_t Delay)
+{
+    uint64_t end = apds9930_sim_ns + (uint64_t)Delay * 1000000;
+    uint8_t i;
+
+    while(apds9930_sim_ns < end)
+    {
+        apds9930_sim_ns += (end - apds9930_sim_ns < 1000000) ? end - apds9930_sim_ns : 1000000;
+        for(i = 0; i < apds9930_sim_intCount; i++)
+        {
+            apds9930_sim_serviceInt(apds9930_sim_intModels[i]);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef __APDS9930_SIM_H
+#define __APDS9930_SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "apds9930_bus.h"
+
+/* Simulated register file covers 0x00-0x1F */
+#define APDS9930_SIM_REGS       0x20
+
+/* Bit time used by apds9930_bus_sim to advance the clock (400 kHz) */
+#ifndef APDS9930_SIM_BUS_BIT_NS
+#define APDS9930_SIM_BUS_BIT_NS 2500
+#endif
+
+/* Models whose INT line HAL_Delay() services */
+#ifndef APDS9930_SIM_MAX_INT
+#define APDS9930_SIM_MAX_INT    8
+#endif
+
+/* PDATA shift of one POFFSET step per LED pulse, Q8 counts */
+#ifndef APDS9930_SIM_POFFSET_STEP_Q8
+#define APDS9930_SIM_POFFSET_STEP_Q8    64
+#endif
+
+/* Command bytes kept in the write log of a model */
+#ifndef APDS9930_SIM_LOG_SIZE
+#define APDS9930_SIM_LOG_SIZE   32
+#endif
+
+/* Internal state machine phases */
+enum {
+  APDS9930_SIM_IDLE,
+  APDS9930_SIM_PROX,
+  APDS9930_SIM_WAIT,
+  APDS9930_SIM_ALS,
+  APDS9930_SIM_SLEEP
+};
+
+/* One command byte and the data bytes written after it */
+typedef struct {
+    uint8_t  cmd;
+    uint8_t  len;               /* 0 for a read, a special function or a bare command */
+} apds9930_sim_write_t;
+
+/* In-memory APDS-9930 */
+typedef struct {
+    uint8_t  regs[APDS9930_SIM_REGS];
+    uint8_t  address;           /* 7-bit address the model answers to */
+    uint8_t  pointer;           /* register selected by the last command byte */
+    uint8_t  autoinc;           /* pointer advances after every data byte */
+    uint32_t transactions;      /* START conditions addressed to the model */
+    uint32_t bytes;             /* data bytes moved, command bytes included */
+    apds9930_sim_write_t log[APDS9930_SIM_LOG_SIZE];
+    uint32_t log_count;         /* command bytes seen, the first APDS9930_SIM_LOG_SIZE are logged */
+
+    /* scene */
+    uint32_t ch0_rate;          /* Ch0 counts per 2.73 ms step at 1x gain, Q8 */
+    uint32_t ch1_rate;          /* Ch1 counts per 2.73 ms step at 1x gain, Q8 */
+    uint16_t prox;              /* PDATA produced by the current target */
+    uint32_t xtalk;             /* cover-glass crosstalk per pulse at 100 mA, Q8 counts */
+
+    /* state machine */
+    uint8_t  phase;             /* APDS9930_SIM_* */
+    uint64_t phase_end_ns;      /* simulated time the current phase completes */
+    uint8_t  apers_count;       /* consecutive Ch0 values out of range */
+    uint8_t  ppers_count;       /* consecutive PDATA values out of range */
+    uint32_t als_cycles;        /* completed ALS conversions */
+    uint32_t prox_cycles;       /* completed proximity conversions */
+
+    /* INT line */
+    void (*int_handler)(void *ctx); /* called on each falling edge, like an EXTI */
+    void *int_ctx;              /* handed to int_handler */
+    uint8_t  int_line;          /* last level seen by apds9930_sim_serviceInt() */
+
+    /* bit-level bus, set by iic_sim_attach(), NULL for a register-level only model */
+    const uint16_t *bus_odr;    /* MCU output latch of the port */
+    uint16_t bus_pins;          /* SCL | SDA */
+} apds9930_sim_t;
+
+/* Model behind apds9930_bus_sim */
+extern apds9930_sim_t apds9930_sim_default;
+
+/* Stand-in for STOP mode behind apds9930_lp_sim: stop() skips simulated
+   time to the next INT assertion and counts what a real core would spend */
+typedef struct {
+    uint32_t wake_ns;           /* STOP exit latency added on every wake-up */
+    uint32_t max_ms;            /* wake-up timer, stop() returns false after it, 0 = none */
+    uint32_t arms;              /* arm() calls */
+    uint32_t stops;             /* STOP entries */
+    uint32_t skipped;           /* stop() calls that found INT already low */
+    uint32_t timeouts;          /* wake-ups without INT */
+    uint32_t bus_held;          /* STOP entries with SCL or SDA driven low */
+    uint64_t stop_ns;           /* simulated time in STOP */
+    uint64_t run_ns;            /* simulated time awake between a wake-up and the next stop() */
+    uint64_t wake_at;           /* time of the last wake-up, 0 before the first */
+} apds9930_lp_sim_t;
+
+/* Mock behind apds9930_lp_sim */
+extern apds9930_lp_sim_t apds9930_lp_sim_default;
+
+/* Register-level transport bound to apds9930_sim_default */
+extern const apds9930_bus_t apds9930_bus_sim;
+
+/* Simulated clock shared by every model and the GPIO-level bus */
+uint64_t apds9930_sim_now(void);
+void apds9930_sim_advanceNs(uint64_t ns);
+
+void apds9930_sim_reset(apds9930_sim_t *sim);
+void apds9930_sim_update(apds9930_sim_t *sim);
+void apds9930_sim_command(apds9930_sim_t *sim, uint8_t cmd);
+void apds9930_sim_writeByte(apds9930_sim_t *sim, uint8_t dat);
+uint8_t apds9930_sim_readByte(apds9930_sim_t *sim);
+void apds9930_sim_setData(apds9930_sim_t *sim, uint16_t ch0, uint16_t ch1, uint16_t pdata);
+void apds9930_sim_setScene(apds9930_sim_t *sim, uint32_t ch0_rate, uint32_t ch1_rate, uint16_t prox);
+uint8_t apds9930_sim_intLevel(apds9930_sim_t *sim);
+uint16_t apds9930_sim_pdata(apds9930_sim_t *sim);
+void apds9930_sim_serviceInt(apds9930_sim_t *sim);
+void apds9930_sim_setIntHandler(apds9930_sim_t *sim, void (*handler)(void *ctx), void *ctx);
+
+#ifdef APDS9930_HOST_SIM
+/* Host stand-ins for the HAL services used by the driver */
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+#endif
+
+#endif
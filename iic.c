@@ -1,230 +1,684 @@
-#include "iic.h"
-
-/*
-*********************************************************************************************************
-*	  : i2c_Delay
-*	˵: I2Cλӳ٣400KHz
-*	    Σ
-*	  ֵ: 
-*********************************************************************************************************
-*/
-static void i2c_Delay(void)
-{
-	volatile uint16_t i=0;
-
-	for (i = 0; i < 50; i++);
-}
-
-void iic_gpio_init(void)
-{
-    GPIO_InitTypeDef GPIO_InitStruct = {0};
-
-    __HAL_RCC_GPIOA_CLK_ENABLE();
-
-    /*Configure GPIO pins : PAPin PAPin */
-    GPIO_InitStruct.Pin = IIC_SCL_Pin|IIC_SDA_Pin;
-    GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
-    GPIO_InitStruct.Pull = GPIO_NOPULL;
-    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
-    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
-
-    /*Configure GPIO pin Output Level */
-    HAL_GPIO_WritePin(GPIOA, IIC_SCL_Pin|IIC_SDA_Pin, GPIO_PIN_SET);
-}
-
-/*
-*********************************************************************************************************
-*	  : i2c_Start
-*	˵: CPUI2Cź
-*	    Σ
-*	  ֵ: 
-*********************************************************************************************************
-*/
-void i2c_Start(void)
-{
-	/* SCLߵƽʱSDAһرʾI2Cź */
-	I2C_SDA_1();
-	I2C_SCL_1();
-	i2c_Delay();
-	I2C_SDA_0();
-	i2c_Delay();
-	I2C_SCL_0();
-	i2c_Delay();
-}
-
-/*
-*********************************************************************************************************
-*	  : i2c_Start
-*	˵: CPUI2Cֹͣź
-*	    Σ
-*	  ֵ: 
-*********************************************************************************************************
-*/
-void i2c_Stop(void)
-{
-	/* SCLߵƽʱSDAһرʾI2Cֹͣź */
-	I2C_SDA_0();
-	I2C_SCL_1();
-	i2c_Delay();
-	I2C_SDA_1();
-}
-
-/*
-*********************************************************************************************************
-*	  : i2c_SendByte
-*	˵: CPUI2C豸8bit
-*	    Σ_ucByte  ȴ͵ֽ
-*	  ֵ: 
-*********************************************************************************************************
-*/
-void i2c_SendByte(uint8_t _ucByte)
-{
-	uint8_t i;
-
-	/* ȷֽڵĸλbit7 */
-	for (i = 0; i < 8; i++)
-	{		
-		if (_ucByte & 0x80)
-		{
-			I2C_SDA_1();
-		}
-		else
-		{
-			I2C_SDA_0();
-		}
-		i2c_Delay();
-		I2C_SCL_1();
-		i2c_Delay();	
-		I2C_SCL_0();
-		if (i == 7)
-		{
-			 I2C_SDA_1(); // ͷ
-		}
-		_ucByte <<= 1;	/* һbit */
-		i2c_Delay();
-	}
-}
-
-/*
-*********************************************************************************************************
-*	  : i2c_ReadByte
-*	˵: CPUI2C豸ȡ8bit
-*	    Σ
-*	  ֵ: 
-*********************************************************************************************************
-*/
-uint8_t i2c_ReadByte(uint8_t ack)
-{
-	uint8_t i;
-	uint8_t value;
-
-	/* 1bitΪݵbit7 */
-	value = 0;
-	for (i = 0; i < 8; i++)
-	{
-		value <<= 1;
-		I2C_SCL_1();
-		i2c_Delay();
-		if (I2C_SDA_READ())
-		{
-			value++;
-		}
-		I2C_SCL_0();
-		i2c_Delay();
-	}
-	if(ack==0)
-		i2c_NAck();
-	else
-		i2c_Ack();
-	return value;
-}
-
-/*
-*********************************************************************************************************
-*	  : i2c_WaitAck
-*	˵: CPUһʱӣȡACKӦź
-*	    Σ
-*	  ֵ: 0ʾȷӦ1ʾӦ
-*********************************************************************************************************
-*/
-uint8_t i2c_WaitAck(void)
-{
-	uint8_t re;
-
-	I2C_SDA_1();	/* CPUͷSDA */
-	i2c_Delay();
-	I2C_SCL_1();	/* CPUSCL = 1, ʱ᷵ACKӦ */
-	i2c_Delay();
-
-	if (I2C_SDA_READ())	/* CPUȡSDA״̬ */
-	{
-		re = 1;
-	}
-	else
-	{
-		re = 0;
-	}
-	I2C_SCL_0();
-	i2c_Delay();
-	return re;
-}
-
-/*
-*********************************************************************************************************
-*	  : i2c_Ack
-*	˵: CPUһACKź
-*	    Σ
-*	  ֵ: 
-*********************************************************************************************************
-*/
-void i2c_Ack(void)
-{
-	I2C_SDA_0();	/* CPUSDA = 0 */
-	i2c_Delay();
-	I2C_SCL_1();	/* CPU1ʱ */
-	i2c_Delay();
-	I2C_SCL_0();
-	i2c_Delay();
-	I2C_SDA_1();	/* CPUͷSDA */
-}
-
-/*
-*********************************************************************************************************
-*	  : i2c_NAck
-*	˵: CPU1NACKź
-*	    Σ
-*	  ֵ: 
-*********************************************************************************************************
-*/
-void i2c_NAck(void)
-{
-	I2C_SDA_1();	/* CPUSDA = 1 */
-	i2c_Delay();
-	I2C_SCL_1();	/* CPU1ʱ */
-	i2c_Delay();
-	I2C_SCL_0();
-	i2c_Delay();	
-}
-
-/*
-*********************************************************************************************************
-*	  : i2c_CheckDevice
-*	˵: I2C豸CPU豸ַȻȡ豸Ӧжϸ豸Ƿ
-*	    Σ_Address豸I2Cߵַ
-*	  ֵ: ֵ 0 ʾȷ 1ʾδ̽⵽
-*********************************************************************************************************
-*/
-uint8_t i2c_CheckDevice(uint8_t _Address)
-{
-	uint8_t ucAck;
-
-	i2c_Start();		/* ź */
-
-	/* 豸ַ+дbit0 = w 1 = r) bit7 ȴ */
-	i2c_SendByte(_Address<<1&0xfe);
-	ucAck = i2c_WaitAck();	/* 豸ACKӦ */
-
-	i2c_Stop();			/* ֹͣź */
-
-	return ucAck;
-}
\ No newline at end of file
+#include "iic.h"
+
+#ifdef IIC_STATS
+i2c_stats_t i2c_stats;		/* 总线开销统计 */
+#endif
+
+static uint32_t i2c_uiSpeedHz = I2C_SPEED_DEFAULT;	/* 当前总线频率 */
+static uint32_t i2c_uiLowCycles;		/* SCL低电平半周期对应的CPU周期数 */
+static uint32_t i2c_uiHighCycles;		/* SCL高电平对应的CPU周期数 */
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_DelayCycles
+*	功能说明: 基于SysTick计数的CPU周期延迟，与优化等级和Flash等待周期无关（Cortex-M0+无DWT）
+*	形    参：_uiCycles : 延迟的CPU周期数
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+static void i2c_DelayCycles(uint32_t _uiCycles)
+{
+	I2C_STAT_ADD(delay_cycles, _uiCycles);
+
+#ifdef APDS9930_HOST_SIM
+	iic_sim_delayCycles(_uiCycles);
+#else
+	uint32_t load = SysTick->LOAD + 1;
+	uint32_t last = SysTick->VAL;
+	uint32_t now;
+	uint32_t elapsed = 0;
+
+	if (_uiCycles <= I2C_DELAY_OVERHEAD)
+	{
+		return;
+	}
+	_uiCycles -= I2C_DELAY_OVERHEAD;
+
+	/* SysTick为递减计数器，计到0后从LOAD重新开始 */
+	while (elapsed < _uiCycles)
+	{
+		now = SysTick->VAL;
+		elapsed += (last >= now) ? (last - now) : (last + load - now);
+		last = now;
+	}
+#endif
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_DelayLow
+*	功能说明: SCL低电平半周期延迟，每个低电平由两次调用组成（数据建立前后各一次）
+*	形    参：无
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+static void i2c_DelayLow(void)
+{
+	i2c_DelayCycles(i2c_uiLowCycles);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_DelayHigh
+*	功能说明: SCL高电平延迟，同时满足起始/停止条件的建立与保持时间
+*	形    参：无
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+static void i2c_DelayHigh(void)
+{
+	i2c_DelayCycles(i2c_uiHighCycles);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_SetSpeed
+*	功能说明: 设置I2C总线频率，按I2C规范分别计算tLOW和tHIGH。超过I2C_SPEED_MAX的频率限制为
+*			  I2C_SPEED_MAX；延迟短于I2C_DELAY_OVERHEAD时延长到该开销，频率相应降低，
+*			  i2c_GetSpeed()返回实际频率
+*	形    参：_uiHz : 总线频率，I2C_SPEED_100K / I2C_SPEED_400K / I2C_SPEED_1M
+*	返 回 值: 0 表示按请求设置，1 表示频率被限制，_uiHz为0时不做修改也返回1
+*********************************************************************************************************
+*/
+uint8_t i2c_SetSpeed(uint32_t _uiHz)
+{
+	uint32_t period_ns;
+	uint32_t low_ns;
+	uint32_t high_ns;
+	uint32_t low_min_ns;
+	uint32_t high_min_ns;
+	uint32_t overhead_ns;
+	uint32_t speed_hz;
+
+	if (_uiHz == 0)
+	{
+		return 1;
+	}
+	speed_hz = (_uiHz > I2C_SPEED_MAX) ? I2C_SPEED_MAX : _uiHz;
+
+	/* I2C规范中的最小tLOW/tHIGH */
+	if (speed_hz > I2C_SPEED_400K)
+	{
+		low_min_ns = 500;
+		high_min_ns = 260;
+	}
+	else if (speed_hz > I2C_SPEED_100K)
+	{
+		low_min_ns = 1300;
+		high_min_ns = 600;
+	}
+	else
+	{
+		low_min_ns = 4700;
+		high_min_ns = 4000;
+	}
+
+	/* 延迟不能短于调用开销：低电平分两次延迟，高电平一次 */
+	overhead_ns = (uint32_t)(((uint64_t)I2C_DELAY_OVERHEAD * 1000000000UL + SystemCoreClock - 1) / SystemCoreClock);
+	if (low_min_ns < 2 * overhead_ns)
+	{
+		low_min_ns = 2 * overhead_ns;
+	}
+	if (high_min_ns < overhead_ns)
+	{
+		high_min_ns = overhead_ns;
+	}
+
+	/* 周期按约6:4分配给低/高电平，不足最小值时放宽 */
+	period_ns = 1000000000UL / speed_hz;
+	low_ns = period_ns * 6 / 10;
+	if (low_ns < low_min_ns)
+	{
+		low_ns = low_min_ns;
+	}
+	high_ns = (period_ns > low_ns) ? (period_ns - low_ns) : 0;
+	if (high_ns < high_min_ns)
+	{
+		high_ns = high_min_ns;
+	}
+
+	/* 放宽后的实际频率 */
+	if (speed_hz > 1000000000UL / (low_ns + high_ns))
+	{
+		speed_hz = 1000000000UL / (low_ns + high_ns);
+	}
+
+	i2c_uiSpeedHz = speed_hz;
+	i2c_uiLowCycles = (uint32_t)(((uint64_t)low_ns * SystemCoreClock / 2 + 999999999UL) / 1000000000UL);
+	i2c_uiHighCycles = (uint32_t)(((uint64_t)high_ns * SystemCoreClock + 999999999UL) / 1000000000UL);
+
+	return (speed_hz == _uiHz) ? 0 : 1;
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_GetSpeed
+*	功能说明: 读取当前设置的I2C总线频率
+*	形    参：无
+*	返 回 值: 总线频率（Hz）
+*********************************************************************************************************
+*/
+uint32_t i2c_GetSpeed(void)
+{
+	return i2c_uiSpeedHz;
+}
+
+#ifdef IIC_STATS
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_ResetStats
+*	功能说明: 清零总线开销统计
+*	形    参：无
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void i2c_ResetStats(void)
+{
+	i2c_stats_t empty = {0};
+
+	i2c_stats = empty;
+}
+#endif
+
+#ifdef IIC_MULTI_BUS
+const iic_bus_t iic_bus_default = { IIC_SCL_GPIO_Port, IIC_SCL_Pin, IIC_SDA_Pin };
+const iic_bus_t *i2c_pBus = &iic_bus_default;
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_SelectBus
+*	功能说明: 选择后续所有总线操作使用的SCL/SDA引脚，各总线共用同一组时序参数
+*	形    参：_pBus : 总线引脚，NULL表示iic_bus_default
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void i2c_SelectBus(const iic_bus_t *_pBus)
+{
+	i2c_pBus = (_pBus != NULL) ? _pBus : &iic_bus_default;
+}
+#endif
+
+/*
+*********************************************************************************************************
+*	函 数 名: iic_gpio_init
+*	功能说明: 把当前总线的SCL/SDA配置为开漏输出并释放总线
+*	形    参：无
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void iic_gpio_init(void)
+{
+#ifdef APDS9930_HOST_SIM
+    /*release both lines of the simulated open-drain bus*/
+    iic_sim_bsrr(I2C_SCL_PORT, I2C_SCL_PIN|I2C_SDA_PIN);
+#else
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    if (I2C_SCL_PORT == GPIOA)
+        __HAL_RCC_GPIOA_CLK_ENABLE();
+    else if (I2C_SCL_PORT == GPIOB)
+        __HAL_RCC_GPIOB_CLK_ENABLE();
+    else if (I2C_SCL_PORT == GPIOC)
+        __HAL_RCC_GPIOC_CLK_ENABLE();
+
+    /*Configure GPIO pins : SCL SDA */
+    GPIO_InitStruct.Pin = I2C_SCL_PIN|I2C_SDA_PIN;
+    GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    HAL_GPIO_Init(I2C_SCL_PORT, &GPIO_InitStruct);
+
+    /*Configure GPIO pin Output Level */
+    HAL_GPIO_WritePin(I2C_SCL_PORT, I2C_SCL_PIN|I2C_SDA_PIN, GPIO_PIN_SET);
+#endif
+
+    /*Bus timing depends on SystemCoreClock*/
+    i2c_SetSpeed(i2c_uiSpeedHz);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_Start
+*	功能说明: CPU发起I2C总线启动信号
+*	形    参：无
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void i2c_Start(void)
+{
+	/* 当SCL高电平时，SDA出现一个下跳沿表示I2C总线启动信号 */
+	I2C_SDA_1();
+	i2c_DelayLow();		/* 重复起始时保证SCL低电平时间 */
+	I2C_SCL_1();
+	i2c_DelayHigh();	/* tSU;STA */
+	I2C_SDA_0();
+	i2c_DelayHigh();	/* tHD;STA */
+	I2C_SCL_0();
+	i2c_DelayLow();
+
+	I2C_STAT_ADD(starts, 1);
+	I2C_STAT_ADD(scl_edges, 2);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_Start
+*	功能说明: CPU发起I2C总线停止信号
+*	形    参：无
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void i2c_Stop(void)
+{
+	/* 当SCL高电平时，SDA出现一个上跳沿表示I2C总线停止信号 */
+	I2C_SDA_0();
+	i2c_DelayLow();
+	I2C_SCL_1();
+	i2c_DelayHigh();	/* tSU;STO */
+	I2C_SDA_1();
+	i2c_DelayLow();		/* tBUF: 下一个起始信号前的总线空闲时间 */
+	i2c_DelayLow();
+
+	I2C_STAT_ADD(stops, 1);
+	I2C_STAT_ADD(scl_edges, 1);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_SendByte
+*	功能说明: CPU向I2C总线设备发送8bit数据
+*	形    参：_ucByte ： 等待发送的字节
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void i2c_SendByte(uint8_t _ucByte)
+{
+	uint8_t i;
+
+	/* 先发送字节的高位bit7 */
+	for (i = 0; i < 8; i++)
+	{		
+		if (_ucByte & 0x80)
+		{
+			I2C_SDA_1();
+		}
+		else
+		{
+			I2C_SDA_0();
+		}
+		i2c_DelayLow();
+		I2C_SCL_1();
+		i2c_DelayHigh();
+		I2C_SCL_0();
+		if (i == 7)
+		{
+			 I2C_SDA_1(); // 释放总线
+		}
+		_ucByte <<= 1;	/* 左移一个bit */
+		i2c_DelayLow();
+	}
+
+	I2C_STAT_ADD(bytes_tx, 1);
+	I2C_STAT_ADD(scl_edges, 16);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_ReadByte
+*	功能说明: CPU从I2C总线设备读取8bit数据
+*	形    参：无
+*	返 回 值: 读到的数据
+*********************************************************************************************************
+*/
+uint8_t i2c_ReadByte(uint8_t ack)
+{
+	uint8_t i;
+	uint8_t value;
+
+	/* 读到第1个bit为数据的bit7 */
+	value = 0;
+	for (i = 0; i < 8; i++)
+	{
+		value <<= 1;
+		i2c_DelayLow();
+		I2C_SCL_1();
+		i2c_DelayHigh();
+		if (I2C_SDA_READ())
+		{
+			value++;
+		}
+		I2C_SCL_0();
+		i2c_DelayLow();
+	}
+	if(ack==0)
+		i2c_NAck();
+	else
+		i2c_Ack();
+
+	I2C_STAT_ADD(bytes_rx, 1);
+	I2C_STAT_ADD(scl_edges, 16);
+	return value;
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_WaitAck
+*	功能说明: CPU产生一个时钟，并读取器件的ACK应答信号
+*	形    参：无
+*	返 回 值: 返回0表示正确应答，1表示无器件响应
+*********************************************************************************************************
+*/
+uint8_t i2c_WaitAck(void)
+{
+	uint8_t re;
+
+	I2C_SDA_1();	/* CPU释放SDA总线 */
+	i2c_DelayLow();
+	I2C_SCL_1();	/* CPU驱动SCL = 1, 此时器件会返回ACK应答 */
+	i2c_DelayHigh();
+
+	if (I2C_SDA_READ())	/* CPU读取SDA口线状态 */
+	{
+		re = 1;
+	}
+	else
+	{
+		re = 0;
+	}
+	I2C_SCL_0();
+	i2c_DelayLow();
+
+	I2C_STAT_ADD(nacks, re);
+	I2C_STAT_ADD(scl_edges, 2);
+	return re;
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_Ack
+*	功能说明: CPU产生一个ACK信号
+*	形    参：无
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void i2c_Ack(void)
+{
+	I2C_SDA_0();	/* CPU驱动SDA = 0 */
+	i2c_DelayLow();
+	I2C_SCL_1();	/* CPU产生1个时钟 */
+	i2c_DelayHigh();
+	I2C_SCL_0();
+	i2c_DelayLow();
+	I2C_SDA_1();	/* CPU释放SDA总线 */
+
+	I2C_STAT_ADD(scl_edges, 2);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_NAck
+*	功能说明: CPU产生1个NACK信号
+*	形    参：无
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void i2c_NAck(void)
+{
+	I2C_SDA_1();	/* CPU驱动SDA = 1 */
+	i2c_DelayLow();
+	I2C_SCL_1();	/* CPU产生1个时钟 */
+	i2c_DelayHigh();
+	I2C_SCL_0();
+	i2c_DelayLow();
+
+	I2C_STAT_ADD(scl_edges, 2);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_CheckDevice
+*	功能说明: 检测I2C总线设备，CPU向发送设备地址，然后读取设备应答来判断该设备是否存在
+*	形    参：_Address：设备的I2C总线地址
+*	返 回 值: 返回值 0 表示正确， 返回1表示未探测到
+*********************************************************************************************************
+*/
+uint8_t i2c_CheckDevice(uint8_t _Address)
+{
+	uint8_t ucAck;
+
+	i2c_Start();		/* 发送启动信号 */
+
+	/* 发送设备地址+读写控制bit（0 = w， 1 = r) bit7 先传 */
+	i2c_SendByte(_Address<<1&0xfe);
+	ucAck = i2c_WaitAck();	/* 检测设备的ACK应答 */
+
+	i2c_Stop();			/* 发送停止信号 */
+
+	return ucAck;
+}
+#ifdef IIC_PARALLEL
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_ParInit
+*	功能说明: 建立并行总线描述并把SCL与所有SDA配置为开漏输出、释放总线
+*	形    参：_pPar : 并行总线
+*			  _pPort : SCL与SDA所在端口
+*			  _usScl : SCL引脚，可为多个
+*			  _pusSda : 各通道SDA引脚
+*			  _ucN : 通道数，不超过IIC_PAR_MAX
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void i2c_ParInit(iic_par_t *_pPar, iic_port_t *_pPort, uint16_t _usScl, const uint16_t *_pusSda, uint8_t _ucN)
+{
+	uint8_t i;
+
+	if (_ucN > IIC_PAR_MAX)
+	{
+		_ucN = IIC_PAR_MAX;
+	}
+
+	_pPar->port = _pPort;
+	_pPar->scl = _usScl;
+	_pPar->n = _ucN;
+	_pPar->sda_all = 0;
+	for (i = 0; i < _ucN; i++)
+	{
+		_pPar->sda[i] = _pusSda[i];
+		_pPar->sda_all |= _pusSda[i];
+	}
+
+#ifdef APDS9930_HOST_SIM
+	I2C_PAR_BSRR(_pPar, _pPar->scl | _pPar->sda_all);
+#else
+	{
+		GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+		if (_pPort == GPIOA)
+			__HAL_RCC_GPIOA_CLK_ENABLE();
+		else if (_pPort == GPIOB)
+			__HAL_RCC_GPIOB_CLK_ENABLE();
+		else if (_pPort == GPIOC)
+			__HAL_RCC_GPIOC_CLK_ENABLE();
+
+		GPIO_InitStruct.Pin = _pPar->scl | _pPar->sda_all;
+		GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
+		GPIO_InitStruct.Pull = GPIO_NOPULL;
+		GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+		HAL_GPIO_Init(_pPort, &GPIO_InitStruct);
+
+		I2C_PAR_BSRR(_pPar, _pPar->scl | _pPar->sda_all);
+	}
+#endif
+
+	i2c_SetSpeed(i2c_uiSpeedHz);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_ParStart
+*	功能说明: 在所有通道上同时发起起始（或重复起始）信号
+*	形    参：_pPar : 并行总线
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void i2c_ParStart(const iic_par_t *_pPar)
+{
+	I2C_PAR_BSRR(_pPar, _pPar->sda_all);
+	i2c_DelayLow();
+	I2C_PAR_BSRR(_pPar, _pPar->scl);
+	i2c_DelayHigh();
+	I2C_PAR_BSRR(_pPar, (uint32_t)_pPar->sda_all << 16);
+	i2c_DelayHigh();
+	I2C_PAR_BSRR(_pPar, (uint32_t)_pPar->scl << 16);
+	i2c_DelayLow();
+
+	I2C_STAT_ADD(starts, 1);
+	I2C_STAT_ADD(scl_edges, 2);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_ParStop
+*	功能说明: 在所有通道上同时发出停止信号
+*	形    参：_pPar : 并行总线
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void i2c_ParStop(const iic_par_t *_pPar)
+{
+	I2C_PAR_BSRR(_pPar, (uint32_t)_pPar->sda_all << 16);
+	i2c_DelayLow();
+	I2C_PAR_BSRR(_pPar, _pPar->scl);
+	i2c_DelayHigh();
+	I2C_PAR_BSRR(_pPar, _pPar->sda_all);
+	i2c_DelayLow();
+	i2c_DelayLow();
+
+	I2C_STAT_ADD(stops, 1);
+	I2C_STAT_ADD(scl_edges, 1);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_ParSendByte
+*	功能说明: 向所有通道同时发送同一字节（地址、命令或相同的配置）
+*	形    参：_pPar : 并行总线
+*			  _ucByte : 等待发送的字节
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void i2c_ParSendByte(const iic_par_t *_pPar, uint8_t _ucByte)
+{
+	uint32_t set = _pPar->sda_all;
+	uint32_t reset = (uint32_t)_pPar->sda_all << 16;
+	uint8_t i;
+
+	for (i = 0; i < 8; i++)
+	{
+		I2C_PAR_BSRR(_pPar, (_ucByte & 0x80) ? set : reset);
+		i2c_DelayLow();
+		I2C_PAR_BSRR(_pPar, _pPar->scl);
+		i2c_DelayHigh();
+		I2C_PAR_BSRR(_pPar, (uint32_t)_pPar->scl << 16);
+		if (i == 7)
+		{
+			I2C_PAR_BSRR(_pPar, set);	/* 释放总线 */
+		}
+		_ucByte <<= 1;
+		i2c_DelayLow();
+	}
+
+	I2C_STAT_ADD(bytes_tx, _pPar->n);
+	I2C_STAT_ADD(scl_edges, 16);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_ParReadByte
+*	功能说明: 从所有通道同时读取一个字节，每个数据位只读一次IDR，应答后再按通道拆分
+*	形    参：_pPar : 并行总线
+*			  _pucBytes : 通道i的字节写入_pucBytes[i * _ucStride]
+*			  _ucStride : 相邻通道的间隔
+*			  ack : 非0时所有通道应答ACK，0时应答NACK
+*	返 回 值: 无
+*********************************************************************************************************
+*/
+void i2c_ParReadByte(const iic_par_t *_pPar, uint8_t *_pucBytes, uint8_t _ucStride, uint8_t ack)
+{
+	uint16_t raw[8];
+	uint16_t sda;
+	uint8_t value;
+	uint8_t i;
+	uint8_t j;
+
+	for (i = 0; i < 8; i++)
+	{
+		i2c_DelayLow();
+		I2C_PAR_BSRR(_pPar, _pPar->scl);
+		i2c_DelayHigh();
+		raw[i] = I2C_PAR_IDR(_pPar);
+		I2C_PAR_BSRR(_pPar, (uint32_t)_pPar->scl << 16);
+		i2c_DelayLow();
+	}
+
+	/* ACK/NACK时钟 */
+	I2C_PAR_BSRR(_pPar, ack ? ((uint32_t)_pPar->sda_all << 16) : _pPar->sda_all);
+	i2c_DelayLow();
+	I2C_PAR_BSRR(_pPar, _pPar->scl);
+	i2c_DelayHigh();
+	I2C_PAR_BSRR(_pPar, (uint32_t)_pPar->scl << 16);
+	i2c_DelayLow();
+	I2C_PAR_BSRR(_pPar, _pPar->sda_all);
+
+	/* 总线空闲（SCL低）时拆分各通道的数据 */
+	for (j = 0; j < _pPar->n; j++)
+	{
+		sda = _pPar->sda[j];
+		value = 0;
+		for (i = 0; i < 8; i++)
+		{
+			value = (uint8_t)((value << 1) | ((raw[i] & sda) != 0));
+		}
+		_pucBytes[j * _ucStride] = value;
+	}
+
+	I2C_STAT_ADD(bytes_rx, _pPar->n);
+	I2C_STAT_ADD(scl_edges, 18);
+}
+
+/*
+*********************************************************************************************************
+*	函 数 名: i2c_ParWaitAck
+*	功能说明: 产生一个时钟，同时读取所有通道的ACK
+*	形    参：_pPar : 并行总线
+*	返 回 值: 第i位为1表示通道i无应答
+*********************************************************************************************************
+*/
+uint16_t i2c_ParWaitAck(const iic_par_t *_pPar)
+{
+	uint16_t idr;
+	uint16_t nack = 0;
+	uint8_t i;
+
+	I2C_PAR_BSRR(_pPar, _pPar->sda_all);
+	i2c_DelayLow();
+	I2C_PAR_BSRR(_pPar, _pPar->scl);
+	i2c_DelayHigh();
+	idr = I2C_PAR_IDR(_pPar);
+	I2C_PAR_BSRR(_pPar, (uint32_t)_pPar->scl << 16);
+	i2c_DelayLow();
+
+	for (i = 0; i < _pPar->n; i++)
+	{
+		if (idr & _pPar->sda[i])
+		{
+			nack |= (uint16_t)(1U << i);
+		}
+	}
+
+	I2C_STAT_ADD(nacks, nack != 0);
+	I2C_STAT_ADD(scl_edges, 2);
+	return nack;
+}
+#endif
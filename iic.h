@@ -1,35 +1,193 @@
-#ifndef __IIC_H
-#define __IIC_H
-
-#include <inttypes.h>
-
-#define IIC_SCL_Pin GPIO_PIN_6
-#define IIC_SCL_GPIO_Port GPIOA
-#define IIC_SDA_Pin GPIO_PIN_7
-#define IIC_SDA_GPIO_Port GPIOA
-
-#define I2C_SCL_0()     HAL_GPIO_WritePin(IIC_SCL_GPIO_Port,IIC_SCL_Pin,GPIO_PIN_RESET);
-#define I2C_SCL_1()     HAL_GPIO_WritePin(IIC_SCL_GPIO_Port,IIC_SCL_Pin,GPIO_PIN_SET);
-
-#define I2C_SDA_0()     HAL_GPIO_WritePin(IIC_SDA_GPIO_Port,IIC_SDA_Pin,GPIO_PIN_RESET);
-#define I2C_SDA_1()     HAL_GPIO_WritePin(IIC_SDA_GPIO_Port,IIC_SDA_Pin,GPIO_PIN_SET);
-
-#define I2C_SCL_READ()  HAL_GPIO_ReadPin(IIC_SCL_GPIO_Port,IIC_SCL_Pin)
-#define I2C_SDA_READ()  HAL_GPIO_ReadPin(IIC_SDA_GPIO_Port,IIC_SDA_Pin)
-
-
-#define I2C_WR	0		/* дbit */
-#define I2C_RD	1		/* bit */
-
-void iic_gpio_init(void);
-void i2c_Start(void);
-void i2c_Stop(void);
-void i2c_SendByte(uint8_t _ucByte);
-uint8_t i2c_ReadByte(uint8_t ack);
-uint8_t i2c_WaitAck(void);
-void i2c_Ack(void);
-void i2c_NAck(void);
-uint8_t i2c_CheckDevice(uint8_t _Address);
-
-
+#ifndef __IIC_H
+#define __IIC_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#define IIC_SCL_Pin GPIO_PIN_6
+#define IIC_SCL_GPIO_Port GPIOA
+#define IIC_SDA_Pin GPIO_PIN_7
+#define IIC_SDA_GPIO_Port GPIOA
+
+/* 定义IIC_MULTI_BUS时支持多组SCL/SDA引脚，由i2c_SelectBus()切换当前总线；
+   未定义时只有上面一组引脚，引脚为编译期常量，与单总线版本完全相同 */
+#if defined(APDS9930_HOST_SIM)
+#include "iic_sim.h"
+typedef iic_sim_port_t iic_port_t;
+#else
+typedef GPIO_TypeDef iic_port_t;
+#endif
+
+#ifdef IIC_MULTI_BUS
+
+typedef struct
+{
+	iic_port_t *port;		/* SCL与SDA所在端口 */
+	uint16_t scl;			/* SCL引脚 */
+	uint16_t sda;			/* SDA引脚 */
+} iic_bus_t;
+
+extern const iic_bus_t iic_bus_default;		/* IIC_SCL_Pin/IIC_SDA_Pin */
+extern const iic_bus_t *i2c_pBus;			/* 当前总线 */
+
+#define I2C_SCL_PORT	(i2c_pBus->port)
+#define I2C_SCL_PIN		(i2c_pBus->scl)
+#define I2C_SDA_PORT	(i2c_pBus->port)
+#define I2C_SDA_PIN		(i2c_pBus->sda)
+
+void i2c_SelectBus(const iic_bus_t *_pBus);
+
+#else
+
+#define I2C_SCL_PORT	IIC_SCL_GPIO_Port
+#define I2C_SCL_PIN		IIC_SCL_Pin
+#define I2C_SDA_PORT	IIC_SDA_GPIO_Port
+#define I2C_SDA_PIN		IIC_SDA_Pin
+
+#endif
+
+/* 定义IIC_PARALLEL时支持并行模式：多个同地址器件各占一条SDA，共用SCL（同一端口的一个或
+   多个引脚），每个边沿只写一次BSRR同时驱动所有SDA，每个数据位只读一次IDR采样所有SDA，
+   一个字节时间内收发N个字节 */
+#ifdef IIC_PARALLEL
+
+#ifndef IIC_PAR_MAX
+#define IIC_PAR_MAX		8
+#endif
+
+typedef struct
+{
+	iic_port_t *port;			/* SCL与所有SDA所在端口 */
+	uint16_t scl;				/* SCL引脚，可为多个 */
+	uint16_t sda_all;			/* 所有SDA引脚 */
+	uint8_t n;					/* 通道数 */
+	uint16_t sda[IIC_PAR_MAX];	/* 各通道SDA引脚 */
+} iic_par_t;
+
+#if defined(APDS9930_HOST_SIM)
+#define I2C_PAR_BSRR(p, v)	iic_sim_bsrr((p)->port, (v))
+#define I2C_PAR_IDR(p)		iic_sim_idr((p)->port)
+#else
+#define I2C_PAR_BSRR(p, v)	((p)->port->BSRR = (v))
+#define I2C_PAR_IDR(p)		((p)->port->IDR)
+#endif
+
+void i2c_ParInit(iic_par_t *_pPar, iic_port_t *_pPort, uint16_t _usScl, const uint16_t *_pusSda, uint8_t _ucN);
+void i2c_ParStart(const iic_par_t *_pPar);
+void i2c_ParStop(const iic_par_t *_pPar);
+void i2c_ParSendByte(const iic_par_t *_pPar, uint8_t _ucByte);
+void i2c_ParReadByte(const iic_par_t *_pPar, uint8_t *_pucBytes, uint8_t _ucStride, uint8_t ack);
+uint16_t i2c_ParWaitAck(const iic_par_t *_pPar);
+
+#endif
+
+/* 定义IIC_USE_HAL_GPIO时使用HAL库函数，否则直接操作BSRR/BRR/IDR寄存器，每个边沿只需一次写操作 */
+/* 定义APDS9930_HOST_SIM时在PC上运行，引脚操作交给iic_sim.c中的开漏总线模型 */
+#if defined(APDS9930_HOST_SIM)
+
+#define I2C_SCL_0()     iic_sim_brr(I2C_SCL_PORT,I2C_SCL_PIN);
+#define I2C_SCL_1()     iic_sim_bsrr(I2C_SCL_PORT,I2C_SCL_PIN);
+
+#define I2C_SDA_0()     iic_sim_brr(I2C_SDA_PORT,I2C_SDA_PIN);
+#define I2C_SDA_1()     iic_sim_bsrr(I2C_SDA_PORT,I2C_SDA_PIN);
+
+#define I2C_SCL_READ()  ((iic_sim_idr(I2C_SCL_PORT) & I2C_SCL_PIN) != 0)
+#define I2C_SDA_READ()  ((iic_sim_idr(I2C_SDA_PORT) & I2C_SDA_PIN) != 0)
+
+#elif defined(IIC_USE_HAL_GPIO)
+
+#define I2C_SCL_0()     HAL_GPIO_WritePin(I2C_SCL_PORT,I2C_SCL_PIN,GPIO_PIN_RESET);
+#define I2C_SCL_1()     HAL_GPIO_WritePin(I2C_SCL_PORT,I2C_SCL_PIN,GPIO_PIN_SET);
+
+#define I2C_SDA_0()     HAL_GPIO_WritePin(I2C_SDA_PORT,I2C_SDA_PIN,GPIO_PIN_RESET);
+#define I2C_SDA_1()     HAL_GPIO_WritePin(I2C_SDA_PORT,I2C_SDA_PIN,GPIO_PIN_SET);
+
+#define I2C_SCL_READ()  HAL_GPIO_ReadPin(I2C_SCL_PORT,I2C_SCL_PIN)
+#define I2C_SDA_READ()  HAL_GPIO_ReadPin(I2C_SDA_PORT,I2C_SDA_PIN)
+
+#else
+
+#define I2C_SCL_0()     (I2C_SCL_PORT->BRR = I2C_SCL_PIN);
+#define I2C_SCL_1()     (I2C_SCL_PORT->BSRR = I2C_SCL_PIN);
+
+#define I2C_SDA_0()     (I2C_SDA_PORT->BRR = I2C_SDA_PIN);
+#define I2C_SDA_1()     (I2C_SDA_PORT->BSRR = I2C_SDA_PIN);
+
+#define I2C_SCL_READ()  ((I2C_SCL_PORT->IDR & I2C_SCL_PIN) != 0)
+#define I2C_SDA_READ()  ((I2C_SDA_PORT->IDR & I2C_SDA_PIN) != 0)
+
+#endif
+
+
+/* 总线频率选择，1MHz(Fast-mode Plus)超出APDS-9930的400KHz规格，仅用于其它器件 */
+#define I2C_SPEED_100K		100000
+#define I2C_SPEED_400K		400000
+#define I2C_SPEED_1M		1000000
+
+/*
+	i2c_SetSpeed()接受的最高频率。实际上限还取决于SystemCoreClock和I2C_DELAY_OVERHEAD：
+	低电平半周期和高电平的延迟不能短于I2C_DELAY_OVERHEAD，32MHz时约为889KHz（开销12周期）
+	或266KHz（IIC_USE_HAL_GPIO，开销40周期），超出部分由i2c_SetSpeed()降频并返回1。
+*/
+#ifndef I2C_SPEED_MAX
+#define I2C_SPEED_MAX		I2C_SPEED_1M
+#endif
+
+#ifndef I2C_SPEED_DEFAULT
+#define I2C_SPEED_DEFAULT	I2C_SPEED_400K
+#endif
+
+/* 每次延迟调用本身及GPIO翻转消耗的CPU周期，从目标延迟中扣除 */
+#ifndef I2C_DELAY_OVERHEAD
+#if defined(APDS9930_HOST_SIM)
+#define I2C_DELAY_OVERHEAD	0
+#elif defined(IIC_USE_HAL_GPIO)
+#define I2C_DELAY_OVERHEAD	40
+#else
+#define I2C_DELAY_OVERHEAD	12
+#endif
+#endif
+
+/* 定义IIC_STATS时统计总线开销，未定义时统计宏为空，无任何开销 */
+#ifdef IIC_STATS
+
+typedef struct
+{
+	uint32_t starts;		/* 起始信号（含重复起始） */
+	uint32_t stops;			/* 停止信号 */
+	uint32_t bytes_tx;		/* 发送字节数 */
+	uint32_t bytes_rx;		/* 接收字节数 */
+	uint32_t nacks;			/* i2c_WaitAck()收到的NACK */
+	uint32_t scl_edges;		/* SCL翻转次数 */
+	uint32_t delay_cycles;	/* 位延迟请求的CPU周期总数 */
+} i2c_stats_t;
+
+extern i2c_stats_t i2c_stats;
+
+#define I2C_STAT_ADD(field, n)	(i2c_stats.field += (n))
+
+void i2c_ResetStats(void);
+
+#else
+
+#define I2C_STAT_ADD(field, n)	((void)0)
+
+#endif
+
+#define I2C_WR	0		/* 写控制bit */
+#define I2C_RD	1		/* 读控制bit */
+
+void iic_gpio_init(void);
+uint8_t i2c_SetSpeed(uint32_t _uiHz);
+uint32_t i2c_GetSpeed(void);
+void i2c_Start(void);
+void i2c_Stop(void);
+void i2c_SendByte(uint8_t _ucByte);
+uint8_t i2c_ReadByte(uint8_t ack);
+uint8_t i2c_WaitAck(void);
+void i2c_Ack(void);
+void i2c_NAck(void);
+uint8_t i2c_CheckDevice(uint8_t _Address);
+
+
 #endif
\ No newline at end of file
@@ -0,0 +1,367 @@
+#include "apds9930.h"
+
+/* Host-only: replaces the GPIO port and SysTick on a PC build */
+#ifdef APDS9930_HOST_SIM
+
+#include "iic_sim.h"
+
+/* Slave protocol states */
+enum {
+  IIC_SIM_IDLE,
+  IIC_SIM_ADDR,
+  IIC_SIM_ACK,
+  IIC_SIM_WRITE,
+  IIC_SIM_READ,
+  IIC_SIM_READ_ACK,
+  IIC_SIM_IGNORE
+};
+
+iic_sim_port_t iic_sim_gpioa = { 0xFFFF, 0xFFFF };
+iic_sim_stats_t iic_sim_stats;
+uint32_t SystemCoreClock = 32000000;
+
+static iic_sim_slave_t *iic_sim_slaves[IIC_SIM_MAX_SLAVES];
+static uint8_t iic_sim_slave_count;
+
+/**
+ * @brief       connect a bit-level slave to two pins of a port
+ * @param       slave   slave state, must outlive the simulation
+ * @param       dev   APDS-9930 model behind the slave
+ * @param       port   simulated port
+ * @param       scl   SCL pin mask
+ * @param       sda   SDA pin mask
+ * @return      NONE
+*/
+void iic_sim_attach(iic_sim_slave_t *slave, apds9930_sim_t *dev,
+                    iic_sim_port_t *port, uint16_t scl, uint16_t sda)
+{
+    slave->dev = dev;
+    slave->port = port;
+    slave->scl = scl;
+    slave->sda = sda;
+    slave->state = IIC_SIM_IDLE;
+    slave->shift = 0;
+    slave->bits = 0;
+    slave->first = 0;
+    slave->read = 0;
+    slave->nack = 0;
+    slave->drive_low = 0;
+    slave->last_scl = (port->idr & scl) != 0;
+    slave->last_sda = (port->idr & sda) != 0;
+    dev->bus_odr = &port->odr;
+    dev->bus_pins = scl | sda;
+
+    if(iic_sim_slave_count < IIC_SIM_MAX_SLAVES)
+        iic_sim_slaves[iic_sim_slave_count++] = slave;
+}
+
+/**
+ * @brief       load the next byte of a read and put its MSB on SDA
+ * @param       slave   slave
+ * @return      NONE
+*/
+static void iic_sim_loadByte(iic_sim_slave_t *slave)
+{
+    slave->shift = apds9930_sim_readByte(slave->dev);
+    slave->bits = 0;
+    slave->drive_low = !(slave->shift & 0x80);
+    slave->state = IIC_SIM_READ;
+}
+
+/**
+ * @brief       feed the current SCL/SDA levels to the slave state machine
+ * @param       slave   slave
+ * @param       scl   SCL level
+ * @param       sda   SDA level
+ * @return      NONE
+*/
+static void iic_sim_slaveStep(iic_sim_slave_t *slave, uint8_t scl, uint8_t sda)
+{
+    uint8_t rise = scl && !slave->last_scl;
+    uint8_t fall = !scl && slave->last_scl;
+
+    if(scl && slave->last_scl && sda != slave->last_sda)
+    {
+        if(!sda)
+        {
+            /* START, or repeated START inside a transfer */
+            if(slave->state == IIC_SIM_IDLE)
+            {
+                apds9930_sim_update(slave->dev);
+                slave->first = 1;
+            }
+            slave->state = IIC_SIM_ADDR;
+            slave->shift = 0;
+            slave->bits = 0;
+        }
+        else
+        {
+            slave->state = IIC_SIM_IDLE;
+        }
+        slave->drive_low = 0;
+    }
+    else if(rise)
+    {
+        if(slave->state == IIC_SIM_ADDR || slave->state == IIC_SIM_WRITE)
+        {
+            slave->shift = (uint8_t)((slave->shift << 1) | sda);
+            slave->bits++;
+        }
+        else if(slave->state == IIC_SIM_READ_ACK)
+        {
+            slave->nack = sda;
+        }
+    }
+    else if(fall)
+    {
+        switch(slave->state)
+        {
+        case IIC_SIM_ADDR:
+            if(slave->bits < 8)
+                break;
+            if((slave->shift >> 1) != slave->dev->address)
+            {
+                slave->state = IIC_SIM_IGNORE;
+                break;
+            }
+            if(slave->first)
+                slave->dev->transactions++;
+            slave->read = slave->shift & 0x01;
+            slave->first = slave->first && !slave->read;
+            slave->drive_low = 1;
+            slave->state = IIC_SIM_ACK;
+            break;
+
+        case IIC_SIM_WRITE:
+            if(slave->bits < 8)
+                break;
+            if(slave->first)
+            {
+                apds9930_sim_command(slave->dev, slave->shift);
+                slave->first = 0;
+            }
+            else
+            {
+                apds9930_sim_writeByte(slave->dev, slave->shift);
+            }
+            slave->drive_low = 1;
+            slave->state = IIC_SIM_ACK;
+            break;
+
+        case IIC_SIM_ACK:
+            /* End of our ACK clock: read transfers start sending here */
+            slave->drive_low = 0;
+            if(slave->read)
+            {
+                iic_sim_loadByte(slave);
+            }
+            else
+            {
+                slave->state = IIC_SIM_WRITE;
+                slave->shift = 0;
+                slave->bits = 0;
+            }
+            break;
+
+        case IIC_SIM_READ:
+            slave->bits++;
+            if(slave->bits < 8)
+            {
+                slave->drive_low = !(slave->shift & (0x80 >> slave->bits));
+            }
+            else
+            {
+                slave->drive_low = 0;
+                slave->state = IIC_SIM_READ_ACK;
+            }
+            break;
+
+        case IIC_SIM_READ_ACK:
+            if(slave->nack)
+                slave->state = IIC_SIM_IGNORE;
+            else
+                iic_sim_loadByte(slave);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    slave->last_scl = scl;
+    slave->last_sda = sda;
+}
+
+/**
+ * @brief       resolve the wired-AND bus levels of a port
+ * @param       port   simulated port
+ * @return      NONE
+*/
+static void iic_sim_resolve(iic_sim_port_t *port)
+{
+    uint16_t idr = port->odr;
+    uint8_t i;
+
+    for(i = 0; i < iic_sim_slave_count; i++)
+    {
+        if(iic_sim_slaves[i]->port == port && iic_sim_slaves[i]->drive_low)
+            idr &= ~iic_sim_slaves[i]->sda;
+    }
+
+    port->idr = idr;
+}
+
+/**
+ * @brief       record SCL timing and START/STOP counts for the first slave's pins
+ * @param       old_idr   levels before the change
+ * @param       new_idr   levels after the change
+ * @return      NONE
+*/
+static void iic_sim_record(uint16_t old_idr, uint16_t new_idr)
+{
+    iic_sim_stats_t *st = &iic_sim_stats;
+    uint64_t now = apds9930_sim_now();
+    uint64_t d;
+    uint16_t scl = iic_sim_slaves[0]->scl;
+    uint16_t sda = iic_sim_slaves[0]->sda;
+
+    if((old_idr & scl) && (new_idr & scl) && ((old_idr ^ new_idr) & sda))
+    {
+        if(new_idr & sda)
+            st->stops++;
+        else
+            st->starts++;
+        st->high_valid = 0;
+    }
+    else if(!(old_idr & scl) && (new_idr & scl))
+    {
+        st->scl_rises++;
+        d = now - st->last_fall_ns;
+        st->low_sum_ns += d;
+        st->low_count++;
+        if(st->low_min_ns == 0 || d < st->low_min_ns)
+            st->low_min_ns = d;
+        st->last_rise_ns = now;
+        st->high_valid = 1;
+    }
+    else if((old_idr & scl) && !(new_idr & scl))
+    {
+        if(st->high_valid)
+        {
+            d = now - st->last_rise_ns;
+            st->high_sum_ns += d;
+            st->high_count++;
+            if(st->high_min_ns == 0 || d < st->high_min_ns)
+                st->high_min_ns = d;
+        }
+        st->last_fall_ns = now;
+    }
+}
+
+/**
+ * @brief       deliver an output latch change to every slave on the port
+ * @param       port   simulated port
+ * @return      NONE
+*/
+static void iic_sim_apply(iic_sim_port_t *port)
+{
+    uint16_t old_idr = port->idr;
+    iic_sim_slave_t *slave;
+    uint8_t i;
+
+    iic_sim_resolve(port);
+    if(iic_sim_slave_count > 0 && iic_sim_slaves[0]->port == port)
+        iic_sim_record(old_idr, port->idr);
+
+    for(i = 0; i < iic_sim_slave_count; i++)
+    {
+        slave = iic_sim_slaves[i];
+        if(slave->port == port)
+            iic_sim_slaveStep(slave, (port->idr & slave->scl) != 0, (port->idr & slave->sda) != 0);
+    }
+
+    /* Slaves only change SDA while SCL is low, which is not an event */
+    iic_sim_resolve(port);
+    for(i = 0; i < iic_sim_slave_count; i++)
+    {
+        slave = iic_sim_slaves[i];
+        if(slave->port == port)
+            slave->last_sda = (port->idr & slave->sda) != 0;
+    }
+}
+
+/**
+ * @brief       host BSRR write: low half releases pins, high half pulls them low
+ * @param       port   simulated port
+ * @param       bsrr   BSRR value
+ * @return      NONE
+*/
+void iic_sim_bsrr(iic_sim_port_t *port, uint32_t bsrr)
+{
+    port->odr = (uint16_t)((port->odr & ~(bsrr >> 16)) | (bsrr & 0xFFFF));
+    iic_sim_apply(port);
+}
+
+/**
+ * @brief       host BRR write: pull pins low
+ * @param       port   simulated port
+ * @param       mask   pins
+ * @return      NONE
+*/
+void iic_sim_brr(iic_sim_port_t *port, uint16_t mask)
+{
+    port->odr &= ~mask;
+    iic_sim_apply(port);
+}
+
+/**
+ * @brief       host IDR read
+ * @param       port   simulated port
+ * @return      pin levels
+*/
+uint16_t iic_sim_idr(iic_sim_port_t *port)
+{
+    return port->idr;
+}
+
+/**
+ * @brief       CPU-cycle delay on the simulated clock
+ * @param       cycles   CPU cycles at SystemCoreClock
+ * @return      NONE
+*/
+void iic_sim_delayCycles(uint32_t cycles)
+{
+    apds9930_sim_advanceNs((uint64_t)cycles * 1000000000ULL / SystemCoreClock);
+}
+
+/**
+ * @brief       clear the edge timeline
+ * @param       NONE
+ * @return      NONE
+*/
+void iic_sim_resetStats(void)
+{
+    iic_sim_stats_t empty = {0};
+
+    iic_sim_stats = empty;
+}
+
+/**
+ * @brief       effective SCL frequency from the mean low and high times
+ * @param       NONE
+ * @return      frequency in Hz, 0 before any clock was seen
+*/
+uint32_t iic_sim_sclHz(void)
+{
+    const iic_sim_stats_t *st = &iic_sim_stats;
+    uint64_t period_ns;
+
+    if(st->low_count == 0 || st->high_count == 0)
+        return 0;
+
+    period_ns = st->low_sum_ns / st->low_count + st->high_sum_ns / st->high_count;
+
+    return period_ns ? (uint32_t)(1000000000ULL / period_ns) : 0;
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef __IIC_SIM_H
+#define __IIC_SIM_H
+
+#include <stdint.h>
+#include "apds9930_sim.h"
+
+/* Host stand-in for a 16-pin GPIO port with open-drain outputs */
+typedef struct {
+    uint16_t odr;               /* MCU output latch, 0 pulls the line low */
+    uint16_t idr;               /* wired-AND of the MCU and every attached slave */
+} iic_sim_port_t;
+
+extern iic_sim_port_t iic_sim_gpioa;
+extern uint32_t SystemCoreClock;
+
+#define GPIOA                   (&iic_sim_gpioa)
+
+#define GPIO_PIN_0              ((uint16_t)0x0001)
+#define GPIO_PIN_1              ((uint16_t)0x0002)
+#define GPIO_PIN_2              ((uint16_t)0x0004)
+#define GPIO_PIN_3              ((uint16_t)0x0008)
+#define GPIO_PIN_4              ((uint16_t)0x0010)
+#define GPIO_PIN_5              ((uint16_t)0x0020)
+#define GPIO_PIN_6              ((uint16_t)0x0040)
+#define GPIO_PIN_7              ((uint16_t)0x0080)
+#define GPIO_PIN_8              ((uint16_t)0x0100)
+#define GPIO_PIN_9              ((uint16_t)0x0200)
+#define GPIO_PIN_10             ((uint16_t)0x0400)
+#define GPIO_PIN_11             ((uint16_t)0x0800)
+#define GPIO_PIN_12             ((uint16_t)0x1000)
+#define GPIO_PIN_13             ((uint16_t)0x2000)
+#define GPIO_PIN_14             ((uint16_t)0x4000)
+#define GPIO_PIN_15             ((uint16_t)0x8000)
+
+/* Most slaves that can be attached across all ports */
+#ifndef IIC_SIM_MAX_SLAVES
+#define IIC_SIM_MAX_SLAVES      16
+#endif
+
+/* Bit-level I2C slave in front of one APDS-9930 model */
+typedef struct {
+    apds9930_sim_t *dev;
+    iic_sim_port_t *port;
+    uint16_t scl;               /* SCL pin mask */
+    uint16_t sda;               /* SDA pin mask */
+    uint8_t  state;             /* protocol state */
+    uint8_t  shift;             /* byte being received or sent */
+    uint8_t  bits;              /* bits clocked in the current byte */
+    uint8_t  first;             /* next written byte is the command byte */
+    uint8_t  read;              /* current transfer is a read */
+    uint8_t  nack;              /* master NACKed the last read byte */
+    uint8_t  drive_low;         /* slave pulls SDA low */
+    uint8_t  last_scl;
+    uint8_t  last_sda;
+} iic_sim_slave_t;
+
+/* Edge timeline of the SCL line of the first attached slave */
+typedef struct {
+    uint32_t starts;            /* START and repeated START conditions */
+    uint32_t stops;
+    uint32_t scl_rises;
+    uint64_t low_sum_ns;        /* total SCL low time inside transfers */
+    uint64_t high_sum_ns;       /* total SCL high time of data/ACK clocks */
+    uint32_t low_count;
+    uint32_t high_count;
+    uint64_t low_min_ns;
+    uint64_t high_min_ns;
+    uint64_t last_rise_ns;
+    uint64_t last_fall_ns;
+    uint8_t  high_valid;        /* no START/STOP since the last rising edge */
+} iic_sim_stats_t;
+
+extern iic_sim_stats_t iic_sim_stats;
+
+void iic_sim_attach(iic_sim_slave_t *slave, apds9930_sim_t *dev,
+                    iic_sim_port_t *port, uint16_t scl, uint16_t sda);
+void iic_sim_bsrr(iic_sim_port_t *port, uint32_t bsrr);
+void iic_sim_brr(iic_sim_port_t *port, uint16_t mask);
+uint16_t iic_sim_idr(iic_sim_port_t *port);
+void iic_sim_delayCycles(uint32_t cycles);
+void iic_sim_resetStats(void);
+uint32_t iic_sim_sclHz(void);
+
+#endif
@@ -0,0 +1,228 @@
+#include "iic_wave.h"
+
+/* BSRR words: the low half releases pins (open-drain high), the high half pulls them low */
+#define IIC_WAVE_HIGH(pin)      ((uint32_t)(pin))
+#define IIC_WAVE_LOW(pin)       ((uint32_t)(pin) << 16)
+
+/* Slot of a bit that is sampled: the SCL high slot, after the rise time */
+#define IIC_WAVE_SAMPLE         1
+
+/**
+ * @brief       START, or repeated START while SCL is low; from idle the first two slots are no-ops
+ * @param       out   next free slot
+ * @param       scl   SCL pin mask
+ * @param       sda   SDA pin mask
+ * @return      slot after the condition
+*/
+static uint32_t *iic_wave_start(uint32_t *out, uint16_t scl, uint16_t sda)
+{
+    *out++ = IIC_WAVE_HIGH(sda);
+    *out++ = IIC_WAVE_HIGH(scl);
+    *out++ = IIC_WAVE_LOW(sda);
+    *out++ = IIC_WAVE_LOW(scl);
+
+    return out;
+}
+
+/**
+ * @brief       STOP, entered with SCL low
+ * @param       out   next free slot
+ * @param       scl   SCL pin mask
+ * @param       sda   SDA pin mask
+ * @return      slot after the condition
+*/
+static uint32_t *iic_wave_stop(uint32_t *out, uint16_t scl, uint16_t sda)
+{
+    *out++ = IIC_WAVE_LOW(sda);
+    *out++ = IIC_WAVE_HIGH(scl);
+    *out++ = IIC_WAVE_HIGH(sda);
+
+    return out;
+}
+
+/**
+ * @brief       one clock with SDA set up a slot before SCL rises
+ * @param       out   next free slot
+ * @param       scl   SCL pin mask
+ * @param       sda   SDA pin mask
+ * @param       bit   0 pulls SDA low, 1 releases it
+ * @return      slot after the bit
+*/
+static uint32_t *iic_wave_bit(uint32_t *out, uint16_t scl, uint16_t sda, uint8_t bit)
+{
+    *out++ = bit ? IIC_WAVE_HIGH(sda) : IIC_WAVE_LOW(sda);
+    *out++ = IIC_WAVE_HIGH(scl);
+    *out++ = IIC_WAVE_LOW(scl);
+
+    return out;
+}
+
+/**
+ * @brief       eight data bits MSB first followed by the ACK bit
+ * @param       out   next free slot
+ * @param       scl   SCL pin mask
+ * @param       sda   SDA pin mask
+ * @param       byte   data, 0xFF releases SDA so the slave can drive it
+ * @param       ack   ACK bit level, 1 releases SDA for the slave's ACK
+ * @return      slot after the byte
+*/
+static uint32_t *iic_wave_byte(uint32_t *out, uint16_t scl, uint16_t sda, uint8_t byte, uint8_t ack)
+{
+    uint8_t i;
+
+    for(i = 0; i < 8; i++)
+    {
+        out = iic_wave_bit(out, scl, sda, (byte << i) & 0x80);
+    }
+
+    return iic_wave_bit(out, scl, sda, ack);
+}
+
+/**
+ * @brief       compile a register read: command byte, repeated START, len bytes
+ * @param       out   IIC_WAVE_READ_SLOTS(len) BSRR words
+ * @param       scl   SCL pin mask
+ * @param       sda   SDA pin mask, on the same port as SCL
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @param       len   number of bytes to read, ACKed but the last
+ * @return      number of slots written
+*/
+uint16_t iic_wave_compileRead(uint32_t *out, uint16_t scl, uint16_t sda,
+                              uint8_t addr, uint8_t cmd, uint8_t len)
+{
+    uint32_t *p = out;
+    uint8_t i;
+
+    p = iic_wave_start(p, scl, sda);
+    p = iic_wave_byte(p, scl, sda, (addr << 1) & (0xFE), 1);
+    p = iic_wave_byte(p, scl, sda, cmd, 1);
+
+    p = iic_wave_start(p, scl, sda);
+    p = iic_wave_byte(p, scl, sda, (addr << 1) | (0x01), 1);
+
+    for(i = 0; i < len; i++)
+    {
+        p = iic_wave_byte(p, scl, sda, 0xFF, i == (len - 1));
+    }
+
+    p = iic_wave_stop(p, scl, sda);
+
+    return (uint16_t)(p - out);
+}
+
+/**
+ * @brief       compile a register write: command byte followed by len data bytes
+ * @param       out   IIC_WAVE_WRITE_SLOTS(len) BSRR words
+ * @param       scl   SCL pin mask
+ * @param       sda   SDA pin mask, on the same port as SCL
+ * @param       addr   7-bit device address
+ * @param       cmd   command byte
+ * @param       buf   data to write
+ * @param       len   number of bytes to write
+ * @return      number of slots written
+*/
+uint16_t iic_wave_compileWrite(uint32_t *out, uint16_t scl, uint16_t sda,
+                               uint8_t addr, uint8_t cmd, const uint8_t *buf, uint8_t len)
+{
+    uint32_t *p = out;
+    uint8_t i;
+
+    p = iic_wave_start(p, scl, sda);
+    p = iic_wave_byte(p, scl, sda, (addr << 1) & (0xFE), 1);
+    p = iic_wave_byte(p, scl, sda, cmd, 1);
+
+    for(i = 0; i < len; i++)
+    {
+        p = iic_wave_byte(p, scl, sda, buf[i], 1);
+    }
+
+    p = iic_wave_stop(p, scl, sda);
+
+    return (uint16_t)(p - out);
+}
+
+/**
+ * @brief       assemble the eight data bits of a captured byte
+ * @param       in   IDR captures of the byte's first slot onwards
+ * @param       sda   SDA pin mask
+ * @return      byte on SDA
+*/
+static uint8_t iic_wave_getByte(const uint16_t *in, uint16_t sda)
+{
+    uint8_t value = 0;
+    uint8_t i;
+
+    for(i = 0; i < 8; i++)
+    {
+        value <<= 1;
+        if(in[i * IIC_WAVE_SLOTS_BIT + IIC_WAVE_SAMPLE] & sda)
+            value++;
+    }
+
+    return value;
+}
+
+/**
+ * @brief       level of the ACK bit of a captured byte
+ * @param       in   IDR captures of the byte's first slot onwards
+ * @param       sda   SDA pin mask
+ * @return      0 = ACK, 1 = NACK
+*/
+static uint8_t iic_wave_getAck(const uint16_t *in, uint16_t sda)
+{
+    return (in[8 * IIC_WAVE_SLOTS_BIT + IIC_WAVE_SAMPLE] & sda) != 0;
+}
+
+/**
+ * @brief       extract the data and ACK bits of a played iic_wave_compileRead() waveform
+ * @param       in   IDR captures, one per slot
+ * @param       sda   SDA pin mask
+ * @param       buf   receive buffer
+ * @param       len   len the waveform was compiled with
+ * @return      0 if every address/command byte was ACKed
+*/
+uint8_t iic_wave_decodeRead(const uint16_t *in, uint16_t sda, uint8_t *buf, uint8_t len)
+{
+    uint8_t nack;
+    uint8_t i;
+
+    in += IIC_WAVE_SLOTS_START;
+    nack = iic_wave_getAck(in, sda);
+    in += IIC_WAVE_SLOTS_BYTE;
+    nack |= iic_wave_getAck(in, sda);
+    in += IIC_WAVE_SLOTS_BYTE + IIC_WAVE_SLOTS_START;
+    nack |= iic_wave_getAck(in, sda);
+    in += IIC_WAVE_SLOTS_BYTE;
+
+    for(i = 0; i < len; i++)
+    {
+        buf[i] = iic_wave_getByte(in, sda);
+        in += IIC_WAVE_SLOTS_BYTE;
+    }
+
+    return nack;
+}
+
+/**
+ * @brief       extract the ACK bits of a played iic_wave_compileWrite() waveform
+ * @param       in   IDR captures, one per slot
+ * @param       sda   SDA pin mask
+ * @param       len   len the waveform was compiled with
+ * @return      0 if every byte was ACKed
+*/
+uint8_t iic_wave_decodeWrite(const uint16_t *in, uint16_t sda, uint8_t len)
+{
+    uint8_t nack = 0;
+    uint8_t i;
+
+    in += IIC_WAVE_SLOTS_START;
+
+    for(i = 0; i < len + 2; i++)
+    {
+        nack |= iic_wave_getAck(in, sda);
+        in += IIC_WAVE_SLOTS_BYTE;
+    }
+
+    return nack;
+}
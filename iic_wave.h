@@ -0,0 +1,35 @@
+#ifndef __IIC_WAVE_H
+#define __IIC_WAVE_H
+
+#include <stdint.h>
+
+/*
+ * I2C transactions compiled into GPIO BSRR words, one word per slot, for a
+ * timer-paced DMA to play to the port while a second stream captures IDR
+ * once per slot (in[k] is sampled half a slot after out[k] hit the pins).
+ * Every bit takes three slots: SDA, SCL high, SCL low, which gives the
+ * 1:2 high/low ratio the spec asks for in Fast-mode, so the slot rate is
+ * three times the SCL frequency. SDA only ever changes a slot after SCL
+ * fell. The layout depends on len alone, so the decoder needs no map.
+ * Pure code: no HAL, no globals, builds and runs on a PC as is.
+ */
+
+#define IIC_WAVE_SLOTS_BIT      3
+#define IIC_WAVE_SLOTS_BYTE     (9 * IIC_WAVE_SLOTS_BIT)   /* 8 data bits and the ACK bit */
+#define IIC_WAVE_SLOTS_START    4
+#define IIC_WAVE_SLOTS_STOP     3
+
+/* Slots of a register read: START, addr+W, cmd, repeated START, addr+R, len bytes, STOP */
+#define IIC_WAVE_READ_SLOTS(len)    (2 * IIC_WAVE_SLOTS_START + (3 + (len)) * IIC_WAVE_SLOTS_BYTE + IIC_WAVE_SLOTS_STOP)
+
+/* Slots of a register write: START, addr+W, cmd, len bytes, STOP */
+#define IIC_WAVE_WRITE_SLOTS(len)   (IIC_WAVE_SLOTS_START + (2 + (len)) * IIC_WAVE_SLOTS_BYTE + IIC_WAVE_SLOTS_STOP)
+
+uint16_t iic_wave_compileRead(uint32_t *out, uint16_t scl, uint16_t sda,
+                              uint8_t addr, uint8_t cmd, uint8_t len);
+uint16_t iic_wave_compileWrite(uint32_t *out, uint16_t scl, uint16_t sda,
+                               uint8_t addr, uint8_t cmd, const uint8_t *buf, uint8_t len);
+uint8_t iic_wave_decodeRead(const uint16_t *in, uint16_t sda, uint8_t *buf, uint8_t len);
+uint8_t iic_wave_decodeWrite(const uint16_t *in, uint16_t sda, uint8_t len);
+
+#endif
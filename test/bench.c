@@ -0,0 +1,114 @@
+#include "apds9930.h"
+#include "iic.h"
+
+/* Allowed excess of the simulated time per call */
+#define BENCH_SIM_TOLERANCE_PCT 2
+
+static iic_sim_slave_t slave;
+
+/*
+ * Per-call cost of bench_workload() at the default configuration on the
+ * bit-level simulator: CSV totals divided by calls, sim_ns rounded up.
+ * Byte counts include the address bytes. waitReady depends on how often
+ * STATUS is polled and is left unchecked. Update an entry in the same
+ * commit that changes its cost.
+ */
+static const apds9930_prof_t bench_baseline[APDS9930_PROF_COUNT] = {
+    [APDS9930_PROF_INIT]                 = { 1, { .starts = 3, .stops = 3, .bytes_tx = 21, .bytes_rx = 13 }, .sim_ns = 785250 },
+    [APDS9930_PROF_SET_MODE]             = { 1, { .starts = 1, .stops = 1, .bytes_tx = 3 }, .sim_ns = 18563 },
+    [APDS9930_PROF_READ_SAMPLE]          = { 1, { .starts = 2, .stops = 1, .bytes_tx = 3, .bytes_rx = 7 }, .sim_ns = 235250 },
+    [APDS9930_PROF_READ_CH0]             = { 1, { .starts = 2, .stops = 1, .bytes_tx = 3, .bytes_rx = 2 }, .sim_ns = 122750 },
+    [APDS9930_PROF_READ_CH1]             = { 1, { .starts = 2, .stops = 1, .bytes_tx = 3, .bytes_rx = 2 }, .sim_ns = 122750 },
+    [APDS9930_PROF_READ_PROXIMITY]       = { 1, { .starts = 2, .stops = 1, .bytes_tx = 3, .bytes_rx = 2 }, .sim_ns = 122750 },
+    [APDS9930_PROF_READ_LUX]             = { 1, { .starts = 2, .stops = 1, .bytes_tx = 3, .bytes_rx = 7 }, .sim_ns = 235250 },
+    [APDS9930_PROF_SET_LIGHT_THRESHOLD]  = { 1, { .starts = 1, .stops = 1, .bytes_tx = 4 }, .sim_ns = 96750 },
+    [APDS9930_PROF_SET_LIGHT_WINDOW]     = { 1, { .starts = 1, .stops = 1, .bytes_tx = 6 }, .sim_ns = 141750 },
+    [APDS9930_PROF_SET_PROX_THRESHOLD]   = { 1, { .starts = 1, .stops = 1, .bytes_tx = 4 }, .sim_ns = 96750 },
+    [APDS9930_PROF_SET_PROX_WINDOW]      = { 1, { .starts = 1, .stops = 1, .bytes_tx = 6 }, .sim_ns = 141750 },
+    [APDS9930_PROF_SET_PROX_INT_ENABLE]  = { 1, { .starts = 1, .stops = 1, .bytes_tx = 3 }, .sim_ns = 74250 },
+    [APDS9930_PROF_SET_CONTROL]          = { 1, { .starts = 1, .stops = 1, .bytes_tx = 3 }, .sim_ns = 59400 },
+    [APDS9930_PROF_SET_LIGHT_INT_ENABLE] = { 1, { .starts = 1, .stops = 1, .bytes_tx = 3 }, .sim_ns = 37125 },
+    [APDS9930_PROF_ENABLE_LIGHT]         = { 1, { .starts = 1, .stops = 1, .bytes_tx = 3 }, .sim_ns = 74250 },
+    [APDS9930_PROF_DISABLE_LIGHT]        = { 1, { .starts = 1, .stops = 1, .bytes_tx = 3 }, .sim_ns = 74250 },
+    [APDS9930_PROF_CLEAR_INT]            = { 1, { .starts = 1, .stops = 1, .bytes_tx = 2 }, .sim_ns = 51750 },
+    [APDS9930_PROF_RESYNC]               = { 1, { .starts = 4, .stops = 2, .bytes_tx = 6, .bytes_rx = 17 }, .sim_ns = 538000 },
+    [APDS9930_PROF_VERIFY]               = { 1, { .starts = 4, .stops = 2, .bytes_tx = 6, .bytes_rx = 17 }, .sim_ns = 538000 },
+};
+
+/*
+ * Per-call cost benchmark. Runs every profiled API on the bit-level
+ * simulator, prints the CSV report and exits non-zero if any bus counter
+ * is above bench_baseline, the simulated time is more than
+ * BENCH_SIM_TOLERANCE_PCT above it, or a baselined API was not exercised.
+ * The simulator is deterministic, so the report is reproducible.
+ */
+static void bench_workload(void)
+{
+    apds9930_sample_t sample;
+    uint8_t i;
+
+    apds9930_init();
+    apds9930_sim_setScene(&apds9930_sim_default, 256 * 20, 256 * 4, 77);
+
+    apds9930_enableLightSensor(false);
+    apds9930_waitReady(APDS9930_AVALID, 100);
+    for(i = 0; i < 10; i++)
+    {
+        apds9930_readSample(&sample);
+        apds9930_readAmbientLightMilliLux();
+    }
+    apds9930_readCh0Light();
+    apds9930_readCh1Light();
+
+    apds9930_setLightIntLowThreshold(10);
+    apds9930_setLightIntHighThreshold(1000);
+    apds9930_setLightIntWindow(20, 2000);
+    apds9930_setAmbientLightIntEnable(1);
+    apds9930_clearAmbientLightInt();
+    apds9930_setAmbientLightIntEnable(0);
+    apds9930_disableLightSensor();
+
+    apds9930_setMode(PROXIMITY, 1);
+    apds9930_setLEDDriver(LED_DRIVE_50MA);
+    apds9930_setProximityGain(PGAIN_2X);
+    apds9930_setProximityDiode(DEFAULT_PDIODE);
+    apds9930_setAmbientLightGain(AGAIN_8X);
+    apds9930_waitReady(APDS9930_PVALID, 100);
+    apds9930_readProximity();
+    apds9930_setProximityIntLowThreshold(100);
+    apds9930_setProximityIntHighThreshold(500);
+    apds9930_setProximityIntWindow(200, 600);
+    apds9930_setProximityIntEnable(1);
+    apds9930_clearProximityInt();
+    apds9930_clearAllInts();
+    apds9930_setProximityIntEnable(0);
+
+    apds9930_resync();
+    apds9930_verify();
+}
+
+int main(void)
+{
+    uint8_t failed;
+    uint8_t i;
+
+    apds9930_sim_reset(&apds9930_sim_default);
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+    apds9930_profReset();
+
+    bench_workload();
+
+    apds9930_profPrint(APDS9930_PROF_CSV);
+    failed = apds9930_profCompare(bench_baseline, BENCH_SIM_TOLERANCE_PCT);
+    for(i = 0; i < APDS9930_PROF_COUNT; i++)
+    {
+        if(bench_baseline[i].calls && !apds9930_prof[i].calls)
+        {
+            printf("NOT RUN %s\r\n", apds9930_profName(i));
+            failed++;
+        }
+    }
+
+    printf("%u regressions\r\n", failed);
+    return failed != 0;
+}
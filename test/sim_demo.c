@@ -0,0 +1,53 @@
+#include "apds9930.h"
+
+#ifndef APDS9930_DEFAULT_BUS
+#include "iic.h"
+
+static iic_sim_slave_t slave;
+#endif
+
+/*
+ * Host demo: init, one ALS conversion, a sample and its lux on the
+ * simulated sensor. Built with APDS9930_DEFAULT_BUS=apds9930_bus_sim it
+ * runs on the register-level model, otherwise every transfer is
+ * bit-banged through iic.c and the GPIO port model.
+ */
+int main(void)
+{
+    apds9930_sample_t sample;
+    uint64_t start;
+
+    apds9930_sim_reset(&apds9930_sim_default);
+#ifndef APDS9930_DEFAULT_BUS
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+#endif
+
+    if(apds9930_init() == ERROR)
+    {
+        printf("init: bad ID\r\n");
+        return 1;
+    }
+    printf("init: %lu transactions, %llu us\r\n", (unsigned long)apds9930_sim_default.transactions,
+           (unsigned long long)(apds9930_sim_now() / 1000));
+
+    /* 20 counts per step on Ch0, 4 on Ch1, prox 77 */
+    apds9930_sim_setScene(&apds9930_sim_default, 256 * 20, 256 * 4, 77);
+    apds9930_enableLightSensor(false);
+    if(!apds9930_waitReady(APDS9930_AVALID, 100))
+    {
+        printf("ALS not ready\r\n");
+        return 1;
+    }
+
+    start = apds9930_sim_now();
+    apds9930_readSample(&sample);
+    printf("sample: status 0x%02x ch0 %u ch1 %u prox %u, %llu ns\r\n", sample.status, sample.ch0,
+           sample.ch1, sample.proximity, (unsigned long long)(apds9930_sim_now() - start));
+    printf("lux: %lu mlux\r\n", (unsigned long)apds9930_readAmbientLightMilliLux());
+
+#ifndef APDS9930_DEFAULT_BUS
+    printf("SCL: %lu Hz\r\n", (unsigned long)iic_sim_sclHz());
+#endif
+
+    return !(sample.status & APDS9930_AVALID) || sample.ch0 == 0;
+}
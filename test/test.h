@@ -0,0 +1,23 @@
+#ifndef __TEST_H
+#define __TEST_H
+
+#include <stdio.h>
+
+/*
+ * Host test helpers. CHECK() reports a failed condition and keeps going,
+ * TEST_RESULT() is main()'s exit status.
+ */
+static unsigned test_failures;
+
+#define CHECK(cond) \
+    do { \
+        if(!(cond)) \
+        { \
+            printf("%s:%d: CHECK(%s) failed\r\n", __FILE__, __LINE__, #cond); \
+            test_failures++; \
+        } \
+    } while(0)
+
+#define TEST_RESULT()   (printf("%s: %s\r\n", __FILE__, test_failures ? "FAIL" : "OK"), test_failures != 0)
+
+#endif
@@ -0,0 +1,171 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+/*
+ * Non-blocking init, sample and window writes (APDS9930_ASYNC). The loop
+ * stands in for a cooperative main loop: 50 us of other work between
+ * steps, the longest single step is what the slice has to bound.
+ */
+static iic_sim_slave_t slave;
+static uint32_t done_calls;
+static uint64_t step_max_ns;
+static uint32_t steps;
+
+static void done(apds9930_async_t *op)
+{
+    (void)op;
+    done_calls++;
+}
+
+static uint8_t run(apds9930_async_t *op)
+{
+    uint64_t start;
+    uint8_t status;
+
+    step_max_ns = 0;
+    steps = 0;
+    do
+    {
+        start = apds9930_sim_now();
+        status = apds9930_async_step(op);
+        if(apds9930_sim_now() - start > step_max_ns)
+            step_max_ns = apds9930_sim_now() - start;
+        steps++;
+        apds9930_sim_advanceNs(50000);
+    } while(status == APDS9930_ASYNC_BUSY && steps < 100000);
+
+    return status;
+}
+
+static void test_init(void)
+{
+    apds9930_async_t op;
+
+    apds9930_async_init(&op, &apds9930_dev_default, 0, done);
+    CHECK(run(&op) == APDS9930_ASYNC_DONE);
+    printf("init: %lu steps, longest %llu ns\r\n", (unsigned long)steps, (unsigned long long)step_max_ns);
+    CHECK(step_max_ns <= APDS9930_ASYNC_SLICE_US * 1000);
+    CHECK(done_calls == 1);
+    CHECK(apds9930_verify());
+    CHECK((int32_t)(HAL_GetTick() - apds9930_getReadyTick()) >= 0);
+}
+
+static void test_sample(void)
+{
+    apds9930_async_t op;
+    apds9930_sample_t blocking;
+    apds9930_sample_t s;
+
+    apds9930_readSample(&blocking);
+    apds9930_async_readSample(&op, &apds9930_dev_default, &s, done);
+    CHECK(run(&op) == APDS9930_ASYNC_DONE);
+    CHECK(step_max_ns <= APDS9930_ASYNC_SLICE_US * 1000);
+    CHECK(done_calls == 2);
+    CHECK(s.status == blocking.status && s.ch0 == blocking.ch0 && s.ch1 == blocking.ch1
+          && s.proximity == blocking.proximity);
+    CHECK(s.ch0 == 1234 && s.ch1 == 321 && s.proximity == 42);
+
+    /* a byte is about 95 us at 100 kHz, still one phase per step */
+    i2c_SetSpeed(I2C_SPEED_100K);
+    apds9930_async_readSample(&op, &apds9930_dev_default, &s, 0);
+    CHECK(run(&op) == APDS9930_ASYNC_DONE);
+    CHECK(step_max_ns <= APDS9930_ASYNC_SLICE_US * 1000);
+    CHECK(s.ch0 == 1234);
+    i2c_SetSpeed(I2C_SPEED_400K);
+}
+
+static void test_window(void)
+{
+    apds9930_async_t op;
+
+    /* 30 us slice: start, address, command, four bytes, stop in six calls */
+    apds9930_async_setLightIntWindow(&op, &apds9930_dev_default, 0x1234, 0xBEEF, done);
+    op.slice_us = 30;
+    CHECK(run(&op) == APDS9930_ASYNC_DONE);
+    printf("window: %lu steps, longest %llu ns\r\n", (unsigned long)steps, (unsigned long long)step_max_ns);
+    CHECK(step_max_ns <= 30000);
+    CHECK(steps == 6);
+    CHECK(apds9930_sim_default.regs[APDS9930_AILTL] == 0x34);
+    CHECK(apds9930_sim_default.regs[APDS9930_AIHTH] == 0xBE);
+    CHECK(apds9930_getLightIntLowThreshold() == 0x1234);
+    CHECK(apds9930_getLightIntHighThreshold() == 0xBEEF);
+}
+
+static void test_errors(void)
+{
+    apds9930_dev_t ghost = APDS9930_DEV_INIT(&apds9930_bus_iic, 0x29);
+    apds9930_async_t op;
+    apds9930_sample_t s;
+
+    apds9930_async_readSample(&op, &ghost, &s, 0);
+    CHECK(run(&op) == APDS9930_ASYNC_NACK);
+    apds9930_async_init(&op, &ghost, 0, 0);
+    CHECK(run(&op) == APDS9930_ASYNC_NACK);
+
+    /* wrong part, nothing may be written */
+    apds9930_sim_default.regs[APDS9930_ID] = 0x55;
+    apds9930_sim_default.regs[APDS9930_ATIME] = 0x55;
+    apds9930_async_init(&op, &apds9930_dev_default, 0, 0);
+    CHECK(run(&op) == APDS9930_ASYNC_BAD_ID);
+    CHECK(apds9930_sim_default.regs[APDS9930_ATIME] == 0x55);
+    apds9930_sim_default.regs[APDS9930_ID] = APDS9930_ID_1;
+}
+
+static void test_sim_bus(void)
+{
+    apds9930_sim_t sim;
+    apds9930_bus_t bus = apds9930_bus_sim;
+    apds9930_dev_t dev;
+    apds9930_async_t op;
+    apds9930_sample_t s;
+
+    apds9930_sim_reset(&sim);
+    apds9930_sim_setData(&sim, 7, 8, 9);
+    bus.ctx = &sim;
+    dev = (apds9930_dev_t)APDS9930_DEV_INIT(&bus, APDS9930_I2C_ADDR);
+
+    apds9930_async_init(&op, &dev, 0, 0);
+    CHECK(run(&op) == APDS9930_ASYNC_DONE);
+    apds9930_async_readSample(&op, &dev, &s, 0);
+    CHECK(run(&op) == APDS9930_ASYNC_DONE);
+    CHECK(s.ch0 == 7 && s.ch1 == 8 && s.proximity == 9);
+    CHECK(apds9930_dev_verify(&dev));
+}
+
+static void test_enabled_image(void)
+{
+    apds9930_regs_t img;
+    apds9930_async_t op;
+    uint8_t i;
+
+    for(i = 0; i <= APDS9930_CONTROL; i++)
+        img.reg[i] = apds9930_sim_default.regs[i];
+    img.reg[APDS9930_ENABLE] = APDS9930_PON | APDS9930_AEN;
+    img.poffset = 0x10;
+
+    /* done only once the first conversion is due */
+    apds9930_async_init(&op, &apds9930_dev_default, &img, 0);
+    CHECK(run(&op) == APDS9930_ASYNC_DONE);
+    CHECK(step_max_ns <= APDS9930_ASYNC_SLICE_US * 1000);
+    CHECK((int32_t)(HAL_GetTick() - apds9930_getReadyTick()) >= 0);
+    CHECK(apds9930_sim_default.regs[APDS9930_POFFSET] == 0x10);
+    CHECK(apds9930_sim_default.regs[APDS9930_ENABLE] == (APDS9930_PON | APDS9930_AEN));
+}
+
+int main(void)
+{
+    apds9930_sim_reset(&apds9930_sim_default);
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+    apds9930_sim_setData(&apds9930_sim_default, 1234, 321, 42);
+    apds9930_sim_default.regs[APDS9930_POFFSET] = 0x55;
+
+    test_init();
+    test_sample();
+    test_window();
+    test_errors();
+    test_sim_bus();
+    test_enabled_image();
+
+    return TEST_RESULT();
+}
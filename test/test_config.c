@@ -0,0 +1,180 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+/*
+ * Configuration batches on the bit-level bus: what commitConfig() writes,
+ * in which order and in how many transactions, read back from the write
+ * log of the model.
+ */
+static iic_sim_slave_t slave;
+static apds9930_sim_write_t writes[APDS9930_SIM_LOG_SIZE];
+
+/* Restart the write log and the transaction count */
+static void mark(void)
+{
+    apds9930_sim_default.log_count = 0;
+    apds9930_sim_default.transactions = 0;
+}
+
+/* Copy the logged data writes, reads and special functions left out */
+static uint32_t collect(void)
+{
+    const apds9930_sim_t *sim = &apds9930_sim_default;
+    uint32_t n = 0;
+    uint32_t i;
+
+    CHECK(sim->log_count <= APDS9930_SIM_LOG_SIZE);
+    for(i = 0; i < sim->log_count && i < APDS9930_SIM_LOG_SIZE; i++)
+    {
+        if(sim->log[i].len != 0)
+            writes[n++] = sim->log[i];
+    }
+
+    return n;
+}
+
+/* Registers one apart and COALESCE_GAP apart share a block, one further does not */
+static void test_coalesce(void)
+{
+    const uint8_t first = APDS9930_ATIME;
+    const uint8_t near = first + APDS9930_COALESCE_GAP + 1;
+    const uint8_t far = first + APDS9930_COALESCE_GAP + 2;
+    uint8_t atime = apds9930_readRegData(APDS9930_ATIME);
+
+    /* adjacent: the light window and PILT in one block */
+    mark();
+    apds9930_beginConfig();
+    apds9930_setLightIntWindow(100, 2000);
+    apds9930_setProximityIntLowThreshold(10);
+    apds9930_commitConfig();
+    CHECK(collect() == 1);
+    CHECK(writes[0].cmd == (AUTO_INCREMENT | APDS9930_AILTL) && writes[0].len == 5);
+    CHECK(apds9930_sim_default.transactions == 1);
+    CHECK(apds9930_getLightIntHighThreshold() == 2000);
+    CHECK(apds9930_sim_default.regs[APDS9930_PILTL] == 10);
+
+    /* COALESCE_GAP unchanged registers in between are rewritten from the shadow */
+    mark();
+    apds9930_beginConfig();
+    apds9930_WriteRegData(first, atime - 1);
+    apds9930_WriteRegData(near, apds9930_sim_default.regs[near] + 1);
+    apds9930_commitConfig();
+    CHECK(collect() == 1);
+    CHECK(writes[0].cmd == (AUTO_INCREMENT | first) && writes[0].len == APDS9930_COALESCE_GAP + 2);
+    CHECK(apds9930_sim_default.regs[first] == (uint8_t)(atime - 1));
+    CHECK(apds9930_verify());
+
+    /* one more and they split */
+    mark();
+    apds9930_beginConfig();
+    apds9930_WriteRegData(first, atime);
+    apds9930_WriteRegData(far, apds9930_sim_default.regs[far] + 1);
+    apds9930_commitConfig();
+    CHECK(collect() == 2);
+    CHECK(writes[0].cmd == (AUTO_INCREMENT | first) && writes[0].len == 1);
+    CHECK(writes[1].cmd == (AUTO_INCREMENT | far) && writes[1].len == 1);
+    CHECK(apds9930_sim_default.transactions == 2);
+    CHECK(apds9930_verify());
+}
+
+/* POFFSET goes out on its own after the 0x01-0x0F blocks, ENABLE last */
+static void test_order(void)
+{
+    uint8_t enable;
+
+    apds9930_setMode(ALL, 0);
+
+    mark();
+    apds9930_beginConfig();
+    apds9930_enablePower();
+    apds9930_setMode(AMBIENT_LIGHT, 1);
+    apds9930_WriteRegData(APDS9930_POFFSET, 0x85);
+    apds9930_setAmbientLightGain(AGAIN_16X);
+    apds9930_WriteRegData(APDS9930_ATIME, 0xDB);
+    enable = apds9930_getMode();
+    /* nothing reaches the device while the batch is open */
+    CHECK(apds9930_sim_default.transactions == 0);
+    apds9930_commitConfig();
+
+    CHECK(collect() == 4);
+    CHECK(writes[0].cmd == (AUTO_INCREMENT | APDS9930_ATIME) && writes[0].len == 1);
+    CHECK(writes[1].cmd == (AUTO_INCREMENT | APDS9930_CONTROL) && writes[1].len == 1);
+    CHECK(writes[2].cmd == (REPEATED_BYTE | APDS9930_POFFSET) && writes[2].len == 1);
+    CHECK(writes[3].cmd == (REPEATED_BYTE | APDS9930_ENABLE) && writes[3].len == 1);
+    CHECK(apds9930_sim_default.regs[APDS9930_ENABLE] == enable);
+    CHECK(apds9930_sim_default.regs[APDS9930_POFFSET] == 0x85);
+    CHECK(apds9930_verify());
+}
+
+/* Scene change: gain, LED, diode, ATIME, PPULSE, both windows and ENABLE */
+static void scene(uint8_t again, uint8_t atime, uint8_t ppulse, uint16_t low, uint8_t prox)
+{
+    apds9930_setAmbientLightGain(again);
+    apds9930_setLEDDriver(LED_DRIVE_50MA);
+    apds9930_setProximityDiode(DEFAULT_PDIODE);
+    apds9930_WriteRegData(APDS9930_ATIME, atime);
+    apds9930_WriteRegData(APDS9930_PPULSE, ppulse);
+    apds9930_setLightIntWindow(low, 2000);
+    apds9930_setProximityIntWindow(low / 10, low * 2);
+    apds9930_setMode(PROXIMITY, prox);
+}
+
+static void test_scene(void)
+{
+    uint32_t unbatched;
+
+    mark();
+    scene(AGAIN_8X, 0xDB, 4, 100, 1);
+    unbatched = apds9930_sim_default.transactions;
+
+    mark();
+    apds9930_beginConfig();
+    scene(AGAIN_1X, 0xF6, 8, 300, 0);
+    apds9930_commitConfig();
+    printf("scene change: %lu transactions, %lu in a batch\r\n", (unsigned long)unbatched,
+           (unsigned long)apds9930_sim_default.transactions);
+    CHECK(apds9930_sim_default.transactions == 2);
+    CHECK(unbatched == 8);
+    CHECK(collect() == 2);
+    CHECK(writes[0].cmd == (AUTO_INCREMENT | APDS9930_ATIME) && writes[0].len == APDS9930_CONTROL);
+    CHECK(writes[1].cmd == (REPEATED_BYTE | APDS9930_ENABLE));
+    CHECK(apds9930_verify());
+}
+
+/* Writing what the shadow already holds costs nothing, nested commits wait for the outer one */
+static void test_clean(void)
+{
+    mark();
+    apds9930_beginConfig();
+    apds9930_setAmbientLightGain(apds9930_getAmbientLightGain());
+    apds9930_setLightIntWindow(apds9930_getLightIntLowThreshold(), apds9930_getLightIntHighThreshold());
+    apds9930_WriteRegData(APDS9930_ATIME, apds9930_readRegData(APDS9930_ATIME));
+    apds9930_commitConfig();
+    CHECK(collect() == 0);
+    CHECK(apds9930_sim_default.transactions == 1);     /* the ATIME read */
+
+    mark();
+    apds9930_beginConfig();
+    apds9930_beginConfig();
+    apds9930_setLightIntWindow(200, 3000);
+    apds9930_commitConfig();
+    CHECK(apds9930_sim_default.transactions == 0);
+    apds9930_commitConfig();
+    CHECK(apds9930_sim_default.transactions == 1);
+    CHECK(apds9930_getLightIntLowThreshold() == 200);
+}
+
+int main(void)
+{
+    apds9930_sim_reset(&apds9930_sim_default);
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+    CHECK(apds9930_init() == 0);
+
+    test_coalesce();
+    test_order();
+    test_scene();
+    test_clean();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,91 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+static iic_sim_slave_t slave;
+
+/*
+ * apds9930_waitEvent() through the STOP stand-in: each wake costs one
+ * STATUS..PDATAH burst and one clear command, INT is released before
+ * the next stop(), and the STOP/skip/timeout counters follow the model.
+ */
+static void run(const apds9930_bus_t *bus)
+{
+    apds9930_sim_t *sim = &apds9930_sim_default;
+    apds9930_lp_sim_t *lp = &apds9930_lp_sim_default;
+    apds9930_lp_sim_t empty = {0};
+    apds9930_event_t ev;
+    apds9930_power_t plan;
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t stops;
+    uint32_t skipped;
+    uint64_t start;
+    uint8_t i;
+
+    apds9930_sim_reset(sim);
+    apds9930_setBus(bus);
+    *lp = empty;
+    CHECK(apds9930_init() == 0);
+    apds9930_sim_setScene(sim, 256 * 20, 256 * 4, 0);
+    apds9930_WriteRegData(APDS9930_PERS, 0);
+    CHECK(apds9930_planPowerForRate(&plan, APDS9930_AEN | APDS9930_AIEN, 2000));
+    apds9930_applyPowerPlan(&plan);
+
+    lp->wake_ns = 5000;
+    apds9930_armWake(&apds9930_lp_sim);
+    CHECK(lp->arms == 1);
+
+    for(i = 0; i < 20; i++)
+    {
+        transactions = sim->transactions;
+        bytes = sim->bytes;
+
+        CHECK(apds9930_waitEvent(&apds9930_lp_sim, &ev));
+        CHECK(ev.sample.status & APDS9930_AINT);
+        CHECK(ev.sample.ch0 == sim->regs[APDS9930_Ch0DATAL] + (sim->regs[APDS9930_Ch0DATAH] << 8));
+        CHECK(ev.sample.ch0 != 0);
+
+        /* one read of command + STATUS..PDATAH, one CLEAR_ALS_INT */
+        CHECK(sim->bytes - bytes == 1 + 7 + 1);
+        CHECK(sim->transactions - transactions == 2);
+        CHECK(!(sim->regs[APDS9930_STATUS] & APDS9930_AINT));
+        CHECK(apds9930_sim_intLevel(sim));
+    }
+    CHECK(lp->stops == 20);
+    CHECK(lp->skipped == 0);
+    CHECK(lp->timeouts == 0);
+    CHECK(lp->bus_held == 0);
+    /* awake about 292 us per event for the burst and the clear, in STOP 99.9% of the time */
+    CHECK(lp->run_ns <= 19 * 300000ULL);
+    CHECK(lp->stop_ns * 1000 >= (lp->stop_ns + lp->run_ns) * 999);
+
+    /* INT already low: serviced without entering STOP */
+    HAL_Delay(1000);
+    CHECK(!apds9930_sim_intLevel(sim));
+    stops = lp->stops;
+    skipped = lp->skipped;
+    CHECK(apds9930_waitEvent(&apds9930_lp_sim, &ev));
+    CHECK(lp->stops == stops);
+    CHECK(lp->skipped == skipped + 1);
+
+    /* Engines off: only the wake-up timer ends STOP */
+    apds9930_disableLightSensor();
+    lp->max_ms = 500;
+    start = apds9930_sim_now();
+    CHECK(!apds9930_waitEvent(&apds9930_lp_sim, &ev));
+    CHECK(apds9930_sim_now() - start >= 500000000ULL);
+    CHECK(lp->timeouts == 1);
+    lp->max_ms = 0;
+}
+
+int main(void)
+{
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+
+    run(&apds9930_bus_iic);
+    run(&apds9930_bus_sim);
+    apds9930_setBus(&apds9930_bus_iic);
+
+    return TEST_RESULT();
+}
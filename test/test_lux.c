@@ -0,0 +1,131 @@
+#include <time.h>
+#include "apds9930.h"
+#include "test.h"
+
+static const uint8_t atime[] = { 0xFF, 0xF6, 0xED, 0xDB, 0xC0, 0x00 };
+static const uint8_t gain[] = { 1, 8, 16, 120 };
+
+/*
+ * Integer lux against a double-precision evaluation of the datasheet
+ * formula over a 97x89-stride grid of the Ch0/Ch1 range, six ATIME values
+ * and all gains. The error stays within 0.5 mlux plus 2.6e-5 lux-per-count
+ * steps per count of Ch0 + Ch1.
+ */
+static void test_accuracy(void)
+{
+    double iac1, iac2, iac, lpc, ref, err;
+    uint32_t ch0, ch1;
+    uint8_t a, g;
+
+    for(a = 0; a < sizeof(atime); a++)
+    {
+        for(g = 0; g < sizeof(gain); g++)
+        {
+            lpc = GA * DF / (2.73 * (256 - atime[a]) * gain[g]) * 1000.0;
+            for(ch0 = 0; ch0 < 65536; ch0 += 97)
+            {
+                for(ch1 = 0; ch1 < 65536; ch1 += 89)
+                {
+                    iac1 = ch0 - ALS_B * ch1;
+                    iac2 = ALS_C * ch0 - ALS_D * ch1;
+                    iac = iac1 > iac2 ? iac1 : iac2;
+                    ref = (iac > 0 ? iac : 0) * lpc;
+                    err = apds9930_calcMilliLux((uint16_t)ch0, (uint16_t)ch1, g, atime[a]) - ref;
+                    if(err < 0)
+                        err = -err;
+                    CHECK(err <= 0.5 + 2.6e-5 * (ch0 + ch1) * lpc);
+                    if(test_failures)
+                        return;
+                }
+            }
+        }
+    }
+
+    /* The table folded at compile time for DEFAULT_ATIME equals the division */
+    for(g = 0; g < sizeof(gain); g++)
+    {
+        CHECK(apds9930_getLpcQ16(g, DEFAULT_ATIME) == APDS9930_LPC_Q16_NUM / ((256UL - DEFAULT_ATIME) * gain[g]));
+    }
+}
+
+/*
+ * The same grid through the float reference apds9930_calcLux(): both agree
+ * within the integer error bound plus float rounding, and both are timed
+ * over the full grid. The times are printed, not checked: with a host FPU
+ * the two are within noise of each other, the gap that matters is the
+ * soft-float division and multiplies on a core without one.
+ */
+static void test_float(void)
+{
+    volatile uint32_t mlux_sink = 0;
+    volatile float lux_sink = 0;
+    double lpc, ref, err;
+    clock_t t0, t1, t2;
+    uint32_t ch0, ch1, n;
+    uint8_t a, g;
+
+    for(a = 0; a < sizeof(atime); a++)
+    {
+        for(g = 0; g < sizeof(gain); g++)
+        {
+            lpc = GA * DF / (2.73 * (256 - atime[a]) * gain[g]) * 1000.0;
+            for(ch0 = 0; ch0 < 65536; ch0 += 389)
+            {
+                for(ch1 = 0; ch1 < 65536; ch1 += 353)
+                {
+                    ref = apds9930_calcLux((uint16_t)ch0, (uint16_t)ch1, g, atime[a]) * 1000.0;
+                    err = apds9930_calcMilliLux((uint16_t)ch0, (uint16_t)ch1, g, atime[a]) - ref;
+                    if(err < 0)
+                        err = -err;
+                    CHECK(err <= 0.5 + 2.6e-5 * (ch0 + ch1) * lpc + 1e-6 * ref);
+                    if(test_failures)
+                        return;
+                }
+            }
+        }
+    }
+
+    n = 0;
+    t0 = clock();
+    for(a = 0; a < sizeof(atime); a++)
+    {
+        for(g = 0; g < sizeof(gain); g++)
+        {
+            for(ch0 = 0; ch0 < 65536; ch0 += 97)
+            {
+                for(ch1 = 0; ch1 < 65536; ch1 += 89)
+                {
+                    mlux_sink += apds9930_calcMilliLux((uint16_t)ch0, (uint16_t)ch1, g, atime[a]);
+                    n++;
+                }
+            }
+        }
+    }
+    t1 = clock();
+    for(a = 0; a < sizeof(atime); a++)
+    {
+        for(g = 0; g < sizeof(gain); g++)
+        {
+            for(ch0 = 0; ch0 < 65536; ch0 += 97)
+            {
+                for(ch1 = 0; ch1 < 65536; ch1 += 89)
+                {
+                    lux_sink += apds9930_calcLux((uint16_t)ch0, (uint16_t)ch1, g, atime[a]);
+                }
+            }
+        }
+    }
+    t2 = clock();
+
+    printf("calcMilliLux %.1f ns, calcLux %.1f ns per call over %lu points\r\n",
+           (double)(t1 - t0) * 1e9 / CLOCKS_PER_SEC / n, (double)(t2 - t1) * 1e9 / CLOCKS_PER_SEC / n,
+           (unsigned long)n);
+}
+
+int main(void)
+{
+    test_accuracy();
+    test_float();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,127 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+/*
+ * Three sensors at the same address: the default instance and B on
+ * separate bit-banged pin pairs (IIC_MULTI_BUS), C on the register-level
+ * bus. Counts, shadows, interrupts and rings must all stay per device.
+ */
+static iic_sim_slave_t slave_a;
+static iic_sim_slave_t slave_b;
+static apds9930_sim_t sim_b;
+static apds9930_sim_t sim_c;
+static const iic_bus_t pins_b = { GPIOA, GPIO_PIN_2, GPIO_PIN_3 };
+static apds9930_bus_t bus_b;
+static apds9930_bus_t bus_c;
+static apds9930_dev_t dev_b;
+static apds9930_dev_t dev_c;
+
+static void test_polled(void)
+{
+    apds9930_sample_t a, b, c;
+
+    apds9930_setAmbientLightGain(AGAIN_1X);
+    apds9930_dev_setAmbientLightGain(&dev_b, AGAIN_8X);
+    apds9930_dev_setAmbientLightGain(&dev_c, AGAIN_16X);
+
+    apds9930_enablePower();
+    apds9930_setMode(AMBIENT_LIGHT, 1);
+    apds9930_setMode(PROXIMITY, 1);
+    apds9930_dev_enablePower(&dev_b);
+    apds9930_dev_setMode(&dev_b, AMBIENT_LIGHT, 1);
+    apds9930_dev_setMode(&dev_b, PROXIMITY, 1);
+    apds9930_dev_enablePower(&dev_c);
+    apds9930_dev_setMode(&dev_c, AMBIENT_LIGHT, 1);
+    apds9930_dev_setMode(&dev_c, PROXIMITY, 1);
+    HAL_Delay(200);
+
+    apds9930_readSample(&a);
+    apds9930_dev_readSample(&dev_b, &b);
+    apds9930_dev_readSample(&dev_c, &c);
+    CHECK(a.ch0 == 100 * (256 - DEFAULT_ATIME) && a.proximity == 10);
+    CHECK(b.ch0 == 30 * 8 * (256 - DEFAULT_ATIME) && b.proximity == 500);
+    CHECK(c.ch0 == 50 * 16 * (256 - DEFAULT_ATIME) && c.proximity == 900);
+
+    CHECK(apds9930_verify());
+    CHECK(apds9930_dev_verify(&dev_b));
+    CHECK(apds9930_dev_verify(&dev_c));
+    CHECK(apds9930_getAmbientLightGain() == AGAIN_1X);
+    CHECK(apds9930_dev_getAmbientLightGain(&dev_b) == AGAIN_8X);
+    CHECK(apds9930_dev_getAmbientLightGain(&dev_c) == AGAIN_16X);
+    CHECK(apds9930_sim_default.regs[APDS9930_CONTROL] != sim_b.regs[APDS9930_CONTROL]);
+    CHECK(sim_b.regs[APDS9930_CONTROL] != sim_c.regs[APDS9930_CONTROL]);
+}
+
+static void test_interrupts(void)
+{
+    apds9930_event_t ev;
+    uint32_t na = 0;
+    uint32_t nb = 0;
+    uint32_t nc = 0;
+    uint32_t near = 0;
+
+    /* every-cycle ALS on A, presence on B, tracking on C */
+    apds9930_startAcquisition();
+    apds9930_dev_startPresence(&dev_b, 600, 400, 1);
+    apds9930_dev_startTracking(&dev_c, 10, 1);
+    HAL_Delay(100);
+    apds9930_sim_setScene(&sim_b, 30 << 8, 6 << 8, 800);
+    apds9930_sim_setScene(&sim_c, 200 << 8, 20 << 8, 900);
+    HAL_Delay(300);
+
+    while(apds9930_popSample(&ev))
+    {
+        na++;
+    }
+    while(apds9930_dev_popSample(&dev_b, &ev))
+    {
+        nb++;
+        near += ev.prox_state == NEAR_STATE;
+    }
+    while(apds9930_dev_popSample(&dev_c, &ev))
+    {
+        nc++;
+    }
+
+    CHECK(na >= 5);
+    CHECK(nb >= 1 && near >= 1);
+    CHECK(apds9930_dev_getProximityState(&dev_b) == NEAR_STATE);
+    CHECK(nc >= 1 && nc <= 3);
+    CHECK(apds9930_getProximityState() == NOTAVAILABLE_STATE);
+
+    apds9930_stopAcquisition();
+    apds9930_dev_stopPresence(&dev_b);
+    apds9930_dev_stopAcquisition(&dev_c);
+}
+
+int main(void)
+{
+    apds9930_sim_reset(&apds9930_sim_default);
+    apds9930_sim_reset(&sim_b);
+    apds9930_sim_reset(&sim_c);
+    iic_sim_attach(&slave_a, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+    iic_sim_attach(&slave_b, &sim_b, GPIOA, GPIO_PIN_2, GPIO_PIN_3);
+
+    bus_b = apds9930_bus_iic;
+    bus_b.ctx = (void *)&pins_b;
+    bus_c = apds9930_bus_sim;
+    bus_c.ctx = &sim_c;
+    dev_b = (apds9930_dev_t)APDS9930_DEV_INIT(&bus_b, APDS9930_I2C_ADDR);
+    dev_b.int_sim = &sim_b;
+    dev_c = (apds9930_dev_t)APDS9930_DEV_INIT(&bus_c, APDS9930_I2C_ADDR);
+    dev_c.int_sim = &sim_c;
+
+    apds9930_sim_setScene(&apds9930_sim_default, 100 << 8, 20 << 8, 10);
+    apds9930_sim_setScene(&sim_b, 30 << 8, 6 << 8, 500);
+    apds9930_sim_setScene(&sim_c, 50 << 8, 5 << 8, 900);
+
+    CHECK(apds9930_init() == 0);
+    CHECK(apds9930_dev_init(&dev_b) == 0);
+    CHECK(apds9930_dev_init(&dev_c) == 0);
+
+    test_polled();
+    test_interrupts();
+
+    return TEST_RESULT();
+}
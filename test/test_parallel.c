@@ -0,0 +1,97 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+/*
+ * Eight sensors at 0x39 on one SCL (PA15) and their own SDA lines
+ * (IIC_PARALLEL), next to the default instance on PA6/PA7.
+ */
+#define LANES 8
+
+static iic_sim_slave_t slave;
+static iic_sim_slave_t lane_slave[LANES];
+static apds9930_sim_t lane_sim[LANES];
+static iic_par_t par;
+static const uint16_t lane_sda[LANES] = {
+    GPIO_PIN_0, GPIO_PIN_1, GPIO_PIN_2, GPIO_PIN_3, GPIO_PIN_4, GPIO_PIN_5, GPIO_PIN_8, GPIO_PIN_9
+};
+
+static void test_read(void)
+{
+    apds9930_sample_t one;
+    apds9930_sample_t s[LANES];
+    uint64_t t0, t1, t2;
+    uint16_t nack;
+    uint8_t i;
+
+    t0 = apds9930_sim_now();
+    apds9930_readSample(&one);
+    t1 = apds9930_sim_now();
+    nack = apds9930_readSampleParallel(&par, s);
+    t2 = apds9930_sim_now();
+
+    printf("readSample %llu ns, %u lanes %llu ns\r\n", (unsigned long long)(t1 - t0), LANES,
+           (unsigned long long)(t2 - t1));
+
+    CHECK(one.ch0 == 1234 && one.ch1 == 321 && one.proximity == 42);
+    CHECK(nack == 0);
+    for(i = 0; i < LANES; i++)
+    {
+        CHECK(s[i].ch0 == 1000 + i * 1111);
+        CHECK(s[i].ch1 == 300 + i * 77);
+        CHECK(s[i].proximity == 5 + i * 100);
+    }
+
+    /* all lanes in the time of one 7-byte read at 400 kHz */
+    CHECK(t2 - t1 <= (t1 - t0) * 11 / 10);
+    CHECK(t2 - t1 <= 240000);
+}
+
+static void test_write(void)
+{
+    uint8_t atime = 0xC0;
+    uint8_t i;
+
+    CHECK(apds9930_bus_iic_writeParallel(&par, APDS9930_I2C_ADDR, REPEATED_BYTE | APDS9930_ATIME, &atime, 1) == 0);
+    for(i = 0; i < LANES; i++)
+    {
+        CHECK(lane_sim[i].regs[APDS9930_ATIME] == 0xC0);
+    }
+    CHECK(apds9930_sim_default.regs[APDS9930_ATIME] != 0xC0);
+}
+
+static void test_nack(void)
+{
+    apds9930_sample_t s[LANES];
+
+    /* lane 3 answers another address, the others still read */
+    lane_sim[3].address = 0x29;
+    CHECK(apds9930_readSampleParallel(&par, s) == 0x0008);
+    CHECK(s[2].ch0 == 1000 + 2 * 1111);
+    CHECK(s[4].ch0 == 1000 + 4 * 1111);
+    lane_sim[3].address = APDS9930_I2C_ADDR;
+}
+
+int main(void)
+{
+    uint8_t i;
+
+    apds9930_sim_reset(&apds9930_sim_default);
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+    apds9930_sim_setData(&apds9930_sim_default, 1234, 321, 42);
+    for(i = 0; i < LANES; i++)
+    {
+        apds9930_sim_reset(&lane_sim[i]);
+        iic_sim_attach(&lane_slave[i], &lane_sim[i], GPIOA, GPIO_PIN_15, lane_sda[i]);
+        apds9930_sim_setData(&lane_sim[i], 1000 + i * 1111, 300 + i * 77, 5 + i * 100);
+    }
+
+    CHECK(apds9930_init() == 0);
+    i2c_ParInit(&par, GPIOA, GPIO_PIN_15, lane_sda, LANES);
+
+    test_read();
+    test_write();
+    test_nack();
+
+    return TEST_RESULT();
+}
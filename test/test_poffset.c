@@ -0,0 +1,66 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+static iic_sim_slave_t slave;
+static uint8_t saved;
+
+static void save(uint8_t poffset)
+{
+    saved = poffset;
+}
+
+/*
+ * POFFSET bisection over crosstalk levels 0-120 counts per pulse at PPULSE 8
+ * and 16, targets 0 and 100: at most 8 proximity cycles (under 100 ms at
+ * PTIME 0xFF), PDATA within the tolerance, or POFFSET at its +127 limit
+ * when the crosstalk is out of range. ENABLE comes back as it was.
+ */
+int main(void)
+{
+    static const uint32_t xtalk[] = { 0, 5, 20, 40, 60, 120 };
+    static const uint8_t pulses[] = { 8, 16 };
+    static const uint16_t targets[] = { 0, 100 };
+    apds9930_sim_t *sim = &apds9930_sim_default;
+    uint64_t start;
+    uint16_t pdata;
+    uint8_t enable;
+    uint8_t poffset;
+    uint8_t cycles;
+    uint8_t p, x, t;
+
+    iic_sim_attach(&slave, sim, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+
+    for(p = 0; p < sizeof(pulses); p++)
+    {
+        for(x = 0; x < sizeof(xtalk) / sizeof(xtalk[0]); x++)
+        {
+            for(t = 0; t < sizeof(targets) / sizeof(targets[0]); t++)
+            {
+                apds9930_sim_reset(sim);
+                CHECK(apds9930_init() == 0);
+                apds9930_WriteRegData(APDS9930_PPULSE, pulses[p]);
+                apds9930_enableLightSensor(false);
+                enable = apds9930_getRegShadow(APDS9930_ENABLE);
+                sim->xtalk = xtalk[x] * 256;
+                saved = 0xAA;
+
+                start = apds9930_sim_now();
+                poffset = apds9930_calibrateProximityOffset(targets[t], 2, save, &cycles);
+                CHECK(cycles <= 8);
+                CHECK(apds9930_sim_now() - start < 100000000ULL);
+                CHECK(saved == poffset);
+                CHECK(sim->regs[APDS9930_POFFSET] == poffset);
+                CHECK(sim->regs[APDS9930_ENABLE] == enable);
+
+                pdata = apds9930_readProximity();
+                if(poffset == 0x7F)
+                    CHECK(pdata > targets[t]);
+                else
+                    CHECK(pdata + 2 >= targets[t] && pdata <= targets[t] + 2);
+            }
+        }
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,171 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+/*
+ * Power planner against figures worked out by hand from the datasheet
+ * typical currents (active 195 uA, Wait 90 uA, LED drive + 3 mA for
+ * 7.3 us per pulse) and the default MCU cost of 3 mA for 300 us per
+ * sample. A step is 2.73 ms, 12 times that with WLONG. The shadow starts
+ * from the defaults: ATIME 0xED (19 steps), PTIME 0xFF, PPULSE 8, 100 mA.
+ */
+static iic_sim_slave_t slave;
+
+static void reset(void)
+{
+    apds9930_sim_reset(&apds9930_sim_default);
+    CHECK(apds9930_init() == 0);
+}
+
+/*
+ * Apply a plan and check the model completes its ALS conversions, the
+ * last state of every cycle, on the planned period: the n-th is due n
+ * periods after the engines start, checked half a millisecond either side.
+ */
+static void check_period(const apds9930_power_t *plan, uint32_t cycles)
+{
+    apds9930_sim_t *sim = &apds9930_sim_default;
+    uint32_t start;
+    uint64_t due_ns;
+
+    apds9930_applyPowerPlan(plan);
+    apds9930_sim_update(sim);
+    start = sim->als_cycles;
+    due_ns = apds9930_sim_now() + (uint64_t)cycles * plan->period_us * 1000;
+
+    apds9930_sim_advanceNs(due_ns - 500000 - apds9930_sim_now());
+    apds9930_sim_update(sim);
+    CHECK(sim->als_cycles - start == cycles - 1);
+
+    apds9930_sim_advanceNs(1000000);
+    apds9930_sim_update(sim);
+    CHECK(sim->als_cycles - start == cycles);
+
+    apds9930_setMode(ALL, 0);
+}
+
+static void test_rate(void)
+{
+    apds9930_power_t plan;
+
+    /*
+     * 2 Hz ALS: conversion 2.73 + 19 * 2.73 = 54.6 ms, 445.4 ms to fill,
+     * 163 steps (WTIME 0x5D) keeps the rate above 2 Hz: 499.59 ms.
+     * Sensor (54.6 * 195 + 444.99 * 90) / 499.59 = 101.475 uA,
+     * MCU 3000 * 0.3 / 499.59 = 1.801 uA.
+     */
+    reset();
+    CHECK(apds9930_planPowerForRate(&plan, APDS9930_AEN, 2000));
+    CHECK(plan.enable == (APDS9930_PON | APDS9930_AEN | APDS9930_WEN));
+    CHECK(plan.atime == DEFAULT_ATIME);
+    CHECK(plan.wtime == 0x5D && !(plan.config & APDS9930_WLONG));
+    CHECK(plan.period_us == 499590 && plan.rate_mhz == 2001);
+    CHECK(plan.sensor_na == 101475 && plan.mcu_na == 1801);
+    CHECK(plan.sample_nj == 154788);
+    check_period(&plan, 10);
+
+    /*
+     * 1 Hz needs 945.4 ms of Wait, beyond 256 * 2.73 ms: WLONG, 28 steps of
+     * 32.76 ms (WTIME 0xE4), 971.88 ms. Sensor 95.898 uA, MCU 0.926 uA.
+     */
+    CHECK(apds9930_planPowerForRate(&plan, APDS9930_AEN, 1000));
+    CHECK(plan.wtime == 0xE4 && (plan.config & APDS9930_WLONG));
+    CHECK(plan.period_us == 971880 && plan.rate_mhz == 1028);
+    CHECK(plan.sensor_na == 95898 && plan.mcu_na == 926);
+    check_period(&plan, 5);
+
+    /*
+     * 0.1 Hz is past the longest Wait: 256 long steps (WTIME 0), 8.44 s,
+     * still at least the requested rate. Sensor 90.679 uA, MCU 0.106 uA.
+     */
+    CHECK(apds9930_planPowerForRate(&plan, APDS9930_AEN, 100));
+    CHECK(plan.wtime == 0 && (plan.config & APDS9930_WLONG));
+    CHECK(plan.period_us == 8441160 && plan.rate_mhz == 118);
+    CHECK(plan.sensor_na == 90679 && plan.mcu_na == 106);
+    check_period(&plan, 2);
+
+    /*
+     * 10 Hz Prox + ALS: Prox 2.73 + 8 * 0.016 + 2.73 + 2.73 = 8.318 ms,
+     * 62.918 ms with ALS, 13 Wait steps (WTIME 0xF3), 98.408 ms. LED
+     * 8 * (100 + 3 - 0.195) mA * 7.3 us = 6.004 nC per cycle.
+     * Sensor (62.918 * 195 + 35.49 * 90 + 6003.8) / 98.408 = 218.142 uA.
+     */
+    CHECK(apds9930_planPowerForRate(&plan, APDS9930_AEN | APDS9930_PEN, 10000));
+    CHECK(plan.wtime == 0xF3 && plan.ppulse == DEFAULT_PPULSE);
+    CHECK(plan.period_us == 98408 && plan.rate_mhz == 10161);
+    CHECK(plan.sensor_na == 218142 && plan.mcu_na == 9145);
+    check_period(&plan, 20);
+
+    /* interrupts put the device to sleep after INT */
+    CHECK(apds9930_planPowerForRate(&plan, APDS9930_AEN | APDS9930_AIEN, 2000));
+    CHECK(plan.enable == (APDS9930_PON | APDS9930_AEN | APDS9930_AIEN | APDS9930_SAI | APDS9930_WEN));
+}
+
+static void test_atime(void)
+{
+    apds9930_power_t plan;
+
+    /*
+     * 50 Hz leaves 20 ms: 2.73 ms ALS Init, 6 integration steps (ATIME 0xFA),
+     * 19.11 ms with no room for Wait.
+     */
+    reset();
+    CHECK(apds9930_planPowerForRate(&plan, APDS9930_AEN, 50000));
+    CHECK(plan.atime == 0xFA);
+    CHECK(!(plan.enable & APDS9930_WEN));
+    CHECK(plan.period_us == 19110 && plan.sensor_na == APDS9930_IDD_ACTIVE_NA);
+
+    /* the shadow is untouched by planning */
+    CHECK(apds9930_readRegData(APDS9930_ATIME) == DEFAULT_ATIME);
+    check_period(&plan, 20);
+
+    /* 1 kHz is out of reach: false with the fastest cycle, one step */
+    CHECK(!apds9930_planPowerForRate(&plan, APDS9930_AEN, 1000000));
+    CHECK(plan.atime == 0xFF && plan.period_us == 5460);
+}
+
+static void test_current(void)
+{
+    apds9930_power_t plan;
+
+    /*
+     * 150 uA: one 54.6 ms conversion with its read costs 11.547 nC, so the
+     * period must be at least (11547 - 90 * 54.6) / (150 - 90) = 110.55 ms.
+     * 21 Wait steps round up to 111.93 ms: 141.219 + 8.040 uA.
+     */
+    reset();
+    CHECK(apds9930_planPowerForCurrent(&plan, APDS9930_AEN, 150000));
+    CHECK(plan.wtime == 256 - 21 && !(plan.config & APDS9930_WLONG));
+    CHECK(plan.period_us == 111930);
+    CHECK(plan.sensor_na == 141219 && plan.mcu_na == 8040);
+    CHECK(plan.sensor_na + plan.mcu_na <= 150000);
+    check_period(&plan, 10);
+
+    /* enough for continuous conversion */
+    CHECK(apds9930_planPowerForCurrent(&plan, APDS9930_AEN, 1000000));
+    CHECK(!(plan.enable & APDS9930_WEN) && plan.period_us == 54600);
+
+    /* just above the Wait current: even the longest cycle draws 90.785 uA */
+    CHECK(!apds9930_planPowerForCurrent(&plan, APDS9930_AEN, 90100));
+    CHECK(plan.wtime == 0 && (plan.config & APDS9930_WLONG));
+    CHECK(plan.period_us == 8441160 && plan.sensor_na + plan.mcu_na == 90785);
+
+    /* at or below the Wait current it cannot be met either, same fallback */
+    CHECK(!apds9930_planPowerForCurrent(&plan, APDS9930_AEN, APDS9930_IDD_WAIT_NA));
+    CHECK(plan.wtime == 0 && (plan.config & APDS9930_WLONG) && plan.period_us == 8441160);
+
+    /* no engine, nothing to plan */
+    CHECK(!apds9930_planPowerForCurrent(&plan, 0, 150000));
+    CHECK(plan.period_us == 0 && plan.sensor_na == 0);
+}
+
+int main(void)
+{
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+
+    test_rate();
+    test_atime();
+    test_current();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,77 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+static iic_sim_slave_t slave;
+
+/* Wait up to 200 ms for the next event, false if none came */
+static bool wait_event(apds9930_event_t *ev, uint32_t *latency_us)
+{
+    uint64_t start = apds9930_sim_now();
+    uint16_t ms;
+
+    for(ms = 0; ms < 200; ms++)
+    {
+        HAL_Delay(1);
+        if(apds9930_popSample(ev))
+        {
+            *latency_us = (uint32_t)((apds9930_sim_now() - start) / 1000);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int main(void)
+{
+    /* PDATA steps and the event each one must raise with NEAR 600 / FAR 400 */
+    static const struct { uint16_t prox; uint8_t state; } steps[] = {
+        { 100, FAR_STATE },
+        { 650, NEAR_STATE },
+        { 500, NOTAVAILABLE_STATE },    /* inside the hysteresis band */
+        { 620, NOTAVAILABLE_STATE },    /* already NEAR */
+        { 350, FAR_STATE },
+        { 900, NEAR_STATE },
+        { 100, FAR_STATE },
+    };
+    apds9930_event_t ev;
+    uint32_t bound_us;
+    uint32_t latency_us;
+    uint8_t i;
+
+    apds9930_sim_reset(&apds9930_sim_default);
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+    CHECK(apds9930_init() == 0);
+
+    /* A valid reading above NEAR makes presence start in NEAR_STATE */
+    apds9930_sim_setScene(&apds9930_sim_default, 256 * 20, 256 * 4, 700);
+    apds9930_setMode(PROXIMITY, 1);
+    apds9930_enablePower();
+    CHECK(apds9930_waitReady(APDS9930_PVALID, 100));
+    bound_us = apds9930_startPresence(600, 400, 1);
+    CHECK(apds9930_getProximityState() == NEAR_STATE);
+    CHECK(bound_us > 0);
+
+    for(i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+    {
+        HAL_Delay(200);
+        while(apds9930_popSample(&ev));
+
+        apds9930_sim_setScene(&apds9930_sim_default, 256 * 20, 256 * 4, steps[i].prox);
+        if(steps[i].state == NOTAVAILABLE_STATE)
+        {
+            CHECK(!wait_event(&ev, &latency_us));
+            continue;
+        }
+
+        CHECK(wait_event(&ev, &latency_us));
+        CHECK(ev.prox_state == steps[i].state);
+        CHECK(ev.sample.proximity == steps[i].prox);
+        CHECK(apds9930_getProximityState() == steps[i].state);
+        /* raised within the returned bound, seen at the next 1 ms poll */
+        CHECK(latency_us <= bound_us + 1000);
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,79 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+static iic_sim_slave_t slave;
+
+/* Cycle time from the shadow matches the datasheet step times */
+static void test_cycle(void)
+{
+    apds9930_enableLightSensor(false);
+    CHECK(apds9930_getCycleTimeUs() == (1 + 256 - DEFAULT_ATIME) * APDS9930_STEP_US);
+
+    apds9930_setMode(PROXIMITY, 1);
+    CHECK(apds9930_getCycleTimeUs() == (1 + 256 - DEFAULT_ATIME) * APDS9930_STEP_US +
+          (2 + 256 - DEFAULT_PTIME) * APDS9930_STEP_US + DEFAULT_PPULSE * APDS9930_PULSE_US);
+
+    apds9930_WriteRegData(APDS9930_WTIME, 0xF0);
+    apds9930_setMode(WAIT, 1);
+    apds9930_WriteRegData(APDS9930_CONFIG, apds9930_getRegShadow(APDS9930_CONFIG) | APDS9930_WLONG);
+    CHECK(apds9930_getCycleTimeUs() == (1 + 256 - DEFAULT_ATIME) * APDS9930_STEP_US +
+          (2 + 256 - DEFAULT_PTIME) * APDS9930_STEP_US + DEFAULT_PPULSE * APDS9930_PULSE_US +
+          16 * 12 * APDS9930_STEP_US);
+
+    apds9930_WriteRegData(APDS9930_CONFIG, apds9930_getRegShadow(APDS9930_CONFIG) & ~APDS9930_WLONG);
+    apds9930_setMode(WAIT, 0);
+    apds9930_setMode(PROXIMITY, 0);
+    apds9930_disableLightSensor();
+    CHECK(apds9930_getCycleTimeUs() == 0);
+}
+
+/* The deadline follows the first conversion, waitReady() needs one STATUS poll there */
+static void test_deadline(uint8_t mode, uint8_t valid_mask)
+{
+    apds9930_sim_t *sim = &apds9930_sim_default;
+    uint32_t deadline;
+    uint32_t cycles;
+    uint32_t transactions;
+
+    apds9930_sim_update(sim);
+    cycles = sim->als_cycles + sim->prox_cycles;
+    if(mode == AMBIENT_LIGHT)
+        apds9930_enableLightSensor(false);
+    else
+        apds9930_setMode(mode, 1);
+
+    deadline = apds9930_getReadyTick();
+    CHECK(deadline == HAL_GetTick() + (apds9930_getFirstValidTimeUs(valid_mask) + 999) / 1000);
+
+    transactions = sim->transactions;
+    CHECK(apds9930_waitReady(valid_mask, 100));
+    CHECK(sim->transactions - transactions == 1);
+    CHECK(HAL_GetTick() == deadline);
+
+    /* and comes before the second conversion */
+    apds9930_sim_update(sim);
+    CHECK(sim->als_cycles + sim->prox_cycles == cycles + 1);
+}
+
+int main(void)
+{
+    uint64_t start;
+
+    apds9930_sim_reset(&apds9930_sim_default);
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+
+    /* The default image leaves the engines off, init does not wait */
+    start = apds9930_sim_now();
+    CHECK(apds9930_init() == 0);
+    CHECK(apds9930_sim_now() - start < 2000000);
+    CHECK((int32_t)(apds9930_getReadyTick() - HAL_GetTick()) <= 0);
+
+    test_cycle();
+
+    test_deadline(AMBIENT_LIGHT, APDS9930_AVALID);
+    apds9930_disableLightSensor();
+    test_deadline(PROXIMITY, APDS9930_PVALID);
+
+    return TEST_RESULT();
+}
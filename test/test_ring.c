@@ -0,0 +1,139 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+/*
+ * Interrupt sample ring on the simulated INT line: HAL_Delay(1) services
+ * the model's INT like the EXTI would, so every push is seen within the
+ * millisecond it happens. Every ALS cycle interrupts (APERS 0).
+ */
+#define RING_CYCLES     (APDS9930_RING_SIZE + 5)
+
+static iic_sim_slave_t slave;
+static uint32_t push_tick[4 * APDS9930_RING_SIZE];
+
+/*
+ * Step one millisecond, record the tick a push was seen at (the event
+ * carries the tick of the edge, at most one earlier) and check INT was
+ * released by the handler whether or not the sample found room.
+ * Returns the interrupts serviced during the step.
+ */
+static uint32_t step(void)
+{
+    apds9930_dev_t *dev = &apds9930_dev_default;
+    uint32_t head = dev->ringHead;
+    uint32_t seen = dev->ringHead + dev->ringDropped;
+
+    HAL_Delay(1);
+    if(dev->ringHead != head && head < sizeof(push_tick) / sizeof(push_tick[0]))
+        push_tick[head] = HAL_GetTick();
+    if(dev->ringHead + dev->ringDropped != seen)
+    {
+        CHECK(apds9930_sim_intLevel(&apds9930_sim_default));
+        CHECK(!(apds9930_sim_default.regs[APDS9930_STATUS] & APDS9930_AINT));
+    }
+
+    return dev->ringHead + dev->ringDropped - seen;
+}
+
+/* Fill past capacity without popping: the oldest RING_SIZE are kept */
+static void test_overflow(void)
+{
+    apds9930_sim_t *sim = &apds9930_sim_default;
+    apds9930_event_t ev;
+    uint32_t cycle_us;
+    uint32_t cycles;
+    uint32_t ints = 0;
+    uint32_t prev_tick;
+    uint16_t prev_ch0;
+    uint32_t n;
+
+    apds9930_startAcquisition();
+    cycle_us = apds9930_getCycleTimeUs();
+    cycles = sim->als_cycles;
+    while(sim->als_cycles - cycles < RING_CYCLES)
+    {
+        /* light rises every cycle so the samples are ordered */
+        apds9930_sim_setScene(sim, 256 * (10 + sim->als_cycles - cycles), 256 * 2, 0);
+        ints += step();
+    }
+
+    CHECK(ints == RING_CYCLES);
+    CHECK(apds9930_dev_default.ringHead == APDS9930_RING_SIZE);
+    CHECK(apds9930_getDroppedSamples() == RING_CYCLES - APDS9930_RING_SIZE);
+
+    prev_tick = 0;
+    prev_ch0 = 0;
+    for(n = 0; apds9930_popSample(&ev); n++)
+    {
+        CHECK(ev.sample.status & APDS9930_AINT);
+        CHECK(push_tick[n] - ev.tick <= 1);
+        /* one conversion apart, give or take the tick quantisation at both ends */
+        CHECK(n == 0 || ((ev.tick - prev_tick + 1) * 1000 > cycle_us && (ev.tick - prev_tick - 1) * 1000 < cycle_us + 1000));
+        CHECK(ev.sample.ch0 > prev_ch0);
+        prev_tick = ev.tick;
+        prev_ch0 = ev.sample.ch0;
+    }
+    CHECK(n == APDS9930_RING_SIZE);
+    CHECK(!apds9930_popSample(&ev));
+
+    apds9930_stopAcquisition();
+}
+
+/* Keep the consumer up so the indexes wrap, then fill across the wrap */
+static void test_wrap(void)
+{
+    apds9930_sim_t *sim = &apds9930_sim_default;
+    apds9930_event_t ev;
+    uint32_t popped = 0;
+    uint32_t prev_tick = 0;
+    uint32_t start;
+
+    apds9930_startAcquisition();
+    CHECK(apds9930_dev_default.ringHead == 0 && apds9930_getDroppedSamples() == 0);
+
+    while(apds9930_dev_default.ringHead < 2 * APDS9930_RING_SIZE + 3)
+    {
+        step();
+        while(apds9930_popSample(&ev))
+        {
+            CHECK(push_tick[popped] - ev.tick <= 1);
+            CHECK(ev.tick > prev_tick);
+            prev_tick = ev.tick;
+            popped++;
+        }
+    }
+    CHECK(popped == 2 * APDS9930_RING_SIZE + 3);
+    CHECK(apds9930_getDroppedSamples() == 0);
+
+    /* consumer stalls with head and tail mid-array: RING_SIZE fit, the next drops */
+    start = sim->als_cycles;
+    while(sim->als_cycles - start < APDS9930_RING_SIZE + 1)
+        step();
+    CHECK(apds9930_dev_default.ringHead - apds9930_dev_default.ringTail == APDS9930_RING_SIZE);
+    CHECK(apds9930_getDroppedSamples() == 1);
+
+    start = popped;
+    while(apds9930_popSample(&ev))
+    {
+        CHECK(ev.tick > prev_tick);
+        prev_tick = ev.tick;
+        popped++;
+    }
+    CHECK(popped - start == APDS9930_RING_SIZE);
+
+    apds9930_stopAcquisition();
+}
+
+int main(void)
+{
+    apds9930_sim_reset(&apds9930_sim_default);
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+    CHECK(apds9930_init() == 0);
+    apds9930_sim_setScene(&apds9930_sim_default, 256 * 10, 256 * 2, 0);
+
+    test_overflow();
+    test_wrap();
+
+    return TEST_RESULT();
+}
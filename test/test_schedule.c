@@ -0,0 +1,114 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+static iic_sim_slave_t slave;
+
+/*
+ * Poll every poll_us (with some jitter) for dur_ms and check the reads
+ * against the model's conversion counter: one read per conversion, no
+ * duplicates, missed conversions counted exactly.
+ */
+static void run(uint32_t poll_us, uint32_t dur_ms, uint8_t mask)
+{
+    apds9930_sim_t *sim = &apds9930_sim_default;
+    apds9930_sched_stats_t st;
+    apds9930_sample_t sample;
+    uint32_t first, last, count;
+    uint32_t dup = 0;
+    uint32_t skip = 0;
+    uint32_t end;
+    uint32_t k = 0;
+
+    apds9930_startSchedule(mask);
+    apds9930_sim_update(sim);
+    first = last = (mask & APDS9930_AVALID) ? sim->als_cycles : sim->prox_cycles;
+    end = HAL_GetTick() + dur_ms;
+
+    while((int32_t)(HAL_GetTick() - end) < 0)
+    {
+        if(apds9930_pollSample(&sample))
+        {
+            apds9930_sim_update(sim);
+            count = (mask & APDS9930_AVALID) ? sim->als_cycles : sim->prox_cycles;
+            if(count == last)
+                dup++;
+            if(count > last + 1)
+                skip += count - last - 1;
+            last = count;
+        }
+        apds9930_sim_advanceNs((uint64_t)(poll_us + (k++ * 7919) % (poll_us / 2 + 1)) * 1000);
+    }
+
+    apds9930_sim_update(sim);
+    count = ((mask & APDS9930_AVALID) ? sim->als_cycles : sim->prox_cycles) - first;
+    apds9930_getScheduleStats(&st);
+
+    CHECK(dup == 0);
+    CHECK(st.missed == skip);
+    CHECK(st.reads == st.fresh + st.early);
+    if(poll_us < 1000)
+    {
+        /* fast callers read every conversion within one poll of its end */
+        CHECK(st.missed == 0);
+        CHECK(st.fresh + 1 >= count);
+        CHECK(st.lat_max_us <= APDS9930_SCHED_GUARD_US + poll_us * 3 / 2 + 300);
+    }
+}
+
+/* An early read is retried one step later without moving the conversion grid */
+static void test_early(void)
+{
+    apds9930_dev_t *dev = &apds9930_dev_default;
+    apds9930_sched_stats_t st;
+    apds9930_sample_t sample;
+    uint32_t cycle_us = apds9930_getCycleTimeUs();
+    uint32_t due;
+
+    apds9930_startSchedule(APDS9930_AVALID);
+    CHECK(!(apds9930_sim_default.regs[APDS9930_STATUS] & APDS9930_AVALID));
+    /* predict the first conversion one step too early */
+    dev->schedDue -= APDS9930_SCHED_GUARD_US + APDS9930_STEP_US;
+    dev->schedRetry = dev->schedDue;
+    due = dev->schedDue;
+
+    while(apds9930_getScheduleStats(&st), st.fresh < 5)
+    {
+        apds9930_pollSample(&sample);
+        CHECK((dev->schedDue - due) % cycle_us == 0);
+        apds9930_sim_advanceNs(200000);
+    }
+
+    CHECK(st.early >= 1);
+    CHECK(st.reads == st.fresh + st.early);
+    CHECK(dev->schedDue - due == 5 * cycle_us);
+}
+
+int main(void)
+{
+    apds9930_sim_reset(&apds9930_sim_default);
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+    CHECK(apds9930_init() == 0);
+    apds9930_sim_setScene(&apds9930_sim_default, 256 * 20, 256 * 4, 77);
+
+    /* ALS only, ALS + proximity, a long wait, a caller slower than the cycle */
+    apds9930_enableLightSensor(false);
+    run(200, 2000, APDS9930_AVALID);
+    apds9930_setMode(PROXIMITY, 1);
+    run(200, 2000, APDS9930_AVALID | APDS9930_PVALID);
+    apds9930_WriteRegData(APDS9930_WTIME, 0xF0);
+    apds9930_setMode(WAIT, 1);
+    apds9930_WriteRegData(APDS9930_CONFIG, apds9930_getRegShadow(APDS9930_CONFIG) | APDS9930_WLONG);
+    run(500, 5000, APDS9930_AVALID);
+    apds9930_setMode(WAIT, 0);
+    run(90000, 3000, APDS9930_AVALID);
+
+    /* 5.46 ms cycle */
+    apds9930_WriteRegData(APDS9930_ATIME, 0xFF);
+    apds9930_setMode(PROXIMITY, 0);
+    run(100, 1000, APDS9930_AVALID);
+
+    test_early();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,84 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+static iic_sim_slave_t slave;
+
+/* init writes the image in one block and refuses an unknown ID */
+static void test_init(void)
+{
+    apds9930_sim_reset(&apds9930_sim_default);
+    apds9930_sim_default.regs[APDS9930_ID] = 0x55;
+    CHECK(apds9930_init() == ERROR);
+    CHECK(apds9930_sim_default.transactions == 1);
+    CHECK(apds9930_sim_default.regs[APDS9930_ATIME] == 0xFF);
+
+    apds9930_sim_default.regs[APDS9930_ID] = APDS9930_ID_1;
+    CHECK(apds9930_init() == 0);
+
+    apds9930_sim_reset(&apds9930_sim_default);
+    CHECK(apds9930_init() == 0);
+    CHECK(apds9930_sim_default.transactions == 2);
+    CHECK(apds9930_sim_default.regs[APDS9930_ATIME] == DEFAULT_ATIME);
+    CHECK(apds9930_sim_default.regs[APDS9930_AILTL] == 0xFF);
+    CHECK(apds9930_sim_default.regs[APDS9930_CONTROL] == APDS9930_CONTROL_VAL(0, 2, 3, 0));
+    CHECK(apds9930_verify());
+}
+
+/* One ALS conversion read back bit by bit */
+static void test_sample(void)
+{
+    apds9930_sample_t sample;
+
+    apds9930_sim_setScene(&apds9930_sim_default, 256 * 20, 256 * 4, 77);
+    apds9930_enableLightSensor(false);
+    CHECK(apds9930_waitReady(APDS9930_AVALID, 100));
+
+    apds9930_readSample(&sample);
+    CHECK(sample.status & APDS9930_AVALID);
+    CHECK(sample.ch0 == 20 * (256 - DEFAULT_ATIME));
+    CHECK(sample.ch1 == 4 * (256 - DEFAULT_ATIME));
+}
+
+/* SCL timing follows i2c_SetSpeed() within the I2C spec minimums */
+static void test_speed(void)
+{
+    apds9930_sample_t sample;
+
+    CHECK(i2c_SetSpeed(I2C_SPEED_100K) == 0);
+    iic_sim_resetStats();
+    apds9930_readSample(&sample);
+    CHECK(iic_sim_sclHz() <= I2C_SPEED_100K);
+    CHECK(iic_sim_stats.low_min_ns >= 4700);
+    CHECK(iic_sim_stats.high_min_ns >= 4000);
+
+    CHECK(i2c_SetSpeed(I2C_SPEED_400K) == 0);
+    iic_sim_resetStats();
+    apds9930_readSample(&sample);
+    CHECK(iic_sim_sclHz() <= I2C_SPEED_400K && iic_sim_sclHz() > I2C_SPEED_400K * 9 / 10);
+    CHECK(iic_sim_stats.low_min_ns >= 1300);
+    CHECK(iic_sim_stats.high_min_ns >= 600);
+
+    /* Out of range requests keep a legal bus */
+    CHECK(i2c_SetSpeed(0) == 1);
+    CHECK(i2c_GetSpeed() == I2C_SPEED_400K);
+    CHECK(i2c_SetSpeed(2 * I2C_SPEED_1M) == 1);
+    CHECK(i2c_GetSpeed() == I2C_SPEED_1M);
+    iic_sim_resetStats();
+    apds9930_readSample(&sample);
+    CHECK(iic_sim_sclHz() <= I2C_SPEED_1M);
+    CHECK(sample.ch0 == 20 * (256 - DEFAULT_ATIME));
+
+    i2c_SetSpeed(I2C_SPEED_DEFAULT);
+}
+
+int main(void)
+{
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+
+    test_init();
+    test_sample();
+    test_speed();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,100 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "test.h"
+
+static iic_sim_slave_t slave;
+static uint32_t seed;
+
+/* Deterministic LCG, so the replay is the same on every host */
+static uint32_t test_rand(void)
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return seed >> 8;
+}
+
+/* One Ch0 rate per second: +-8% flicker on a level that steps every 10 min, dimmed in some spans */
+static uint32_t trace(uint32_t s)
+{
+    uint32_t base = 256 * 20 + (s / 600) % 3 * 256 * 8;
+
+    if((s / 97) % 5 == 0)
+        base /= 3;
+
+    return (uint32_t)((int32_t)base + ((int32_t)(test_rand() % 1601) - 800) * (int32_t)base / 10000);
+}
+
+/*
+ * Replay one hour with interrupts on every cycle (band 0) or with the
+ * tracking window. Every event must re-centre the window on its Ch0.
+ */
+static uint32_t run(uint8_t band, uint8_t apers)
+{
+    apds9930_sim_t *sim = &apds9930_sim_default;
+    apds9930_event_t ev;
+    uint32_t wakes = 0;
+    uint32_t delta;
+    uint32_t rate;
+    uint32_t s;
+    uint8_t k;
+
+    seed = 7;
+    apds9930_sim_reset(sim);
+    CHECK(apds9930_init() == 0);
+    apds9930_sim_setScene(sim, trace(0), trace(0) / 5, 0);
+    if(band)
+        apds9930_startTracking(band, apers);
+    else
+        apds9930_startAcquisition();
+
+    for(s = 0; s < 3600; s++)
+    {
+        rate = trace(s);
+        apds9930_sim_setScene(sim, rate, rate / 5, 0);
+        for(k = 0; k < 10; k++)
+        {
+            HAL_Delay(100);
+            while(apds9930_popSample(&ev))
+            {
+                wakes++;
+                if(!band)
+                    continue;
+
+                delta = (uint32_t)ev.sample.ch0 * band / 100;
+                if(delta < APDS9930_TRACK_MIN_COUNTS)
+                    delta = APDS9930_TRACK_MIN_COUNTS;
+                CHECK(apds9930_getLightIntLowThreshold() == (ev.sample.ch0 > delta ? ev.sample.ch0 - delta : 0));
+                CHECK(apds9930_getLightIntHighThreshold() == ev.sample.ch0 + delta);
+                CHECK(sim->regs[APDS9930_AILTL] == (apds9930_getLightIntLowThreshold() & 0xFF));
+                CHECK(sim->regs[APDS9930_AIHTH] == apds9930_getLightIntHighThreshold() >> 8);
+            }
+        }
+    }
+
+    CHECK(apds9930_getDroppedSamples() == 0);
+    apds9930_stopAcquisition();
+    printf("band %u%% apers %u: %lu wakes/h\r\n", band, apers, (unsigned long)wakes);
+
+    return wakes;
+}
+
+int main(void)
+{
+    uint32_t every, band5, band10, band25;
+
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+
+    every = run(0, 0);
+    band5 = run(5, 1);
+    band10 = run(10, 1);
+    band25 = run(25, 2);
+
+    /* one wake per 54.6 ms ALS cycle without the window */
+    CHECK(every >= 3600000000UL / 54600 - 5 && every <= 3600000000UL / 54600 + 5);
+    /* the window removes most of them, wider bands more */
+    CHECK(band5 < every / 20);
+    CHECK(band10 < band5 / 3);
+    CHECK(band25 < band10 / 5);
+    CHECK(band25 > 0);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,84 @@
+#include "apds9930.h"
+#include "iic.h"
+#include "iic_wave.h"
+#include "test.h"
+
+/*
+ * apds9930_bus_wave against the pin-level sensor model: every compiled
+ * slot is driven onto the simulated port and the captured IDR words go
+ * back through the decoder, so this covers compile, timing and decode.
+ */
+static iic_sim_slave_t slave;
+
+static void test_sample(void)
+{
+    apds9930_sample_t a, b;
+
+    apds9930_setBus(&apds9930_bus_iic);
+    apds9930_readSample(&a);
+
+    apds9930_setBus(&apds9930_bus_wave);
+    iic_sim_resetStats();
+    apds9930_readSample(&b);
+
+    printf("wave: %lu Hz, tLOW %llu ns, tHIGH %llu ns\r\n", (unsigned long)iic_sim_sclHz(),
+           (unsigned long long)iic_sim_stats.low_min_ns, (unsigned long long)iic_sim_stats.high_min_ns);
+
+    CHECK(b.status == a.status);
+    CHECK(b.ch0 == 1234 && b.ch1 == 321 && b.proximity == 42);
+    CHECK(iic_sim_stats.starts == 2 && iic_sim_stats.stops == 1);
+
+    /* three slots per bit at 400 kHz, high:low 1:2 */
+    CHECK(iic_sim_stats.low_min_ns >= 1600 && iic_sim_stats.low_min_ns <= 1700);
+    CHECK(iic_sim_stats.high_min_ns >= 800 && iic_sim_stats.high_min_ns <= 850);
+}
+
+static void test_write(void)
+{
+    uint8_t regs[16];
+
+    apds9930_setLightIntLowThreshold(0x1234);
+    apds9930_setLightIntHighThreshold(0xBEEF);
+    CHECK(apds9930_sim_default.regs[APDS9930_AILTL] == 0x34);
+    CHECK(apds9930_sim_default.regs[APDS9930_AILTH] == 0x12);
+    CHECK(apds9930_getLightIntHighThreshold() == 0xBEEF);
+    CHECK(apds9930_verify());
+
+    /* longer than APDS9930_BUS_WAVE_MAX_LEN, goes through iic.c */
+    apds9930_readRegBlock(APDS9930_ENABLE, regs, 16);
+    CHECK(regs[APDS9930_AILTL] == 0x34);
+    CHECK(regs[APDS9930_AIHTH] == 0xBE);
+}
+
+static void test_nack(void)
+{
+    uint8_t buf[2] = {0};
+
+    CHECK(apds9930_bus_wave.read(0, 0x22, REPEATED_BYTE | APDS9930_ENABLE, buf, 2) == 1);
+    CHECK(apds9930_bus_wave.write(0, 0x22, REPEATED_BYTE | APDS9930_ENABLE, buf, 2) == 1);
+}
+
+static void test_slots(void)
+{
+    static uint32_t out[IIC_WAVE_READ_SLOTS(APDS9930_BUS_WAVE_MAX_LEN)];
+    uint8_t buf[3] = {0};
+
+    CHECK(IIC_WAVE_READ_SLOTS(7) == 281);
+    CHECK(iic_wave_compileRead(out, IIC_SCL_Pin, IIC_SDA_Pin, APDS9930_I2C_ADDR, 0xB3, 7) == IIC_WAVE_READ_SLOTS(7));
+    CHECK(iic_wave_compileWrite(out, IIC_SCL_Pin, IIC_SDA_Pin, APDS9930_I2C_ADDR, 0x80, buf, 3) == IIC_WAVE_WRITE_SLOTS(3));
+}
+
+int main(void)
+{
+    apds9930_sim_reset(&apds9930_sim_default);
+    iic_sim_attach(&slave, &apds9930_sim_default, GPIOA, IIC_SCL_Pin, IIC_SDA_Pin);
+    apds9930_sim_setData(&apds9930_sim_default, 1234, 321, 42);
+    CHECK(apds9930_init() == 0);
+
+    test_sample();
+    test_write();
+    test_nack();
+    test_slots();
+
+    return TEST_RESULT();
+}